@@ -86,6 +86,7 @@ include $(art_path)/runtime/Android.mk
 include $(art_path)/compiler/Android.mk
 include $(art_path)/dex2oat/Android.mk
 include $(art_path)/oatdump/Android.mk
+include $(art_path)/dexdiff/Android.mk
 include $(art_path)/dalvikvm/Android.mk
 include $(art_path)/jdwpspy/Android.mk
 include $(art_build_path)/Android.oat.mk
@@ -585,7 +585,7 @@ void CompilerDriver::Resolve(jobject class_loader, const std::vector<const DexFi
 
 void CompilerDriver::PreCompile(jobject class_loader, const std::vector<const DexFile*>& dex_files,
                                 ThreadPool& thread_pool, base::TimingLogger& timings) {
-  LoadImageClasses(timings);
+  LoadImageClasses(thread_pool, timings);
 
   Resolve(class_loader, dex_files, thread_pool, timings);
 
@@ -670,29 +670,28 @@ static bool RecordImageClassesVisitor(mirror::Class* klass, void* arg)
 }
 
 // Make a list of descriptors for classes to include in the image
-void CompilerDriver::LoadImageClasses(base::TimingLogger& timings)
+void CompilerDriver::LoadImageClasses(ThreadPool& thread_pool, base::TimingLogger& timings)
       LOCKS_EXCLUDED(Locks::mutator_lock_) {
   if (!IsImage()) {
     return;
   }
 
   timings.NewSplit("LoadImageClasses");
-  // Make a first class to load all classes explicitly listed in the file
+  // Make a first pass to load all classes explicitly listed in the file, on all threads.
   Thread* self = Thread::Current();
-  ScopedObjectAccess soa(self);
   ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
-  for (auto it = image_classes_->begin(), end = image_classes_->end(); it != end;) {
-    std::string descriptor(*it);
-    SirtRef<mirror::Class> klass(self, class_linker->FindSystemClass(descriptor.c_str()));
-    if (klass.get() == NULL) {
-      image_classes_->erase(it++);
-      VLOG(compiler) << "Failed to find class " << descriptor;
-      self->ClearException();
-    } else {
-      ++it;
+  std::vector<std::string> descriptors(image_classes_->begin(), image_classes_->end());
+  std::vector<bool> loaded;
+  class_linker->FindSystemClasses(self, descriptors, &thread_pool, &loaded);
+  for (size_t i = 0; i < descriptors.size(); ++i) {
+    if (!loaded[i]) {
+      VLOG(compiler) << "Failed to find class " << descriptors[i];
+      image_classes_->erase(descriptors[i]);
     }
   }
 
+  ScopedObjectAccess soa(self);
+
   // Resolve exception classes referenced by the loaded classes. The catch logic assumes
   // exceptions are resolved by the verifier when there is a catch block in an interested method.
   // Do this here so that exception classes appear to have been specified image classes.
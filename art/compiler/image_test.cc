@@ -23,8 +23,10 @@
 #include "compiler/oat_writer.h"
 #include "gc/space/image_space.h"
 #include "image.h"
+#include "image_class_index.h"
 #include "signal_catcher.h"
 #include "UniquePtr.h"
+#include "utf.h"
 #include "utils.h"
 #include "vector_output_stream.h"
 
@@ -145,16 +147,30 @@ TEST_F(ImageTest, WriteRead) {
   byte* image_begin = image_space->Begin();
   byte* image_end = image_space->End();
   CHECK_EQ(requested_image_base, reinterpret_cast<uintptr_t>(image_begin));
+  const ImageHeader& image_header = image_space->GetImageHeader();
+  const mirror::IntArray* class_index =
+      image_header.GetImageRoot(ImageHeader::kClassIndex)->AsIntArray();
+  mirror::ObjectArray<mirror::DexCache>* dex_caches =
+      image_header.GetImageRoot(ImageHeader::kDexCaches)->AsObjectArray<mirror::DexCache>();
+  EXPECT_LT(0U, ImageClassIndex::Size(class_index));
+  const char* object_descriptor = "Ljava/lang/Object;";
+  EXPECT_EQ(class_linker_->FindSystemClass(object_descriptor),
+            ImageClassIndex::Lookup(class_index, dex_caches, object_descriptor,
+                                    ComputeModifiedUtf8Hash(object_descriptor)));
   for (size_t i = 0; i < dex->NumClassDefs(); ++i) {
     const DexFile::ClassDef& class_def = dex->GetClassDef(i);
     const char* descriptor = dex->GetClassDescriptor(class_def);
     mirror::Class* klass = class_linker_->FindSystemClass(descriptor);
     EXPECT_TRUE(klass != NULL) << descriptor;
     EXPECT_LT(image_begin, reinterpret_cast<byte*>(klass)) << descriptor;
+    mirror::Class* indexed_klass = ImageClassIndex::Lookup(class_index, dex_caches, descriptor,
+                                                           ComputeModifiedUtf8Hash(descriptor));
     if (image_classes.find(descriptor) != image_classes.end()) {
       // image classes should be located before the end of the image.
       EXPECT_LT(reinterpret_cast<byte*>(klass), image_end) << descriptor;
+      EXPECT_TRUE(indexed_klass == NULL || indexed_klass == klass) << descriptor;
     } else {
+      EXPECT_TRUE(indexed_klass == NULL) << descriptor;
       // non image classes should be in a space after the image.
       EXPECT_GT(reinterpret_cast<byte*>(klass), image_end) << descriptor;
     }
@@ -35,6 +35,7 @@
 #include "gc/space/space-inl.h"
 #include "globals.h"
 #include "image.h"
+#include "image_class_index.h"
 #include "intern_table.h"
 #include "mirror/art_field-inl.h"
 #include "mirror/art_method-inl.h"
@@ -374,13 +375,17 @@ ObjectArray<Object>* ImageWriter::CreateImageRoots() const {
   Thread* self = Thread::Current();
 
   // build an Object[] of all the DexCaches used in the source_space_
-  ObjectArray<Object>* dex_caches = ObjectArray<Object>::Alloc(self, object_array_class,
-                                                               dex_caches_.size());
-  int i = 0;
-  for (DexCache* dex_cache : dex_caches_) {
-    dex_caches->Set(i++, dex_cache);
+  SirtRef<ObjectArray<Object> > dex_caches(self,
+                                           ObjectArray<Object>::Alloc(self, object_array_class,
+                                                                      dex_caches_.size()));
+  std::vector<DexCache*> ordered_dex_caches(dex_caches_.begin(), dex_caches_.end());
+  for (size_t i = 0; i < ordered_dex_caches.size(); ++i) {
+    dex_caches->Set(i, ordered_dex_caches[i]);
   }
 
+  // build the descriptor index of the classes resolved in those DexCaches
+  SirtRef<mirror::IntArray> class_index(self, ImageClassIndex::Create(self, ordered_dex_caches));
+
   // build an Object[] of the roots needed to restore the runtime
   SirtRef<ObjectArray<Object> >
       image_roots(self,
@@ -396,9 +401,11 @@ ObjectArray<Object>* ImageWriter::CreateImageRoots() const {
   image_roots->Set(ImageHeader::kOatLocation,
                    String::AllocFromModifiedUtf8(self, oat_file_->GetLocation().c_str()));
   image_roots->Set(ImageHeader::kDexCaches,
-                   dex_caches);
+                   dex_caches.get());
   image_roots->Set(ImageHeader::kClassRoots,
                    class_linker->GetClassRoots());
+  image_roots->Set(ImageHeader::kClassIndex,
+                   class_index.get());
   for (int i = 0; i < ImageHeader::kImageRootsMax; i++) {
     CHECK(image_roots->Get(i) != NULL);
   }
@@ -509,6 +516,13 @@ void ImageWriter::FixupObject(const Object* orig, Object* copy) {
 void ImageWriter::FixupClass(const Class* orig, Class* copy) {
   FixupInstanceFields(orig, copy);
   FixupStaticFields(orig, copy);
+  // The superclass display is native data, not a reference field.
+  if (orig->HasTypeCheckData()) {
+    for (size_t i = 0; i < orig->GetSuperClassDisplayLength(); ++i) {
+      copy->SetSuperClassDisplayEntry(i, down_cast<Class*>(
+          GetImageAddress(orig->GetSuperClassDisplayEntry(i))));
+    }
+  }
 }
 
 void ImageWriter::FixupMethod(const ArtMethod* orig, ArtMethod* copy) {
@@ -0,0 +1,491 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "atomic_integer.h"
+#include "base/logging.h"
+#include "base/stringpiece.h"
+#include "base/stringprintf.h"
+#include "dex_file-inl.h"
+#include "dex_instruction.h"
+#include "modifiers.h"
+#include "UniquePtr.h"
+#include "utils.h"
+
+namespace art {
+
+static void usage() {
+  fprintf(stderr,
+          "Usage: dexdiff [options] <old.dex|apk> <new.dex|apk>\n"
+          "    Compares two dex files method by method and reports the methods that were\n"
+          "    added, removed, changed, or stubbed out in <new> relative to <old>.\n"
+          "    Example: dexdiff shell.apk whole.dex\n"
+          "\n");
+  fprintf(stderr,
+          "  -j<number>: specifies the number of threads used to hash methods.\n"
+          "      Example: -j12\n"
+          "      Default: number of CPU cores\n"
+          "\n");
+  fprintf(stderr,
+          "  --output=<file> may be used to send the output to a file.\n"
+          "      Example: --output=/tmp/dexdiff.txt\n"
+          "\n");
+  fprintf(stderr,
+          "  --summary: only print the totals.\n"
+          "\n");
+  exit(EXIT_FAILURE);
+}
+
+// Bodies shorter than this (e.g. "return-void", or "const/4 v0, 0; return v0") are what packers
+// leave behind in place of the real code, so they are reported as stubs rather than changes.
+static const uint32_t kStubMaxCodeUnits = 4;
+
+// What the diff knows about one method.
+struct MethodRecord {
+  std::string name;         // e.g. "Ljava/lang/Object;->equals(Ljava/lang/Object;)Z"
+  uint32_t access_flags;
+  uint32_t insns_size;      // in code units, 0 if the method has no code item
+  uint64_t code_hash;       // 0 if the method has no code item
+
+  bool IsStub() const {
+    return insns_size < kStubMaxCodeUnits;
+  }
+};
+
+static bool MethodRecordNameLess(const MethodRecord& lhs, const MethodRecord& rhs) {
+  return lhs.name < rhs.name;
+}
+
+static bool MethodRecordNameEquals(const MethodRecord& lhs, const MethodRecord& rhs) {
+  return lhs.name == rhs.name;
+}
+
+// Computes a fingerprint of a code item that does not depend on the layout of the dex file it
+// came from: string, type, field and method indices are hashed by what they name rather than by
+// their value, so the same method compiled into two differently-shaped dex files hashes the same.
+class MethodHasher {
+ public:
+  explicit MethodHasher(const DexFile& dex_file) : dex_file_(dex_file), hash_(0) {}
+
+  uint64_t HashCodeItem(const DexFile::CodeItem& code_item) {
+    hash_ = kFnvOffsetBasis;
+    Update(code_item.registers_size_);
+    Update(code_item.ins_size_);
+    Update(code_item.outs_size_);
+
+    const uint16_t* insns = code_item.insns_;
+    const uint32_t insns_size = code_item.insns_size_in_code_units_;
+    uint32_t dex_pc = 0;
+    while (dex_pc < insns_size) {
+      const Instruction* inst = Instruction::At(insns + dex_pc);
+      uint32_t size = std::min<uint32_t>(inst->SizeInCodeUnits(), insns_size - dex_pc);
+      uint32_t index_units = IndexUnits(inst);
+      if (index_units == 0 || size <= index_units) {
+        for (uint32_t i = 0; i < size; ++i) {
+          Update(insns[dex_pc + i]);
+        }
+      } else {
+        // The index operand always sits right after the first code unit.
+        uint32_t index = insns[dex_pc + 1];
+        if (index_units == 2) {
+          index |= static_cast<uint32_t>(insns[dex_pc + 2]) << 16;
+        }
+        Update(insns[dex_pc]);
+        UpdateReference(inst, index);
+        for (uint32_t i = 1 + index_units; i < size; ++i) {
+          Update(insns[dex_pc + i]);
+        }
+      }
+      dex_pc += size;
+    }
+
+    Update(code_item.tries_size_);
+    for (uint32_t i = 0; i < code_item.tries_size_; ++i) {
+      const DexFile::TryItem* try_item = DexFile::GetTryItems(code_item, i);
+      Update(try_item->start_addr_);
+      Update(try_item->insn_count_);
+      for (CatchHandlerIterator it(code_item, *try_item); it.HasNext(); it.Next()) {
+        UpdateType(it.GetHandlerTypeIndex());
+        Update(it.GetHandlerAddress());
+      }
+    }
+    return hash_;
+  }
+
+ private:
+  static const uint64_t kFnvOffsetBasis = 0xcbf29ce484222325ULL;
+  static const uint64_t kFnvPrime = 0x100000001b3ULL;
+
+  // Verifier flags marking a B or C operand as an index into one of the constant pools.
+  static const int kTypeRefB = Instruction::kVerifyRegBType | Instruction::kVerifyRegBNewInstance;
+  static const int kTypeRefC = Instruction::kVerifyRegCType | Instruction::kVerifyRegCNewArray;
+  static const int kRefB = Instruction::kVerifyRegBString | Instruction::kVerifyRegBField |
+                           Instruction::kVerifyRegBMethod | kTypeRefB;
+  static const int kRefC = Instruction::kVerifyRegCField | kTypeRefC;
+
+  // Returns how many code units of index operand "inst" carries, or 0 if it refers to nothing in
+  // the constant pools. Quickened instructions carry offsets, not indices, and are hashed as is.
+  static uint32_t IndexUnits(const Instruction* inst) {
+    if ((inst->GetVerifyTypeArgumentB() & kRefB) == 0 &&
+        (inst->GetVerifyTypeArgumentC() & kRefC) == 0) {
+      return 0;
+    }
+    switch (Instruction::FormatOf(inst->Opcode())) {
+      case Instruction::k21c:
+      case Instruction::k22c:
+      case Instruction::k35c:
+      case Instruction::k3rc:
+        return 1;
+      case Instruction::k31c:
+        return 2;
+      default:
+        return 0;
+    }
+  }
+
+  void UpdateBytes(const void* data, size_t length) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; ++i) {
+      hash_ = (hash_ ^ bytes[i]) * kFnvPrime;
+    }
+  }
+
+  void Update(uint32_t value) {
+    UpdateBytes(&value, sizeof(value));
+  }
+
+  void UpdateString(const char* str) {
+    // Include the terminator so that adjacent strings can't run together.
+    UpdateBytes(str, strlen(str) + 1);
+  }
+
+  void UpdateType(uint32_t type_idx) {
+    if (type_idx < dex_file_.NumTypeIds()) {
+      UpdateString(dex_file_.StringByTypeIdx(type_idx));
+    } else {
+      Update(type_idx);
+    }
+  }
+
+  void UpdateReference(const Instruction* inst, uint32_t index) {
+    int verify_b = inst->GetVerifyTypeArgumentB();
+    int verify_c = inst->GetVerifyTypeArgumentC();
+    if ((verify_b & Instruction::kVerifyRegBString) != 0) {
+      if (index < dex_file_.NumStringIds()) {
+        UpdateString(dex_file_.StringDataByIdx(index));
+        return;
+      }
+    } else if ((verify_b & kTypeRefB) != 0 || (verify_c & kTypeRefC) != 0) {
+      UpdateType(index);
+      return;
+    } else if ((verify_b & Instruction::kVerifyRegBField) != 0 ||
+               (verify_c & Instruction::kVerifyRegCField) != 0) {
+      if (index < dex_file_.NumFieldIds()) {
+        const DexFile::FieldId& field_id = dex_file_.GetFieldId(index);
+        UpdateString(dex_file_.GetFieldDeclaringClassDescriptor(field_id));
+        UpdateString(dex_file_.GetFieldName(field_id));
+        UpdateString(dex_file_.GetFieldTypeDescriptor(field_id));
+        return;
+      }
+    } else if ((verify_b & Instruction::kVerifyRegBMethod) != 0) {
+      if (index < dex_file_.NumMethodIds()) {
+        const DexFile::MethodId& method_id = dex_file_.GetMethodId(index);
+        UpdateString(dex_file_.GetMethodDeclaringClassDescriptor(method_id));
+        UpdateString(dex_file_.GetMethodName(method_id));
+        const DexFile::ProtoId& proto_id = dex_file_.GetProtoId(method_id.proto_idx_);
+        UpdateString(dex_file_.GetReturnTypeDescriptor(proto_id));
+        const DexFile::TypeList* params = dex_file_.GetProtoParameters(proto_id);
+        uint32_t num_params = (params != NULL) ? params->Size() : 0;
+        Update(num_params);
+        for (uint32_t i = 0; i < num_params; ++i) {
+          UpdateType(params->GetTypeItem(i).type_idx_);
+        }
+        return;
+      }
+    }
+    // Out-of-range index, or a reference kind we don't resolve: fall back to the raw value.
+    Update(index);
+  }
+
+  const DexFile& dex_file_;
+  uint64_t hash_;
+
+  DISALLOW_COPY_AND_ASSIGN(MethodHasher);
+};
+
+// Hashes the methods of a dex file on several threads. Class definitions are handed out one at a
+// time from a shared counter, and each thread writes only the slot of the class it claimed.
+class MethodTableBuilder {
+ public:
+  explicit MethodTableBuilder(const DexFile& dex_file)
+      : dex_file_(dex_file), per_class_(dex_file.NumClassDefs()), next_class_def_(0) {}
+
+  void Build(size_t thread_count, std::vector<MethodRecord>* methods) {
+    thread_count = std::max<size_t>(1, std::min(thread_count, per_class_.size()));
+    std::vector<pthread_t> threads(thread_count - 1);
+    for (size_t i = 0; i < threads.size(); ++i) {
+      CHECK_PTHREAD_CALL(pthread_create, (&threads[i], NULL, &Callback, this), "dexdiff worker");
+    }
+    Run();
+    for (size_t i = 0; i < threads.size(); ++i) {
+      CHECK_PTHREAD_CALL(pthread_join, (threads[i], NULL), "dexdiff worker shutdown");
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < per_class_.size(); ++i) {
+      count += per_class_[i].size();
+    }
+    methods->clear();
+    methods->reserve(count);
+    for (size_t i = 0; i < per_class_.size(); ++i) {
+      methods->insert(methods->end(), per_class_[i].begin(), per_class_[i].end());
+      std::vector<MethodRecord>().swap(per_class_[i]);
+    }
+
+    // A descriptor defined twice only ever resolves to its first definition, so keep that one.
+    std::stable_sort(methods->begin(), methods->end(), MethodRecordNameLess);
+    methods->erase(std::unique(methods->begin(), methods->end(), MethodRecordNameEquals),
+                   methods->end());
+  }
+
+ private:
+  static void* Callback(void* arg) {
+    reinterpret_cast<MethodTableBuilder*>(arg)->Run();
+    return NULL;
+  }
+
+  void Run() {
+    MethodHasher hasher(dex_file_);
+    while (true) {
+      int32_t class_def_index = next_class_def_.fetch_add(1);
+      if (class_def_index >= static_cast<int32_t>(per_class_.size())) {
+        break;
+      }
+      HashClass(class_def_index, &hasher);
+    }
+  }
+
+  void HashClass(size_t class_def_index, MethodHasher* hasher) {
+    const DexFile::ClassDef& class_def = dex_file_.GetClassDef(class_def_index);
+    const byte* class_data = dex_file_.GetClassData(class_def);
+    if (class_data == NULL) {
+      return;
+    }
+    std::vector<MethodRecord>& records = per_class_[class_def_index];
+    ClassDataItemIterator it(dex_file_, class_data);
+    while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+      it.Next();
+    }
+    records.reserve(it.NumDirectMethods() + it.NumVirtualMethods());
+    for (; it.HasNextDirectMethod() || it.HasNextVirtualMethod(); it.Next()) {
+      const DexFile::MethodId& method_id = dex_file_.GetMethodId(it.GetMemberIndex());
+      records.push_back(MethodRecord());
+      MethodRecord& record = records.back();
+      record.name = dex_file_.GetMethodDeclaringClassDescriptor(method_id);
+      record.name += "->";
+      record.name += dex_file_.GetMethodName(method_id);
+      record.name += dex_file_.GetMethodSignature(method_id);
+      record.access_flags = it.GetMemberAccessFlags();
+      const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+      if (code_item != NULL) {
+        record.insns_size = code_item->insns_size_in_code_units_;
+        record.code_hash = hasher->HashCodeItem(*code_item);
+      } else {
+        record.insns_size = 0;
+        record.code_hash = 0;
+      }
+    }
+  }
+
+  const DexFile& dex_file_;
+  std::vector<std::vector<MethodRecord> > per_class_;
+  AtomicInteger next_class_def_;
+
+  DISALLOW_COPY_AND_ASSIGN(MethodTableBuilder);
+};
+
+static std::string DescribeBody(const MethodRecord& record) {
+  if (record.insns_size == 0) {
+    if ((record.access_flags & kAccNative) != 0) {
+      return "native";
+    }
+    return ((record.access_flags & kAccAbstract) != 0) ? "abstract" : "no code";
+  }
+  return StringPrintf("%u code units", record.insns_size);
+}
+
+struct DiffCounts {
+  size_t added;
+  size_t removed;
+  size_t changed;
+  size_t stubbed;
+  size_t unchanged;
+};
+
+// Walks the two name-sorted method tables in step and reports the differences.
+static void DiffMethods(const std::vector<MethodRecord>& old_methods,
+                        const std::vector<MethodRecord>& new_methods,
+                        bool summary_only, std::ostream& os, DiffCounts* counts) {
+  memset(counts, 0, sizeof(*counts));
+  size_t i = 0;
+  size_t j = 0;
+  while (i < old_methods.size() || j < new_methods.size()) {
+    int cmp;
+    if (i == old_methods.size()) {
+      cmp = 1;
+    } else if (j == new_methods.size()) {
+      cmp = -1;
+    } else {
+      cmp = old_methods[i].name.compare(new_methods[j].name);
+    }
+
+    if (cmp < 0) {
+      counts->removed++;
+      if (!summary_only) {
+        os << "- " << old_methods[i].name << " (" << DescribeBody(old_methods[i]) << ")\n";
+      }
+      i++;
+    } else if (cmp > 0) {
+      counts->added++;
+      if (!summary_only) {
+        os << "+ " << new_methods[j].name << " (" << DescribeBody(new_methods[j]) << ")\n";
+      }
+      j++;
+    } else {
+      const MethodRecord& old_method = old_methods[i];
+      const MethodRecord& new_method = new_methods[j];
+      if (old_method.insns_size == new_method.insns_size &&
+          old_method.code_hash == new_method.code_hash) {
+        counts->unchanged++;
+      } else {
+        const char* tag;
+        if (old_method.IsStub() != new_method.IsStub()) {
+          counts->stubbed++;
+          tag = "S ";
+        } else {
+          counts->changed++;
+          tag = "M ";
+        }
+        if (!summary_only) {
+          os << tag << old_method.name << " (" << DescribeBody(old_method) << " -> "
+             << DescribeBody(new_method) << ")\n";
+        }
+      }
+      i++;
+      j++;
+    }
+  }
+}
+
+static bool HashDexFile(const char* filename, size_t thread_count,
+                        std::vector<MethodRecord>* methods) {
+  UniquePtr<const DexFile> dex_file(DexFile::Open(filename, filename));
+  if (dex_file.get() == NULL) {
+    fprintf(stderr, "Failed to open dex file from %s\n", filename);
+    return false;
+  }
+  MethodTableBuilder builder(*dex_file.get());
+  builder.Build(thread_count, methods);
+  return true;
+}
+
+static int dexdiff(int argc, char** argv) {
+  InitLogging(argv);
+
+  // Skip over argv[0].
+  argv++;
+  argc--;
+
+  if (argc == 0) {
+    fprintf(stderr, "No arguments specified\n");
+    usage();
+  }
+
+  std::vector<const char*> filenames;
+  int thread_count = sysconf(_SC_NPROCESSORS_CONF);
+  bool summary_only = false;
+  std::ostream* os = &std::cout;
+  UniquePtr<std::ofstream> out;
+
+  for (int i = 0; i < argc; i++) {
+    const StringPiece option(argv[i]);
+    if (option.starts_with("-j")) {
+      const char* thread_count_str = option.substr(strlen("-j")).data();
+      if (!ParseInt(thread_count_str, &thread_count) || thread_count < 1) {
+        fprintf(stderr, "Failed to parse -j argument '%s' as a positive integer\n",
+                thread_count_str);
+        usage();
+      }
+    } else if (option == "--summary") {
+      summary_only = true;
+    } else if (option.starts_with("--output=")) {
+      const char* filename = option.substr(strlen("--output=")).data();
+      out.reset(new std::ofstream(filename));
+      if (!out->good()) {
+        fprintf(stderr, "Failed to open output filename %s\n", filename);
+        usage();
+      }
+      os = out.get();
+    } else if (option.starts_with("-")) {
+      fprintf(stderr, "Unknown argument %s\n", option.data());
+      usage();
+    } else {
+      filenames.push_back(argv[i]);
+    }
+  }
+
+  if (filenames.size() != 2) {
+    fprintf(stderr, "Exactly two dex files must be specified\n");
+    usage();
+  }
+  if (thread_count < 1) {
+    thread_count = 1;
+  }
+
+  uint64_t start_ns = NanoTime();
+  std::vector<MethodRecord> old_methods;
+  std::vector<MethodRecord> new_methods;
+  if (!HashDexFile(filenames[0], thread_count, &old_methods) ||
+      !HashDexFile(filenames[1], thread_count, &new_methods)) {
+    return EXIT_FAILURE;
+  }
+
+  DiffCounts counts;
+  DiffMethods(old_methods, new_methods, summary_only, *os, &counts);
+  *os << StringPrintf("%zu added, %zu removed, %zu changed, %zu stubbed, %zu unchanged"
+                      " (%zu/%zu methods, %s)\n",
+                      counts.added, counts.removed, counts.changed, counts.stubbed,
+                      counts.unchanged, old_methods.size(), new_methods.size(),
+                      PrettyDuration(NanoTime() - start_ns).c_str());
+  os->flush();
+  return EXIT_SUCCESS;
+}
+
+}  // namespace art
+
+int main(int argc, char** argv) {
+  return art::dexdiff(argc, argv);
+}
@@ -14,14 +14,19 @@
  * limitations under the License.
  */
 
+#include <fnmatch.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
+#include "atomic_integer.h"
+#include "base/mutex.h"
 #include "base/stringpiece.h"
 #include "base/unix_file/fd_file.h"
 #include "class_linker.h"
@@ -48,6 +53,7 @@
 #include "runtime.h"
 #include "safe_map.h"
 #include "scoped_thread_state_change.h"
+#include "utils.h"
 #include "verifier/method_verifier.h"
 #include "vmap_table.h"
 
@@ -81,6 +87,22 @@ static void usage() {
           "  --output=<file> may be used to send the output to a file.\n"
           "      Example: --output=/tmp/oatdump.txt\n"
           "\n");
+  fprintf(stderr,
+          "  --class-filter=<glob>: only dump the oat data of classes whose descriptor or\n"
+          "      dotted name matches the glob. Other classes are skipped without being decoded.\n"
+          "      Example: --class-filter='Ljava/lang/String*'\n"
+          "      Example: --class-filter='java.util.*Map'\n"
+          "\n");
+  fprintf(stderr,
+          "  --method-filter=<glob>: only dump methods whose name matches the glob.\n"
+          "      Example: --method-filter='hash*'\n"
+          "\n");
+  fprintf(stderr,
+          "  -j<number>: specifies the number of threads used to dump classes. Output is still\n"
+          "      written in class order. Only applies with --oat-file.\n"
+          "      Example: -j4\n"
+          "      Default: 1\n"
+          "\n");
   exit(EXIT_FAILURE);
 }
 
@@ -92,16 +114,32 @@ const char* image_roots_descriptions_[] = {
   "kOatLocation",
   "kDexCaches",
   "kClassRoots",
+  "kClassIndex",
+};
+
+// Selects what OatDumper dumps, and how.
+struct OatDumperOptions {
+  OatDumperOptions() : thread_count(1) {}
+
+  // Globs matched against class descriptors (or dotted class names) and method names. Empty
+  // filters match everything.
+  std::string class_filter;
+  std::string method_filter;
+
+  // Number of threads dumping classes. More than one is only used without a Runtime, since the
+  // verifier output needs an attached thread.
+  size_t thread_count;
 };
 
 class OatDumper {
  public:
-  explicit OatDumper(const std::string& host_prefix, const OatFile& oat_file)
+  explicit OatDumper(const std::string& host_prefix, const OatFile& oat_file,
+                     const OatDumperOptions& options)
     : host_prefix_(host_prefix),
       oat_file_(oat_file),
       oat_dex_files_(oat_file.GetOatDexFiles()),
+      options_(options),
       disassembler_(Disassembler::Create(oat_file_.GetOatHeader().GetInstructionSet())) {
-    AddAllOffsets();
   }
 
   void Dump(std::ostream& os) {
@@ -156,6 +194,10 @@ class OatDumper {
         reinterpret_cast<const byte*>(oat_data) > oat_file_.End()) {
       return 0;  // Address not in oat file
     }
+    // Only the image statistics need sizes, so don't walk every method up front.
+    if (offsets_.empty()) {
+      AddAllOffsets();
+    }
     uint32_t begin_offset = reinterpret_cast<size_t>(oat_data) -
                             reinterpret_cast<size_t>(oat_file_.Begin());
     typedef std::set<uint32_t>::iterator It;
@@ -250,21 +292,159 @@ class OatDumper {
       os << "NOT FOUND\n\n";
       return;
     }
+
+    // Filter on the descriptor alone, so that skipped classes cost a string compare.
+    std::vector<size_t> class_def_indices;
     for (size_t class_def_index = 0; class_def_index < dex_file->NumClassDefs(); class_def_index++) {
       const DexFile::ClassDef& class_def = dex_file->GetClassDef(class_def_index);
-      const char* descriptor = dex_file->GetClassDescriptor(class_def);
-      UniquePtr<const OatFile::OatClass> oat_class(oat_dex_file.GetOatClass(class_def_index));
-      CHECK(oat_class.get() != NULL);
-      os << StringPrintf("%zd: %s (type_idx=%d) (", class_def_index, descriptor, class_def.class_idx_)
-         << oat_class->GetStatus() << ")\n";
-      Indenter indent_filter(os.rdbuf(), kIndentChar, kIndentBy1Count);
-      std::ostream indented_os(&indent_filter);
-      DumpOatClass(indented_os, *oat_class.get(), *(dex_file.get()), class_def);
+      if (ClassMatchesFilter(dex_file->GetClassDescriptor(class_def))) {
+        class_def_indices.push_back(class_def_index);
+      }
+    }
+
+    if (options_.thread_count > 1 && class_def_indices.size() > 1 && Runtime::Current() == NULL) {
+      os << std::flush;
+      DumpOatClassesParallel(os, oat_dex_file, *dex_file.get(), class_def_indices);
+    } else {
+      for (size_t i = 0; i < class_def_indices.size(); i++) {
+        DumpOatClassDef(os, oat_dex_file, *dex_file.get(), class_def_indices[i]);
+      }
     }
 
     os << std::flush;
   }
 
+  bool ClassMatchesFilter(const char* descriptor) {
+    if (options_.class_filter.empty()) {
+      return true;
+    }
+    return fnmatch(options_.class_filter.c_str(), descriptor, 0) == 0 ||
+        fnmatch(options_.class_filter.c_str(), PrettyDescriptor(descriptor).c_str(), 0) == 0;
+  }
+
+  bool MethodMatchesFilter(const DexFile& dex_file, uint32_t dex_method_idx) {
+    if (options_.method_filter.empty()) {
+      return true;
+    }
+    const char* name = dex_file.GetMethodName(dex_file.GetMethodId(dex_method_idx));
+    return fnmatch(options_.method_filter.c_str(), name, 0) == 0;
+  }
+
+  void DumpOatClassDef(std::ostream& os, const OatFile::OatDexFile& oat_dex_file,
+                       const DexFile& dex_file, size_t class_def_index) {
+    const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_index);
+    const char* descriptor = dex_file.GetClassDescriptor(class_def);
+    UniquePtr<const OatFile::OatClass> oat_class(oat_dex_file.GetOatClass(class_def_index));
+    CHECK(oat_class.get() != NULL);
+    os << StringPrintf("%zd: %s (type_idx=%d) (", class_def_index, descriptor, class_def.class_idx_)
+       << oat_class->GetStatus() << ")\n";
+    Indenter indent_filter(os.rdbuf(), kIndentChar, kIndentBy1Count);
+    std::ostream indented_os(&indent_filter);
+    DumpOatClass(indented_os, *oat_class.get(), dex_file, class_def);
+  }
+
+  // Work shared between DumpOatClassesParallel and its worker threads. Workers claim classes
+  // from next_, dump each into a string, and publish it; the caller writes the strings out in
+  // order. Workers stay at most kParallelDumpWindow classes ahead of the writer, which bounds
+  // the amount of buffered output.
+  //
+  // The workers are raw pthreads that are never attached to a runtime (there is none when this
+  // is used), so they synchronize with plain pthread primitives rather than art::Mutex, whose
+  // lock level checks want a Thread*.
+  class ParallelDump {
+   public:
+    ParallelDump(OatDumper* dumper, const OatFile::OatDexFile& oat_dex_file,
+                 const DexFile& dex_file, const std::vector<size_t>& class_def_indices)
+        : dumper_(dumper), oat_dex_file_(oat_dex_file), dex_file_(dex_file),
+          class_def_indices_(class_def_indices), next_(0),
+          written_(0), output_(class_def_indices.size()), done_(class_def_indices.size(), false) {
+      CHECK_PTHREAD_CALL(pthread_mutex_init, (&lock_, NULL), "oatdump parallel dump lock");
+      CHECK_PTHREAD_CALL(pthread_cond_init, (&cond_, NULL), "oatdump parallel dump condition");
+    }
+
+    ~ParallelDump() {
+      CHECK_PTHREAD_CALL(pthread_cond_destroy, (&cond_), "oatdump parallel dump condition");
+      CHECK_PTHREAD_CALL(pthread_mutex_destroy, (&lock_), "oatdump parallel dump lock");
+    }
+
+    static void* Callback(void* arg) {
+      reinterpret_cast<ParallelDump*>(arg)->Run();
+      return NULL;
+    }
+
+    void Run() {
+      while (true) {
+        size_t i = next_.fetch_add(1);
+        if (i >= class_def_indices_.size()) {
+          break;
+        }
+        CHECK_PTHREAD_CALL(pthread_mutex_lock, (&lock_), "oatdump worker wait");
+        while (i >= written_ + kParallelDumpWindow) {
+          CHECK_PTHREAD_CALL(pthread_cond_wait, (&cond_, &lock_), "oatdump worker wait");
+        }
+        CHECK_PTHREAD_CALL(pthread_mutex_unlock, (&lock_), "oatdump worker wait");
+
+        std::ostringstream oss;
+        dumper_->DumpOatClassDef(oss, oat_dex_file_, dex_file_, class_def_indices_[i]);
+        std::string result(oss.str());
+
+        CHECK_PTHREAD_CALL(pthread_mutex_lock, (&lock_), "oatdump worker publish");
+        output_[i].swap(result);
+        done_[i] = true;
+        CHECK_PTHREAD_CALL(pthread_cond_broadcast, (&cond_), "oatdump worker publish");
+        CHECK_PTHREAD_CALL(pthread_mutex_unlock, (&lock_), "oatdump worker publish");
+      }
+    }
+
+    void WriteInOrder(std::ostream& os) {
+      for (size_t i = 0; i < class_def_indices_.size(); i++) {
+        std::string result;
+        CHECK_PTHREAD_CALL(pthread_mutex_lock, (&lock_), "oatdump writer");
+        while (!done_[i]) {
+          CHECK_PTHREAD_CALL(pthread_cond_wait, (&cond_, &lock_), "oatdump writer");
+        }
+        output_[i].swap(result);
+        written_ = i + 1;
+        CHECK_PTHREAD_CALL(pthread_cond_broadcast, (&cond_), "oatdump writer");
+        CHECK_PTHREAD_CALL(pthread_mutex_unlock, (&lock_), "oatdump writer");
+        os << result;
+      }
+    }
+
+   private:
+    static const size_t kParallelDumpWindow = 64;
+
+    OatDumper* const dumper_;
+    const OatFile::OatDexFile& oat_dex_file_;
+    const DexFile& dex_file_;
+    const std::vector<size_t>& class_def_indices_;
+    AtomicInteger next_;
+    pthread_mutex_t lock_;
+    pthread_cond_t cond_;  // Broadcast when a class is published or written out.
+    size_t written_;  // The rest are guarded by lock_.
+    std::vector<std::string> output_;
+    std::vector<bool> done_;
+
+    DISALLOW_COPY_AND_ASSIGN(ParallelDump);
+  };
+
+  // Dumps the given classes on options_.thread_count worker threads. The disassemblers keep no
+  // state between instructions, so the workers share disassembler_.
+  void DumpOatClassesParallel(std::ostream& os, const OatFile::OatDexFile& oat_dex_file,
+                              const DexFile& dex_file,
+                              const std::vector<size_t>& class_def_indices) {
+    ParallelDump dump(this, oat_dex_file, dex_file, class_def_indices);
+    std::vector<pthread_t> threads(std::min(options_.thread_count, class_def_indices.size()));
+    for (size_t i = 0; i < threads.size(); i++) {
+      CHECK_PTHREAD_CALL(pthread_create, (&threads[i], NULL, &ParallelDump::Callback, &dump),
+                         "oatdump worker");
+    }
+    dump.WriteInOrder(os);
+    for (size_t i = 0; i < threads.size(); i++) {
+      CHECK_PTHREAD_CALL(pthread_join, (threads[i], NULL), "oatdump worker shutdown");
+    }
+  }
+
   static void SkipAllFields(ClassDataItemIterator& it) {
     while (it.HasNextStaticField()) {
       it.Next();
@@ -284,16 +464,20 @@ class OatDumper {
     SkipAllFields(it);
     uint32_t class_method_idx = 0;
     while (it.HasNextDirectMethod()) {
-      const OatFile::OatMethod oat_method = oat_class.GetOatMethod(class_method_idx);
-      DumpOatMethod(os, class_def, class_method_idx, oat_method, dex_file,
-                    it.GetMemberIndex(), it.GetMethodCodeItem(), it.GetMemberAccessFlags());
+      if (MethodMatchesFilter(dex_file, it.GetMemberIndex())) {
+        const OatFile::OatMethod oat_method = oat_class.GetOatMethod(class_method_idx);
+        DumpOatMethod(os, class_def, class_method_idx, oat_method, dex_file,
+                      it.GetMemberIndex(), it.GetMethodCodeItem(), it.GetMemberAccessFlags());
+      }
       class_method_idx++;
       it.Next();
     }
     while (it.HasNextVirtualMethod()) {
-      const OatFile::OatMethod oat_method = oat_class.GetOatMethod(class_method_idx);
-      DumpOatMethod(os, class_def, class_method_idx, oat_method, dex_file,
-                    it.GetMemberIndex(), it.GetMethodCodeItem(), it.GetMemberAccessFlags());
+      if (MethodMatchesFilter(dex_file, it.GetMemberIndex())) {
+        const OatFile::OatMethod oat_method = oat_class.GetOatMethod(class_method_idx);
+        DumpOatMethod(os, class_def, class_method_idx, oat_method, dex_file,
+                      it.GetMemberIndex(), it.GetMethodCodeItem(), it.GetMemberAccessFlags());
+      }
       class_method_idx++;
       it.Next();
     }
@@ -656,6 +840,7 @@ class OatDumper {
   const std::string host_prefix_;
   const OatFile& oat_file_;
   std::vector<const OatFile::OatDexFile*> oat_dex_files_;
+  const OatDumperOptions options_;
   std::set<uint32_t> offsets_;
   UniquePtr<Disassembler> disassembler_;
 };
@@ -664,9 +849,9 @@ class ImageDumper {
  public:
   explicit ImageDumper(std::ostream* os, const std::string& image_filename,
                        const std::string& host_prefix, gc::space::ImageSpace& image_space,
-                       const ImageHeader& image_header)
+                       const ImageHeader& image_header, const OatDumperOptions& oat_options)
       : os_(os), image_filename_(image_filename), host_prefix_(host_prefix),
-        image_space_(image_space), image_header_(image_header) {}
+        image_space_(image_space), image_header_(image_header), oat_options_(oat_options) {}
 
   void Dump() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     std::ostream& os = *os_;
@@ -736,7 +921,7 @@ class ImageDumper {
 
     stats_.oat_file_bytes = oat_file->Size();
 
-    oat_dumper_.reset(new OatDumper(host_prefix_, *oat_file));
+    oat_dumper_.reset(new OatDumper(host_prefix_, *oat_file, oat_options_));
 
     for (const OatFile::OatDexFile* oat_dex_file : oat_file->GetOatDexFiles()) {
       CHECK(oat_dex_file != NULL);
@@ -1344,6 +1529,7 @@ class ImageDumper {
   const std::string host_prefix_;
   gc::space::ImageSpace& image_space_;
   const ImageHeader& image_header_;
+  const OatDumperOptions oat_options_;
 
   DISALLOW_COPY_AND_ASSIGN(ImageDumper);
 };
@@ -1367,6 +1553,7 @@ static int oatdump(int argc, char** argv) {
   UniquePtr<std::string> host_prefix;
   std::ostream* os = &std::cout;
   UniquePtr<std::ofstream> out;
+  OatDumperOptions oat_options;
 
   for (int i = 0; i < argc; i++) {
     const StringPiece option(argv[i]);
@@ -1386,6 +1573,19 @@ static int oatdump(int argc, char** argv) {
         usage();
       }
       os = out.get();
+    } else if (option.starts_with("--class-filter=")) {
+      oat_options.class_filter = option.substr(strlen("--class-filter=")).data();
+    } else if (option.starts_with("--method-filter=")) {
+      oat_options.method_filter = option.substr(strlen("--method-filter=")).data();
+    } else if (option.starts_with("-j")) {
+      const char* thread_count_str = option.substr(strlen("-j")).data();
+      int thread_count;
+      if (!ParseInt(thread_count_str, &thread_count) || thread_count < 1) {
+        fprintf(stderr, "Failed to parse -j argument '%s' as a positive integer\n",
+                thread_count_str);
+        usage();
+      }
+      oat_options.thread_count = thread_count;
     } else {
       fprintf(stderr, "Unknown argument %s\n", option.data());
       usage();
@@ -1418,7 +1618,7 @@ static int oatdump(int argc, char** argv) {
       fprintf(stderr, "Failed to open oat file from %s\n", oat_filename);
       return EXIT_FAILURE;
     }
-    OatDumper oat_dumper(*host_prefix.get(), *oat_file);
+    OatDumper oat_dumper(*host_prefix.get(), *oat_file, oat_options);
     oat_dumper.Dump(*os);
     return EXIT_SUCCESS;
   }
@@ -1465,7 +1665,8 @@ static int oatdump(int argc, char** argv) {
     fprintf(stderr, "Invalid image header %s\n", image_filename);
     return EXIT_FAILURE;
   }
-  ImageDumper image_dumper(os, image_filename, *host_prefix.get(), *image_space, image_header);
+  ImageDumper image_dumper(os, image_filename, *host_prefix.get(), *image_space, image_header,
+                           oat_options);
   image_dumper.Dump();
   return EXIT_SUCCESS;
 }
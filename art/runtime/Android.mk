@@ -21,6 +21,7 @@ include art/build/Android.common.mk
 LIBART_COMMON_SRC_FILES := \
 	atomic.cc.arm \
 	barrier.cc \
+	base/crc32.cc \
 	base/logging.cc \
 	base/mutex.cc \
 	base/stringpiece.cc \
@@ -33,9 +34,12 @@ LIBART_COMMON_SRC_FILES := \
 	base/unix_file/string_file.cc \
 	check_jni.cc \
 	class_linker.cc \
+	class_table.cc \
 	common_throws.cc \
 	debugger.cc \
+	dex_cache_index.cc \
 	dex_file.cc \
+	dex_file_verification_cache.cc \
 	dex_file_verifier.cc \
 	dex_instruction.cc \
 	disassembler.cc \
@@ -60,6 +64,7 @@ LIBART_COMMON_SRC_FILES := \
 	gc/space/space.cc \
 	hprof/hprof.cc \
 	image.cc \
+	image_class_index.cc \
 	indirect_reference_table.cc \
 	instrumentation.cc \
 	intern_table.cc \
@@ -73,6 +78,7 @@ LIBART_COMMON_SRC_FILES := \
 	jdwp/object_registry.cc \
 	jni_internal.cc \
 	jobject_comparator.cc \
+	line_number_cache.cc \
 	locks.cc \
 	mem_map.cc \
 	memory_region.cc \
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "crc32.h"
+
+#include <string.h>
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+namespace art {
+
+#if defined(__ARM_FEATURE_CRC32)
+
+uint32_t ComputeCrc32(uint32_t crc, const void* data, size_t length) {
+  const uint8_t* ptr = reinterpret_cast<const uint8_t*>(data);
+  crc = ~crc;
+  while (length != 0 && (reinterpret_cast<uintptr_t>(ptr) & 3) != 0) {
+    crc = __crc32b(crc, *ptr++);
+    --length;
+  }
+  while (length >= 4) {
+    crc = __crc32w(crc, *reinterpret_cast<const uint32_t*>(ptr));
+    ptr += 4;
+    length -= 4;
+  }
+  while (length != 0) {
+    crc = __crc32b(crc, *ptr++);
+    --length;
+  }
+  return ~crc;
+}
+
+#else
+
+// Reflected CRC-32 polynomial used by zip.
+static const uint32_t kCrc32Polynomial = 0xedb88320;
+
+// tables[0] is the usual byte-at-a-time table; tables[k][b] is the CRC of byte b followed by k
+// zero bytes, which lets the main loop fold eight bytes at once.
+struct Crc32Tables {
+  uint32_t tables[8][256];
+
+  Crc32Tables() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ ((crc & 1) != 0 ? kCrc32Polynomial : 0);
+      }
+      tables[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+      for (int k = 1; k < 8; ++k) {
+        tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xff];
+      }
+    }
+  }
+};
+
+uint32_t ComputeCrc32(uint32_t crc, const void* data, size_t length) {
+  static const Crc32Tables crc32_tables;
+  const uint32_t (*t)[256] = crc32_tables.tables;
+  const uint8_t* ptr = reinterpret_cast<const uint8_t*>(data);
+  crc = ~crc;
+  while (length != 0 && (reinterpret_cast<uintptr_t>(ptr) & 3) != 0) {
+    crc = t[0][(crc ^ *ptr++) & 0xff] ^ (crc >> 8);
+    --length;
+  }
+  // Words are read little-endian, like every target ART supports.
+  while (length >= 8) {
+    uint32_t lo;
+    uint32_t hi;
+    memcpy(&lo, ptr, sizeof(lo));
+    memcpy(&hi, ptr + 4, sizeof(hi));
+    lo ^= crc;
+    crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+          t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    ptr += 8;
+    length -= 8;
+  }
+  while (length != 0) {
+    crc = t[0][(crc ^ *ptr++) & 0xff] ^ (crc >> 8);
+    --length;
+  }
+  return ~crc;
+}
+
+#endif
+
+}  // namespace art
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_BASE_CRC32_H_
+#define ART_RUNTIME_BASE_CRC32_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace art {
+
+// Continues the zip/zlib CRC-32 "crc" over length bytes at data, so that
+// ComputeCrc32(ComputeCrc32(0, a, n), b, m) is the CRC of a followed by b. Gives the same results
+// as zlib's crc32(), using the ARMv8 CRC32 instructions when the target has them and
+// slicing-by-8 tables otherwise.
+uint32_t ComputeCrc32(uint32_t crc, const void* data, size_t length);
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_BASE_CRC32_H_
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "crc32.h"
+
+#include <zlib.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace art {
+
+TEST(Crc32Test, KnownValues) {
+  EXPECT_EQ(0U, ComputeCrc32(0, "", 0));
+  EXPECT_EQ(0xcbf43926U, ComputeCrc32(0, "123456789", 9));
+}
+
+TEST(Crc32Test, MatchesZlib) {
+  std::vector<uint8_t> data(4096 + 64);
+  uint32_t seed = 12345;
+  for (size_t i = 0; i < data.size(); ++i) {
+    seed = seed * 1103515245 + 12345;
+    data[i] = seed >> 16;
+  }
+  // Every start alignment and a spread of lengths, including the byte-at-a-time head and tail.
+  for (size_t offset = 0; offset < 16; ++offset) {
+    for (size_t length = 0; length <= 64; ++length) {
+      EXPECT_EQ(crc32(0, &data[offset], length), ComputeCrc32(0, &data[offset], length));
+    }
+    size_t length = data.size() - offset;
+    EXPECT_EQ(crc32(0, &data[offset], length), ComputeCrc32(0, &data[offset], length));
+  }
+}
+
+TEST(Crc32Test, Incremental) {
+  std::vector<uint8_t> data(1000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = i * 7;
+  }
+  uint32_t whole = ComputeCrc32(0, &data[0], data.size());
+  for (size_t split = 0; split <= data.size(); split += 37) {
+    uint32_t crc = ComputeCrc32(0, &data[0], split);
+    crc = ComputeCrc32(crc, &data[split], data.size() - split);
+    EXPECT_EQ(whole, crc);
+  }
+}
+
+}  // namespace art
@@ -22,22 +22,26 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#include <algorithm>
 #include <deque>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "atomic.h"
 #include "base/casts.h"
 #include "base/logging.h"
 #include "base/stl_util.h"
 #include "base/unix_file/fd_file.h"
 #include "class_linker-inl.h"
+#include "cutils/atomic-inline.h"
 #include "debugger.h"
 #include "dex_file-inl.h"
 #include "gc/accounting/card_table-inl.h"
 #include "gc/accounting/heap_bitmap.h"
 #include "gc/heap.h"
 #include "gc/space/image_space.h"
+#include "image_class_index.h"
 #include "intern_table.h"
 #include "interpreter/interpreter.h"
 #include "leb128.h"
@@ -63,7 +67,9 @@
 #include "sirt_ref.h"
 #include "stack_indirect_reference_table.h"
 #include "thread.h"
+#include "thread_pool.h"
 #include "UniquePtr.h"
+#include "utf.h"
 #include "utils.h"
 #include "verifier/method_verifier.h"
 #include "well_known_classes.h"
@@ -124,13 +130,19 @@ static void WrapExceptionInInitializer() SHARED_LOCKS_REQUIRED(Locks::mutator_lo
 }
 
 static size_t Hash(const char* s) {
-  // This is the java.lang.String hashcode for convenience, not interoperability.
-  size_t hash = 0;
-  for (; *s != '\0'; ++s) {
-    hash = hash * 31 + *s;
-  }
-  return hash;
-}
+  // This is the java.lang.String hashcode for convenience, not interoperability. The image class
+  // index is built with the same hash.
+  return ComputeModifiedUtf8Hash(s);
+}
+
+const char* ClassLinker::class_loading_phase_names_[] = {
+  "FindClass",
+  "DefineClass",
+  "LoadClass",
+  "LinkClass",
+  "VerifyClass",
+  "InitializeClass",
+};
 
 const char* ClassLinker::class_roots_descriptors_[] = {
   "Ljava/lang/Class;",
@@ -188,7 +200,6 @@ ClassLinker::ClassLinker(InternTable* intern_table)
     // dex_lock_ is recursive as it may be used in stack dumping.
     : dex_lock_("ClassLinker dex lock", kDefaultMutexLevel),
       dex_cache_image_class_lookup_required_(false),
-      failed_dex_cache_class_lookups_(0),
       class_roots_(NULL),
       array_iftable_(NULL),
       init_done_(false),
@@ -198,6 +209,82 @@ ClassLinker::ClassLinker(InternTable* intern_table)
       portable_resolution_trampoline_(NULL),
       quick_resolution_trampoline_(NULL) {
   CHECK_EQ(arraysize(class_roots_descriptors_), size_t(kClassRootsMax));
+  CHECK_EQ(arraysize(class_loading_phase_names_), size_t(kClassLoadingPhaseCount));
+  for (size_t i = 0; i < kClassLoadingPhaseCount; ++i) {
+    boot_class_loading_times_[i].total_ns = 0;
+    app_class_loading_times_[i].total_ns = 0;
+  }
+}
+
+// Adds the time between its construction and destruction to the histogram of a class loading
+// phase. Two NanoTime calls and two atomic adds are small next to loading a class.
+class ScopedClassLoadingTimer {
+ public:
+  ScopedClassLoadingTimer(ClassLinker* class_linker, ClassLinker::ClassLoadingPhase phase,
+                          const mirror::ClassLoader* class_loader)
+      : class_linker_(class_linker), phase_(phase), boot_class_loader_(class_loader == NULL),
+        start_ns_(NanoTime()) {
+  }
+
+  ~ScopedClassLoadingTimer() {
+    class_linker_->AddClassLoadingTime(phase_, boot_class_loader_, NanoTime() - start_ns_);
+  }
+
+ private:
+  ClassLinker* const class_linker_;
+  const ClassLinker::ClassLoadingPhase phase_;
+  const bool boot_class_loader_;
+  const uint64_t start_ns_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedClassLoadingTimer);
+};
+
+void ClassLinker::AddClassLoadingTime(ClassLoadingPhase phase, bool boot_class_loader,
+                                      uint64_t duration_ns) {
+  DCHECK_LT(phase, kClassLoadingPhaseCount);
+  ClassLoadingTimes& times =
+      boot_class_loader ? boot_class_loading_times_[phase] : app_class_loading_times_[phase];
+  uint64_t duration_us = duration_ns / 1000;
+  size_t bucket = (duration_us == 0) ? 0 : 64 - __builtin_clzll(duration_us);
+  times.buckets[std::min(bucket, kClassLoadingTimeBuckets - 1)]++;
+  int64_t total_ns;
+  do {
+    total_ns = QuasiAtomic::Read64(&times.total_ns);
+  } while (!QuasiAtomic::Cas64(total_ns, total_ns + duration_ns, &times.total_ns));
+}
+
+void ClassLinker::DumpClassLoadingTimes(std::ostream& os) {
+  // The counts are read while other threads may still be adding to them, so the totals can be a
+  // few runs apart; that is fine for a diagnostic dump.
+  os << "Class loading times:\n";
+  for (size_t boot = 0; boot < 2; ++boot) {
+    for (size_t i = 0; i < kClassLoadingPhaseCount; ++i) {
+      const ClassLoadingTimes& times =
+          (boot == 0) ? boot_class_loading_times_[i] : app_class_loading_times_[i];
+      int32_t counts[kClassLoadingTimeBuckets];
+      size_t sample_size = 0;
+      for (size_t b = 0; b < kClassLoadingTimeBuckets; ++b) {
+        counts[b] = times.buckets[b].load();
+        sample_size += counts[b];
+      }
+      if (sample_size == 0) {
+        continue;
+      }
+      os << ((boot == 0) ? "boot " : "app ") << class_loading_phase_names_[i] << ": "
+         << sample_size << " in " << PrettyDuration(QuasiAtomic::Read64(&times.total_ns)) << "\n";
+      for (size_t b = 0; b < kClassLoadingTimeBuckets; ++b) {
+        if (counts[b] == 0) {
+          continue;
+        }
+        if (b + 1 < kClassLoadingTimeBuckets) {
+          os << "  < " << PrettyDuration(UINT64_C(1000) << b);
+        } else {
+          os << "  >= " << PrettyDuration(UINT64_C(1000) << (b - 1));
+        }
+        os << ": " << counts[b] << "\n";
+      }
+    }
+  }
 }
 
 void ClassLinker::InitFromCompiler(const std::vector<const DexFile*>& boot_class_path) {
@@ -516,6 +603,10 @@ void ClassLinker::FinishInit() {
     mirror::Class* klass = GetClassRoot(class_root);
     CHECK(klass != NULL);
     DCHECK(klass->IsArrayClass() || klass->IsPrimitive() || klass->GetDexCache() != NULL);
+    // The classes created by hand while bootstrapping haven't been linked.
+    if (!klass->HasTypeCheckData()) {
+      klass->SetUpTypeCheckData();
+    }
     // note SetClassRoot does additional validation.
     // if possible add new checks there to catch errors early
   }
@@ -1111,9 +1202,7 @@ void ClassLinker::VisitRoots(RootVisitor* visitor, void* arg, bool only_dirty, b
   {
     ReaderMutexLock mu(self, *Locks::classlinker_classes_lock_);
     if (!only_dirty || class_table_dirty_) {
-      for (const std::pair<size_t, mirror::Class*>& it : class_table_) {
-        visitor(it.second, arg);
-      }
+      class_table_.VisitRoots(visitor, arg);
       if (clean_dirty) {
         class_table_dirty_ = false;
       }
@@ -1123,6 +1212,12 @@ void ClassLinker::VisitRoots(RootVisitor* visitor, void* arg, bool only_dirty, b
     // handle image roots by using the MS/CMS rescanning of dirty cards.
   }
 
+  if (Locks::mutator_lock_->IsExclusiveHeld(self)) {
+    // No thread can be in a lock-free class table lookup while the world is stopped.
+    WriterMutexLock mu(self, *Locks::classlinker_classes_lock_);
+    class_table_.FreeRetiredSlots();
+  }
+
   visitor(array_iftable_, arg);
 }
 
@@ -1131,11 +1226,8 @@ void ClassLinker::VisitClasses(ClassVisitor* visitor, void* arg) {
     MoveImageClassesToClassTable();
   }
   ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  for (const std::pair<size_t, mirror::Class*>& it : class_table_) {
-    if (!visitor(it.second, arg)) {
-      return;
-    }
-  }
+  auto visit = [visitor, arg](mirror::Class* klass) { return visitor(klass, arg); };
+  class_table_.VisitClasses(visit);
 }
 
 static bool GetClassesVisitor(mirror::Class* c, void* arg) {
@@ -1297,6 +1389,207 @@ mirror::Class* ClassLinker::FindSystemClass(const char* descriptor) {
   return FindClass(descriptor, NULL);
 }
 
+// Appends to dependencies the descriptors of the classes that must be loaded before the boot
+// class with the given descriptor can be linked.
+static void GetBootClassDependencies(const std::string& descriptor,
+                                     const std::vector<const DexFile*>& boot_class_path,
+                                     std::vector<std::string>* dependencies) {
+  if (descriptor[0] == '[') {
+    dependencies->push_back(descriptor.substr(1));
+    return;
+  }
+  DexFile::ClassPathEntry pair = DexFile::FindInClassPath(descriptor.c_str(), boot_class_path);
+  if (pair.second == NULL) {
+    return;
+  }
+  const DexFile& dex_file = *pair.first;
+  const DexFile::ClassDef& class_def = *pair.second;
+  if (class_def.superclass_idx_ != DexFile::kDexNoIndex16) {
+    dependencies->push_back(dex_file.StringByTypeIdx(class_def.superclass_idx_));
+  }
+  const DexFile::TypeList* interfaces = dex_file.GetInterfacesList(class_def);
+  if (interfaces != NULL) {
+    for (size_t i = 0; i < interfaces->Size(); ++i) {
+      dependencies->push_back(dex_file.StringByTypeIdx(interfaces->GetTypeItem(i).type_idx_));
+    }
+  }
+}
+
+// Hands out the classes of a FindSystemClasses call in dependency order. Each class counts the
+// listed classes it depends on that haven't been loaded yet, and becomes ready to load when the
+// count drops to zero.
+class BulkClassLoader {
+ public:
+  BulkClassLoader(ClassLinker* class_linker, const std::vector<std::string>& descriptors,
+                  const std::vector<const DexFile*>& boot_class_path)
+      : class_linker_(class_linker),
+        descriptors_(descriptors),
+        lock_("Bulk class loading lock"),
+        ready_condition_("Bulk class loading condition", lock_),
+        nodes_(descriptors.size()),
+        loaded_(descriptors.size(), false),
+        num_done_(0),
+        num_loaded_(0) {
+    SafeMap<std::string, size_t> indices;
+    for (size_t i = 0; i < descriptors.size(); ++i) {
+      if (indices.find(descriptors[i]) == indices.end()) {
+        indices.Put(descriptors[i], i);
+      }
+    }
+    std::vector<std::string> dependencies;
+    for (size_t i = 0; i < descriptors.size(); ++i) {
+      dependencies.clear();
+      GetBootClassDependencies(descriptors[i], boot_class_path, &dependencies);
+      for (const std::string& dependency : dependencies) {
+        auto it = indices.find(dependency);
+        if (it != indices.end() && it->second != i) {
+          nodes_[it->second].dependents.push_back(i);
+          ++nodes_[i].num_pending;
+        }
+      }
+    }
+    BreakCycles();
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+      if (nodes_[i].num_pending == 0) {
+        ready_.push_back(i);
+      }
+    }
+  }
+
+  void Work(Thread* self) LOCKS_EXCLUDED(Locks::mutator_lock_) {
+    size_t index;
+    while (TakeReady(self, &index)) {
+      bool found;
+      {
+        ScopedObjectAccess soa(self);
+        found = class_linker_->FindSystemClass(descriptors_[index].c_str()) != NULL;
+        if (!found) {
+          VLOG(class_linker) << "Failed to find class " << descriptors_[index];
+          self->ClearException();
+        }
+      }
+      Finish(self, index, found);
+    }
+  }
+
+  size_t GetResults(Thread* self, std::vector<bool>* loaded) {
+    MutexLock mu(self, lock_);
+    CHECK_EQ(num_done_, nodes_.size());
+    if (loaded != NULL) {
+      *loaded = loaded_;
+    }
+    return num_loaded_;
+  }
+
+ private:
+  struct Node {
+    Node() : num_pending(0) {}
+
+    // Listed dependencies that haven't been loaded yet.
+    size_t num_pending;
+    // The listed classes that depend on this one.
+    std::vector<size_t> dependents;
+  };
+
+  // A malformed boot class path could make classes depend on each other. Let those start right
+  // away, loading them reports the circularity.
+  void BreakCycles() {
+    std::vector<size_t> num_pending(nodes_.size());
+    std::vector<size_t> order;
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+      num_pending[i] = nodes_[i].num_pending;
+      if (num_pending[i] == 0) {
+        order.push_back(i);
+      }
+    }
+    for (size_t k = 0; k < order.size(); ++k) {
+      for (size_t dependent : nodes_[order[k]].dependents) {
+        if (--num_pending[dependent] == 0) {
+          order.push_back(dependent);
+        }
+      }
+    }
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+      if (num_pending[i] != 0) {
+        nodes_[i].num_pending = 0;
+      }
+    }
+  }
+
+  // Waits for a class to be ready, returning false once all of them have been loaded.
+  bool TakeReady(Thread* self, size_t* index) {
+    MutexLock mu(self, lock_);
+    while (ready_.empty() && num_done_ != nodes_.size()) {
+      ready_condition_.Wait(self);
+    }
+    if (ready_.empty()) {
+      return false;
+    }
+    *index = ready_.front();
+    ready_.pop_front();
+    return true;
+  }
+
+  void Finish(Thread* self, size_t index, bool found) {
+    MutexLock mu(self, lock_);
+    loaded_[index] = found;
+    if (found) {
+      ++num_loaded_;
+    }
+    for (size_t dependent : nodes_[index].dependents) {
+      Node& node = nodes_[dependent];
+      // Classes started early by BreakCycles are already at zero.
+      if (node.num_pending != 0 && --node.num_pending == 0) {
+        ready_.push_back(dependent);
+      }
+    }
+    ++num_done_;
+    ready_condition_.Broadcast(self);
+  }
+
+  ClassLinker* const class_linker_;
+  const std::vector<std::string>& descriptors_;
+  Mutex lock_;
+  ConditionVariable ready_condition_ GUARDED_BY(lock_);
+  std::vector<Node> nodes_ GUARDED_BY(lock_);
+  std::deque<size_t> ready_ GUARDED_BY(lock_);
+  std::vector<bool> loaded_ GUARDED_BY(lock_);
+  size_t num_done_ GUARDED_BY(lock_);
+  size_t num_loaded_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(BulkClassLoader);
+};
+
+class BulkClassLoaderTask : public Task {
+ public:
+  explicit BulkClassLoaderTask(BulkClassLoader* loader) : loader_(loader) {}
+
+  virtual void Run(Thread* self) {
+    loader_->Work(self);
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  BulkClassLoader* const loader_;
+};
+
+size_t ClassLinker::FindSystemClasses(Thread* self, const std::vector<std::string>& descriptors,
+                                      ThreadPool* thread_pool, std::vector<bool>* loaded) {
+  // Workers take the mutator lock themselves for each class.
+  CHECK_NE(self->GetState(), kRunnable);
+  BulkClassLoader loader(this, descriptors, boot_class_path_);
+  // One task for each worker and one for the calling thread.
+  for (size_t i = 0; i <= thread_pool->GetThreadCount(); ++i) {
+    thread_pool->AddTask(self, new BulkClassLoaderTask(&loader));
+  }
+  thread_pool->StartWorkers(self);
+  thread_pool->Wait(self, true, false);
+  return loader.GetResults(self, loaded);
+}
+
 mirror::Class* ClassLinker::FindClass(const char* descriptor, mirror::ClassLoader* class_loader) {
   DCHECK_NE(*descriptor, '\0') << "descriptor is empty string";
   Thread* self = Thread::Current();
@@ -1313,6 +1606,7 @@ mirror::Class* ClassLinker::FindClass(const char* descriptor, mirror::ClassLoade
     return EnsureResolved(self, klass);
   }
   // Class is not yet loaded.
+  ScopedClassLoadingTimer timer(this, kFindClassPhase, class_loader);
   if (descriptor[0] == '[') {
     return CreateArrayClass(descriptor, class_loader);
 
@@ -2194,6 +2488,7 @@ mirror::Class* ClassLinker::DefineClass(const char* descriptor,
 
 there:
   Thread* self = Thread::Current();
+  ScopedClassLoadingTimer timer(this, kDefineClassPhase, class_loader);
   SirtRef<mirror::Class> klass(self, NULL);
   // Load the class from the dex file.
   if (UNLIKELY(!init_done_)) {
@@ -2368,19 +2663,27 @@ const OatFile::OatMethod ClassLinker::GetOatMethodFor(const mirror::ArtMethod* m
     // Simple case where the oat method index was stashed at load time.
     oat_method_index = method->GetMethodIndex();
   } else {
-    // We're invoking a virtual method directly (thanks to sharpening), compute the oat_method_index
-    // by search for its position in the declared virtual methods.
-    oat_method_index = declaring_class->NumDirectMethods();
-    size_t end = declaring_class->NumVirtualMethods();
-    bool found = false;
-    for (size_t i = 0; i < end; i++) {
-      if (declaring_class->GetVirtualMethod(i) == method) {
-        found = true;
-        break;
+    // We're invoking a virtual method directly (thanks to sharpening) or linking its code lazily,
+    // compute the oat_method_index by search for its position in the declared virtual methods.
+    // They are in class data order, which is by increasing method index, followed by miranda
+    // methods.
+    uint32_t dex_method_index = method->GetDexMethodIndex();
+    size_t lo = 0;
+    size_t hi = declaring_class->NumVirtualMethods();
+    while (hi > 0 && declaring_class->GetVirtualMethod(hi - 1)->IsMiranda()) {
+      --hi;
+    }
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (declaring_class->GetVirtualMethod(mid)->GetDexMethodIndex() < dex_method_index) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
       }
-      oat_method_index++;
     }
-    CHECK(found) << "Didn't find oat method index for virtual method: " << PrettyMethod(method);
+    CHECK(lo < hi && declaring_class->GetVirtualMethod(lo) == method)
+        << "Didn't find oat method index for virtual method: " << PrettyMethod(method);
+    oat_method_index = declaring_class->NumDirectMethods() + lo;
   }
   UniquePtr<const OatFile::OatClass>
       oat_class(GetOatClass(*declaring_class->GetDexCache()->GetDexFile(),
@@ -2481,18 +2784,42 @@ void ClassLinker::FixupStaticTrampolines(mirror::Class* klass) {
   // Ignore virtual methods on the iterator.
 }
 
+// Returns true if LinkCode may leave the method to be linked on its first invoke, see
+// ClassLinker::EnsureCodeLinked.
+static bool CanLinkCodeLazily(const mirror::ArtMethod* method)
+    SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+#if defined(ART_USE_PORTABLE_COMPILER)
+  return false;
+#else
+  // Static methods already go through the resolution trampoline until their class is
+  // initialized, native methods need their JNI stub, and abstract methods the interpreter bridge.
+  // Instrumentation expects every method to have its code.
+  const instrumentation::Instrumentation* instrumentation =
+      Runtime::Current()->GetInstrumentation();
+  return !method->IsStatic() && !method->IsNative() && !method->IsAbstract() &&
+         !instrumentation->InterpretOnly() && !instrumentation->AreExitStubsInstalled();
+#endif
+}
+
 static void LinkCode(SirtRef<mirror::ArtMethod>& method, const OatFile::OatClass* oat_class,
                      uint32_t method_index)
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   // Method shouldn't have already been linked.
   DCHECK(method->GetEntryPointFromCompiledCode() == NULL);
+  Runtime* runtime = Runtime::Current();
+  if (CanLinkCodeLazily(method.get())) {
+    // Most methods of a loaded class are never invoked, so leave the oat method lookup to the
+    // resolution trampoline. The interpreter gets there through the compiled code entry point.
+    method->SetEntryPointFromInterpreter(artInterpreterToCompiledCodeBridge);
+    method->SetEntryPointFromCompiledCode(GetResolutionTrampoline(runtime->GetClassLinker()));
+    return;
+  }
   // Every kind of method should at least get an invoke stub from the oat_method.
   // non-abstract methods also get their code pointers.
   const OatFile::OatMethod oat_method = oat_class->GetOatMethod(method_index);
   oat_method.LinkMethod(method.get());
 
   // Install entry point from interpreter.
-  Runtime* runtime = Runtime::Current();
   bool enter_interpreter = NeedsInterpreter(method.get(), method->GetEntryPointFromCompiledCode());
   if (enter_interpreter) {
     method->SetEntryPointFromInterpreter(interpreter::artInterpreterToInterpreterBridge);
@@ -2525,10 +2852,38 @@ static void LinkCode(SirtRef<mirror::ArtMethod>& method, const OatFile::OatClass
                                                    method->GetEntryPointFromCompiledCode());
 }
 
+void ClassLinker::EnsureCodeLinked(mirror::ArtMethod* method) {
+  if (method->IsStatic() ||
+      method->GetEntryPointFromCompiledCode() != GetResolutionTrampoline(this)) {
+    return;
+  }
+  const OatFile::OatMethod oat_method = GetOatMethodFor(method);
+  const void* code = oat_method.GetCode();
+  bool enter_interpreter = NeedsInterpreter(method, code);
+  // Unlike OatMethod::LinkMethod, fill in the frame layout before the entry point: other threads
+  // may already be calling the method, and must keep going through the trampoline until stack
+  // walks can find their way through its frames.
+  method->SetFrameSizeInBytes(oat_method.GetFrameSizeInBytes());
+  method->SetCoreSpillMask(oat_method.GetCoreSpillMask());
+  method->SetFpSpillMask(oat_method.GetFpSpillMask());
+  method->SetMappingTable(oat_method.GetMappingTable());
+  method->SetVmapTable(oat_method.GetVmapTable());
+  method->SetNativeGcMap(oat_method.GetNativeGcMap());
+  if (enter_interpreter) {
+    method->SetEntryPointFromInterpreter(interpreter::artInterpreterToInterpreterBridge);
+    code = GetCompiledCodeToInterpreterBridge();
+  } else {
+    method->SetEntryPointFromInterpreter(artInterpreterToCompiledCodeBridge);
+  }
+  ANDROID_MEMBAR_STORE();
+  Runtime::Current()->GetInstrumentation()->UpdateMethodsCode(method, code);
+}
+
 void ClassLinker::LoadClass(const DexFile& dex_file,
                             const DexFile::ClassDef& dex_class_def,
                             SirtRef<mirror::Class>& klass,
                             mirror::ClassLoader* class_loader) {
+  ScopedClassLoadingTimer timer(this, kLoadClassPhase, class_loader);
   CHECK(klass.get() != NULL);
   CHECK(klass->GetDexCache() != NULL);
   CHECK_EQ(mirror::Class::kStatusNotReady, klass->GetStatus());
@@ -2732,12 +3087,7 @@ void ClassLinker::AppendToBootClassPath(const DexFile& dex_file, SirtRef<mirror:
 
 bool ClassLinker::IsDexFileRegisteredLocked(const DexFile& dex_file) const {
   dex_lock_.AssertSharedHeld(Thread::Current());
-  for (size_t i = 0; i != dex_caches_.size(); ++i) {
-    if (dex_caches_[i]->GetDexFile() == &dex_file) {
-      return true;
-    }
-  }
-  return false;
+  return dex_cache_index_.Find(&dex_file) != NULL;
 }
 
 bool ClassLinker::IsDexFileRegistered(const DexFile& dex_file) const {
@@ -2752,6 +3102,11 @@ void ClassLinker::RegisterDexFileLocked(const DexFile& dex_file, SirtRef<mirror:
       << dex_cache->GetLocation()->ToModifiedUtf8() << " " << dex_file.GetLocation();
   dex_caches_.push_back(dex_cache.get());
   dex_cache->SetDexFile(&dex_file);
+  dex_cache_index_.Add(dex_cache.get());
+  // Like the linear search this replaces, prefer the first DexCache registered for a location.
+  if (dex_caches_by_location_.find(dex_file.GetLocation()) == dex_caches_by_location_.end()) {
+    dex_caches_by_location_.Put(dex_file.GetLocation(), dex_cache.get());
+  }
   dex_caches_dirty_ = true;
 }
 
@@ -2783,26 +3138,26 @@ void ClassLinker::RegisterDexFile(const DexFile& dex_file, SirtRef<mirror::DexCa
 }
 
 mirror::DexCache* ClassLinker::FindDexCache(const DexFile& dex_file) const {
+  // Search assuming unique-ness of dex file, without the lock.
+  mirror::DexCache* dex_cache = dex_cache_index_.Find(&dex_file);
+  if (LIKELY(dex_cache != NULL)) {
+    return dex_cache;
+  }
   ReaderMutexLock mu(Thread::Current(), dex_lock_);
-  // Search assuming unique-ness of dex file.
-  for (size_t i = 0; i != dex_caches_.size(); ++i) {
-    mirror::DexCache* dex_cache = dex_caches_[i];
-    if (dex_cache->GetDexFile() == &dex_file) {
-      return dex_cache;
-    }
+  // The lock-free search can miss a dex file that is being registered right now.
+  dex_cache = dex_cache_index_.Find(&dex_file);
+  if (dex_cache != NULL) {
+    return dex_cache;
   }
   // Search matching by location name.
-  std::string location(dex_file.GetLocation());
-  for (size_t i = 0; i != dex_caches_.size(); ++i) {
-    mirror::DexCache* dex_cache = dex_caches_[i];
-    if (dex_cache->GetDexFile()->GetLocation() == location) {
-      return dex_cache;
-    }
+  const std::string& location(dex_file.GetLocation());
+  auto it = dex_caches_by_location_.find(location);
+  if (it != dex_caches_by_location_.end()) {
+    return it->second;
   }
   // Failure, dump diagnostic and abort.
   for (size_t i = 0; i != dex_caches_.size(); ++i) {
-    mirror::DexCache* dex_cache = dex_caches_[i];
-    LOG(ERROR) << "Registered dex file " << i << " = " << dex_cache->GetDexFile()->GetLocation();
+    LOG(ERROR) << "Registered dex file " << i << " = " << dex_caches_[i]->GetDexFile()->GetLocation();
   }
   LOG(FATAL) << "Failed to find DexCache for DexFile " << location;
   return NULL;
@@ -2947,6 +3302,7 @@ mirror::Class* ClassLinker::CreateArrayClass(const char* descriptor,
   // (remember not to free them for arrays).
   CHECK(array_iftable_ != NULL);
   new_class->SetIfTable(array_iftable_);
+  new_class->SetUpTypeCheckData();
 
   // Inherit access flags from the component type.
   int access_flags = new_class->GetComponentType()->GetAccessFlags();
@@ -3012,21 +3368,20 @@ mirror::Class* ClassLinker::InsertClass(const char* descriptor, mirror::Class* k
     LOG(INFO) << "Loaded class " << descriptor << source;
   }
   WriterMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  mirror::Class* existing =
-      LookupClassFromTableLocked(descriptor, klass->GetClassLoader(), hash);
+  mirror::Class* existing = class_table_.Lookup(descriptor, klass->GetClassLoader(), hash);
   if (existing != NULL) {
     return existing;
   }
   if (kIsDebugBuild && klass->GetClassLoader() == NULL && dex_cache_image_class_lookup_required_) {
     // Check a class loaded with the system class loader matches one in the image if the class
     // is in the image.
-    existing = LookupClassFromImage(descriptor);
+    existing = LookupClassFromImage(descriptor, hash);
     if (existing != NULL) {
       CHECK(klass == existing);
     }
   }
   Runtime::Current()->GetHeap()->VerifyObject(klass);
-  class_table_.insert(std::make_pair(hash, klass));
+  class_table_.Insert(klass, hash);
   class_table_dirty_ = true;
   return NULL;
 }
@@ -3034,25 +3389,20 @@ mirror::Class* ClassLinker::InsertClass(const char* descriptor, mirror::Class* k
 bool ClassLinker::RemoveClass(const char* descriptor, const mirror::ClassLoader* class_loader) {
   size_t hash = Hash(descriptor);
   WriterMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  ClassHelper kh;
-  for (auto it = class_table_.lower_bound(hash), end = class_table_.end(); it != end && it->first == hash;
-       ++it) {
-    mirror::Class* klass = it->second;
-    kh.ChangeClass(klass);
-    if (strcmp(kh.GetDescriptor(), descriptor) == 0 && klass->GetClassLoader() == class_loader) {
-      class_table_.erase(it);
-      return true;
-    }
-  }
-  return false;
+  return class_table_.Remove(descriptor, class_loader, hash);
 }
 
 mirror::Class* ClassLinker::LookupClass(const char* descriptor,
                                         const mirror::ClassLoader* class_loader) {
   size_t hash = Hash(descriptor);
+  mirror::Class* result = class_table_.Lookup(descriptor, class_loader, hash);
+  if (result != NULL) {
+    return result;
+  }
   {
+    // The lock-free lookup can miss a class that another thread is inserting right now.
     ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-    mirror::Class* result = LookupClassFromTableLocked(descriptor, class_loader, hash);
+    result = class_table_.Lookup(descriptor, class_loader, hash);
     if (result != NULL) {
       return result;
     }
@@ -3060,48 +3410,15 @@ mirror::Class* ClassLinker::LookupClass(const char* descriptor,
   if (class_loader != NULL || !dex_cache_image_class_lookup_required_) {
     return NULL;
   } else {
-    // Lookup failed but need to search dex_caches_.
-    mirror::Class* result = LookupClassFromImage(descriptor);
+    // Lookup failed but need to search the image classes.
+    result = LookupClassFromImage(descriptor, hash);
     if (result != NULL) {
       InsertClass(descriptor, result, hash);
-    } else {
-      // Searching the image dex files/caches failed, we don't want to get into this situation
-      // often as map searches are faster, so after kMaxFailedDexCacheLookups move all image
-      // classes into the class table.
-      const int32_t kMaxFailedDexCacheLookups = 1000;
-      if (++failed_dex_cache_class_lookups_ > kMaxFailedDexCacheLookups) {
-        MoveImageClassesToClassTable();
-      }
     }
     return result;
   }
 }
 
-mirror::Class* ClassLinker::LookupClassFromTableLocked(const char* descriptor,
-                                                       const mirror::ClassLoader* class_loader,
-                                                       size_t hash) {
-  ClassHelper kh(NULL, this);
-  auto end = class_table_.end();
-  for (auto it = class_table_.lower_bound(hash); it != end && it->first == hash; ++it) {
-    mirror::Class* klass = it->second;
-    kh.ChangeClass(klass);
-    if (klass->GetClassLoader() == class_loader && strcmp(descriptor, kh.GetDescriptor()) == 0) {
-      if (kIsDebugBuild) {
-        // Check for duplicates in the table.
-        for (++it; it != end && it->first == hash; ++it) {
-          mirror::Class* klass2 = it->second;
-          kh.ChangeClass(klass2);
-          CHECK(!(strcmp(descriptor, kh.GetDescriptor()) == 0 && klass2->GetClassLoader() == class_loader))
-          << PrettyClass(klass) << " " << klass << " " << klass->GetClassLoader() << " "
-          << PrettyClass(klass2) << " " << klass2 << " " << klass2->GetClassLoader();
-        }
-      }
-      return klass;
-    }
-  }
-  return NULL;
-}
-
 static mirror::ObjectArray<mirror::DexCache>* GetImageDexCaches()
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
   gc::space::ImageSpace* image = Runtime::Current()->GetHeap()->GetImageSpace();
@@ -3130,12 +3447,12 @@ void ClassLinker::MoveImageClassesToClassTable() {
         DCHECK(klass->GetClassLoader() == NULL);
         const char* descriptor = kh.GetDescriptor();
         size_t hash = Hash(descriptor);
-        mirror::Class* existing = LookupClassFromTableLocked(descriptor, NULL, hash);
+        mirror::Class* existing = class_table_.Lookup(descriptor, NULL, hash);
         if (existing != NULL) {
           CHECK(existing == klass) << PrettyClassAndClassLoader(existing) << " != "
               << PrettyClassAndClassLoader(klass);
         } else {
-          class_table_.insert(std::make_pair(hash, klass));
+          class_table_.Insert(klass, hash);
         }
       }
     }
@@ -3145,46 +3462,10 @@ void ClassLinker::MoveImageClassesToClassTable() {
   self->EndAssertNoThreadSuspension(old_no_suspend_cause);
 }
 
-mirror::Class* ClassLinker::LookupClassFromImage(const char* descriptor) {
-  Thread* self = Thread::Current();
-  const char* old_no_suspend_cause =
-      self->StartAssertNoThreadSuspension("Image class lookup");
-  mirror::ObjectArray<mirror::DexCache>* dex_caches = GetImageDexCaches();
-  for (int32_t i = 0; i < dex_caches->GetLength(); ++i) {
-    mirror::DexCache* dex_cache = dex_caches->Get(i);
-    const DexFile* dex_file = dex_cache->GetDexFile();
-    // First search using the class def map, but don't bother for non-class types.
-    if (descriptor[0] == 'L') {
-      const DexFile::StringId* descriptor_string_id = dex_file->FindStringId(descriptor);
-      if (descriptor_string_id != NULL) {
-        const DexFile::TypeId* type_id =
-            dex_file->FindTypeId(dex_file->GetIndexForStringId(*descriptor_string_id));
-        if (type_id != NULL) {
-          mirror::Class* klass = dex_cache->GetResolvedType(dex_file->GetIndexForTypeId(*type_id));
-          if (klass != NULL) {
-            self->EndAssertNoThreadSuspension(old_no_suspend_cause);
-            return klass;
-          }
-        }
-      }
-    }
-    // Now try binary searching the string/type index.
-    const DexFile::StringId* string_id = dex_file->FindStringId(descriptor);
-    if (string_id != NULL) {
-      const DexFile::TypeId* type_id =
-          dex_file->FindTypeId(dex_file->GetIndexForStringId(*string_id));
-      if (type_id != NULL) {
-        uint16_t type_idx = dex_file->GetIndexForTypeId(*type_id);
-        mirror::Class* klass = dex_cache->GetResolvedType(type_idx);
-        if (klass != NULL) {
-          self->EndAssertNoThreadSuspension(old_no_suspend_cause);
-          return klass;
-        }
-      }
-    }
-  }
-  self->EndAssertNoThreadSuspension(old_no_suspend_cause);
-  return NULL;
+mirror::Class* ClassLinker::LookupClassFromImage(const char* descriptor, size_t hash) {
+  const ImageHeader& image_header = Runtime::Current()->GetHeap()->GetImageSpace()->GetImageHeader();
+  const mirror::IntArray* index = image_header.GetImageRoot(ImageHeader::kClassIndex)->AsIntArray();
+  return ImageClassIndex::Lookup(index, GetImageDexCaches(), descriptor, hash);
 }
 
 void ClassLinker::LookupClasses(const char* descriptor, std::vector<mirror::Class*>& result) {
@@ -3194,15 +3475,7 @@ void ClassLinker::LookupClasses(const char* descriptor, std::vector<mirror::Clas
   }
   size_t hash = Hash(descriptor);
   ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  ClassHelper kh(NULL, this);
-  for (auto it = class_table_.lower_bound(hash), end = class_table_.end();
-      it != end && it->first == hash; ++it) {
-    mirror::Class* klass = it->second;
-    kh.ChangeClass(klass);
-    if (strcmp(descriptor, kh.GetDescriptor()) == 0) {
-      result.push_back(klass);
-    }
-  }
+  class_table_.LookupAll(descriptor, hash, &result);
 }
 
 void ClassLinker::VerifyClass(mirror::Class* klass) {
@@ -3223,6 +3496,8 @@ void ClassLinker::VerifyClass(mirror::Class* klass) {
     return;
   }
 
+  ScopedClassLoadingTimer timer(this, kVerifyClassPhase, klass->GetClassLoader());
+
   if (klass->GetStatus() == mirror::Class::kStatusResolved) {
     klass->SetStatus(mirror::Class::kStatusVerifying, self);
   } else {
@@ -3876,6 +4151,9 @@ bool ClassLinker::InitializeClass(mirror::Class* klass, bool can_init_statics,
   FixupStaticTrampolines(klass);
 
   uint64_t t1 = NanoTime();
+  // Only the span in which this thread ran the initialization counts, not early returns or
+  // waiting for another thread to initialize the class.
+  AddClassLoadingTime(kInitializeClassPhase, klass->GetClassLoader() == NULL, t1 - t0);
 
   bool success = true;
   {
@@ -4060,6 +4338,7 @@ void ClassLinker::ConstructFieldMap(const DexFile& dex_file, const DexFile::Clas
 
 bool ClassLinker::LinkClass(SirtRef<mirror::Class>& klass,
                             mirror::ObjectArray<mirror::Class>* interfaces, Thread* self) {
+  ScopedClassLoadingTimer timer(this, kLinkClassPhase, klass->GetClassLoader());
   CHECK_EQ(mirror::Class::kStatusLoaded, klass->GetStatus());
   if (!LinkSuperClass(klass)) {
     return false;
@@ -4067,6 +4346,8 @@ bool ClassLinker::LinkClass(SirtRef<mirror::Class>& klass,
   if (!LinkMethods(klass, interfaces)) {
     return false;
   }
+  // The superclass and iftable are final now.
+  klass->SetUpTypeCheckData();
   if (!LinkInstanceFields(klass)) {
     return false;
   }
@@ -4181,6 +4462,85 @@ bool ClassLinker::LinkSuperClass(SirtRef<mirror::Class>& klass) {
   return true;
 }
 
+// Finds methods in a vtable by ComputeNameAndSignatureHash. Linking looks up each virtual method
+// of a class and each method of its interfaces in the vtable, and comparing names and signatures
+// pairwise made that quadratic, which dominates linking classes deep in the framework's
+// hierarchies. Hash matches still need to be confirmed with HasSameNameAndSignature.
+class MethodNameAndSignatureIndex {
+ public:
+  static const int32_t kNone = -1;
+
+  MethodNameAndSignatureIndex() : mask_(0) {}
+
+  bool IsBuilt() const {
+    return !heads_.empty();
+  }
+
+  // Indexes the first length methods of vtable, leaving room for capacity methods in all.
+  void Build(mirror::ObjectArray<mirror::ArtMethod>* vtable, size_t length, size_t capacity,
+             MethodHelper* mh) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    DCHECK(!IsBuilt());
+    size_t buckets = 16;
+    while (buckets < capacity) {
+      buckets *= 2;
+    }
+    heads_.assign(buckets, kNone);
+    mask_ = buckets - 1;
+    hashes_.reserve(capacity);
+    next_.reserve(capacity);
+    for (size_t i = 0; i < length; ++i) {
+      mh->ChangeMethod(vtable->Get(i));
+      Add(mh->ComputeNameAndSignatureHash(), i);
+    }
+  }
+
+  // Records the hash of the method at vtable position index, the first one not yet indexed.
+  void Add(uint32_t hash, size_t index) {
+    DCHECK_EQ(index, hashes_.size());
+    size_t bucket = Bucket(hash);
+    hashes_.push_back(hash);
+    next_.push_back(heads_[bucket]);
+    heads_[bucket] = index;
+  }
+
+  // Returns the highest position with the given hash, or kNone.
+  int32_t First(uint32_t hash) const {
+    return Skip(heads_[Bucket(hash)], hash);
+  }
+
+  // Returns the next position below index with the given hash, or kNone.
+  int32_t Next(int32_t index, uint32_t hash) const {
+    return Skip(next_[index], hash);
+  }
+
+ private:
+  size_t Bucket(uint32_t hash) const {
+    // The hash is built from java.lang.String style hashes, whose low bits are poorly mixed.
+    return ((hash ^ (hash >> 16)) * 0x9e3779b1U) & mask_;
+  }
+
+  int32_t Skip(int32_t index, uint32_t hash) const {
+    while (index != kNone && hashes_[index] != hash) {
+      index = next_[index];
+    }
+    return index;
+  }
+
+  // Bucket chains run from the highest position down.
+  std::vector<int32_t> heads_;
+  std::vector<int32_t> next_;
+  std::vector<uint32_t> hashes_;
+  size_t mask_;
+
+  DISALLOW_COPY_AND_ASSIGN(MethodNameAndSignatureIndex);
+};
+
+const int32_t MethodNameAndSignatureIndex::kNone;
+
+// Hashing a method costs about as much as a few pairwise comparisons, so classes that look up
+// fewer methods than this in their vtable keep scanning it.
+static const size_t kMinLookupsForMethodIndex = 4;
+
 // Populate the class vtable and itable. Compute return type indices.
 bool ClassLinker::LinkMethods(SirtRef<mirror::Class>& klass,
                               mirror::ObjectArray<mirror::Class>* interfaces) {
@@ -4195,15 +4555,18 @@ bool ClassLinker::LinkMethods(SirtRef<mirror::Class>& klass,
       klass->GetVirtualMethodDuringLinking(i)->SetMethodIndex(i);
     }
     // Link interface method tables
-    return LinkInterfaceMethods(klass, interfaces);
+    return LinkInterfaceMethods(klass, interfaces, NULL);
   } else {
     // Link virtual and interface method tables
-    return LinkVirtualMethods(klass) && LinkInterfaceMethods(klass, interfaces);
+    MethodNameAndSignatureIndex vtable_index;
+    return LinkVirtualMethods(klass, &vtable_index) &&
+        LinkInterfaceMethods(klass, interfaces, &vtable_index);
   }
   return true;
 }
 
-bool ClassLinker::LinkVirtualMethods(SirtRef<mirror::Class>& klass) {
+bool ClassLinker::LinkVirtualMethods(SirtRef<mirror::Class>& klass,
+                                     MethodNameAndSignatureIndex* vtable_index) {
   Thread* self = Thread::Current();
   if (klass->HasSuperClass()) {
     uint32_t max_count = klass->NumVirtualMethods() + klass->GetSuperClass()->GetVTable()->GetLength();
@@ -4219,12 +4582,32 @@ bool ClassLinker::LinkVirtualMethods(SirtRef<mirror::Class>& klass) {
     // See if any of our virtual methods override the superclass.
     MethodHelper local_mh(NULL, this);
     MethodHelper super_mh(NULL, this);
-    for (size_t i = 0; i < klass->NumVirtualMethods(); ++i) {
+    const size_t num_virtual_methods = klass->NumVirtualMethods();
+    const bool use_index = num_virtual_methods >= kMinLookupsForMethodIndex;
+    if (use_index) {
+      vtable_index->Build(vtable.get(), actual_count, max_count, &super_mh);
+    }
+    std::vector<int32_t> candidates;
+    for (size_t i = 0; i < num_virtual_methods; ++i) {
       mirror::ArtMethod* local_method = klass->GetVirtualMethodDuringLinking(i);
       local_mh.ChangeMethod(local_method);
-      size_t j = 0;
-      for (; j < actual_count; ++j) {
-        mirror::ArtMethod* super_method = vtable->Get(j);
+      uint32_t hash = 0;
+      size_t num_candidates = actual_count;
+      if (use_index) {
+        hash = local_mh.ComputeNameAndSignatureHash();
+        candidates.clear();
+        for (int32_t k = vtable_index->First(hash);
+             k != MethodNameAndSignatureIndex::kNone;
+             k = vtable_index->Next(k, hash)) {
+          candidates.push_back(k);
+        }
+        num_candidates = candidates.size();
+      }
+      size_t j = actual_count;
+      for (size_t c = 0; c < num_candidates; ++c) {
+        // The index yields the highest positions first, but the lowest accessible match wins.
+        size_t k = use_index ? candidates[num_candidates - 1 - c] : c;
+        mirror::ArtMethod* super_method = vtable->Get(k);
         super_mh.ChangeMethod(super_method);
         if (local_mh.HasSameNameAndSignature(&super_mh)) {
           if (klass->CanAccessMember(super_method->GetDeclaringClass(), super_method->GetAccessFlags())) {
@@ -4234,8 +4617,9 @@ bool ClassLinker::LinkVirtualMethods(SirtRef<mirror::Class>& klass) {
                                 super_mh.GetDeclaringClassDescriptor());
               return false;
             }
-            vtable->Set(j, local_method);
-            local_method->SetMethodIndex(j);
+            vtable->Set(k, local_method);
+            local_method->SetMethodIndex(k);
+            j = k;
             break;
           } else {
             LOG(WARNING) << "Before Android 4.1, method " << PrettyMethod(local_method)
@@ -4248,6 +4632,9 @@ bool ClassLinker::LinkVirtualMethods(SirtRef<mirror::Class>& klass) {
         // Not overriding, append.
         vtable->Set(actual_count, local_method);
         local_method->SetMethodIndex(actual_count);
+        if (use_index) {
+          vtable_index->Add(hash, actual_count);
+        }
         actual_count += 1;
       }
     }
@@ -4289,7 +4676,8 @@ bool ClassLinker::LinkVirtualMethods(SirtRef<mirror::Class>& klass) {
 }
 
 bool ClassLinker::LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
-                                       mirror::ObjectArray<mirror::Class>* interfaces) {
+                                       mirror::ObjectArray<mirror::Class>* interfaces,
+                                       MethodNameAndSignatureIndex* vtable_index) {
   size_t super_ifcount;
   if (klass->HasSuperClass()) {
     super_ifcount = klass->GetSuperClass()->GetIfTableCount();
@@ -4398,8 +4786,18 @@ bool ClassLinker::LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
     return true;
   }
   std::vector<mirror::ArtMethod*> miranda_list;
+  std::vector<uint32_t> miranda_hashes;
   MethodHelper vtable_mh(NULL, this);
   MethodHelper interface_mh(NULL, this);
+  size_t num_interface_methods = 0;
+  for (size_t i = 0; i < ifcount; ++i) {
+    num_interface_methods += iftable->GetInterface(i)->NumVirtualMethods();
+  }
+  const bool use_index = num_interface_methods >= kMinLookupsForMethodIndex;
+  if (use_index && !vtable_index->IsBuilt()) {
+    mirror::ObjectArray<mirror::ArtMethod>* vtable = klass->GetVTableDuringLinking();
+    vtable_index->Build(vtable, vtable->GetLength(), vtable->GetLength(), &vtable_mh);
+  }
   for (size_t i = 0; i < ifcount; ++i) {
     mirror::Class* interface = iftable->GetInterface(i);
     size_t num_methods = interface->NumVirtualMethods();
@@ -4415,6 +4813,7 @@ bool ClassLinker::LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
       for (size_t j = 0; j < num_methods; ++j) {
         mirror::ArtMethod* interface_method = interface->GetVirtualMethod(j);
         interface_mh.ChangeMethod(interface_method);
+        uint32_t hash = use_index ? interface_mh.ComputeNameAndSignatureHash() : 0;
         int32_t k;
         // For each method listed in the interface's method list, find the
         // matching method in our class's method list.  We want to favor the
@@ -4424,7 +4823,10 @@ bool ClassLinker::LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
         // it -- otherwise it would use the same vtable slot.  In .dex files
         // those don't end up in the virtual method table, so it shouldn't
         // matter which direction we go.  We walk it backward anyway.)
-        for (k = vtable->GetLength() - 1; k >= 0; --k) {
+        // The index also yields positions from the end of the vtable back.
+        for (k = use_index ? vtable_index->First(hash) : vtable->GetLength() - 1;
+             k >= 0;
+             k = use_index ? vtable_index->Next(k, hash) : k - 1) {
           mirror::ArtMethod* vtable_method = vtable->Get(k);
           vtable_mh.ChangeMethod(vtable_method);
           if (interface_mh.HasSameNameAndSignature(&vtable_mh)) {
@@ -4442,6 +4844,9 @@ bool ClassLinker::LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
         if (k < 0) {
           SirtRef<mirror::ArtMethod> miranda_method(self, NULL);
           for (size_t mir = 0; mir < miranda_list.size(); mir++) {
+            if (use_index && miranda_hashes[mir] != hash) {
+              continue;
+            }
             mirror::ArtMethod* mir_method = miranda_list[mir];
             vtable_mh.ChangeMethod(mir_method);
             if (interface_mh.HasSameNameAndSignature(&vtable_mh)) {
@@ -4461,6 +4866,7 @@ bool ClassLinker::LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
             UNIMPLEMENTED(FATAL);
 #endif
             miranda_list.push_back(miranda_method.get());
+            miranda_hashes.push_back(hash);
           }
           method_array->Set(j, miranda_method.get());
         }
@@ -5035,6 +5441,12 @@ const char* ClassLinker::MethodShorty(uint32_t method_idx, mirror::ArtMethod* re
 }
 
 void ClassLinker::DumpAllClasses(int flags) {
+  if ((flags & mirror::Class::kDumpClassLoadingTimes) != 0) {
+    std::ostringstream os;
+    DumpClassLoadingTimes(os);
+    LOG(INFO) << os.str();
+    return;
+  }
   if (dex_cache_image_class_lookup_required_) {
     MoveImageClassesToClassTable();
   }
@@ -5043,9 +5455,11 @@ void ClassLinker::DumpAllClasses(int flags) {
   std::vector<mirror::Class*> all_classes;
   {
     ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-    for (const std::pair<size_t, mirror::Class*>& it : class_table_) {
-      all_classes.push_back(it.second);
-    }
+    auto visit = [&all_classes](mirror::Class* klass) {
+      all_classes.push_back(klass);
+      return true;
+    };
+    class_table_.VisitClasses(visit);
   }
 
   for (size_t i = 0; i < all_classes.size(); ++i) {
@@ -5058,7 +5472,8 @@ void ClassLinker::DumpForSigQuit(std::ostream& os) {
     MoveImageClassesToClassTable();
   }
   ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  os << "Loaded classes: " << class_table_.size() << " allocated classes\n";
+  os << "Loaded classes: " << class_table_.Size() << " allocated classes\n";
+  DumpClassLoadingTimes(os);
 }
 
 size_t ClassLinker::NumLoadedClasses() {
@@ -5066,7 +5481,7 @@ size_t ClassLinker::NumLoadedClasses() {
     MoveImageClassesToClassTable();
   }
   ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
-  return class_table_.size();
+  return class_table_.Size();
 }
 
 pid_t ClassLinker::GetClassesLockOwner() {
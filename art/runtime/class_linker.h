@@ -21,11 +21,15 @@
 #include <utility>
 #include <vector>
 
+#include "atomic_integer.h"
 #include "base/macros.h"
 #include "base/mutex.h"
+#include "class_table.h"
+#include "dex_cache_index.h"
 #include "dex_file.h"
 #include "gtest/gtest.h"
 #include "root_visitor.h"
+#include "safe_map.h"
 #include "oat_file.h"
 
 namespace art {
@@ -44,8 +48,10 @@ namespace mirror {
 }  // namespace mirror
 
 class InternTable;
+class MethodNameAndSignatureIndex;
 class ObjectLock;
 template<class T> class SirtRef;
+class ThreadPool;
 
 typedef bool (ClassVisitor)(mirror::Class* c, void* arg);
 
@@ -72,6 +78,16 @@ class ClassLinker {
   mirror::Class* FindSystemClass(const char* descriptor)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Loads and links the boot classes with the given descriptors, such as a list of classes to
+  // preload, on the workers of thread_pool as well as the calling thread. A class is only started
+  // once those of its superclass, interfaces and, for arrays, component type that are listed too
+  // have been loaded, so workers seldom wait on a class that another one is still linking. Sets
+  // (*loaded)[i], if loaded isn't NULL, when descriptors[i] was found. Failures are only logged.
+  // Returns the number of classes found.
+  size_t FindSystemClasses(Thread* self, const std::vector<std::string>& descriptors,
+                           ThreadPool* thread_pool, std::vector<bool>* loaded)
+      LOCKS_EXCLUDED(Locks::mutator_lock_);
+
   // Define a new a class based on a ClassDef from a DexFile
   mirror::Class* DefineClass(const char* descriptor, mirror::ClassLoader* class_loader,
                              const DexFile& dex_file, const DexFile::ClassDef& dex_class_def)
@@ -104,6 +120,25 @@ class ClassLinker {
       LOCKS_EXCLUDED(Locks::classlinker_classes_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // The timed phases of class loading. Phases nest, so the time of a phase includes that of the
+  // phases it runs, and of the other classes loaded, linked or initialized along the way.
+  enum ClassLoadingPhase {
+    kFindClassPhase,  // Only when the class wasn't loaded yet.
+    kDefineClassPhase,
+    kLoadClassPhase,
+    kLinkClassPhase,
+    kVerifyClassPhase,
+    kInitializeClassPhase,
+    kClassLoadingPhaseCount  // Must come last.
+  };
+
+  // Adds the duration of one run of a class loading phase, for a class of the boot class loader
+  // or of another loader, to the histogram of that phase. Takes no locks.
+  void AddClassLoadingTime(ClassLoadingPhase phase, bool boot_class_loader, uint64_t duration_ns);
+
+  // Prints the histograms of class loading times, for VMDebug.printLoadedClasses and SIGQUIT.
+  void DumpClassLoadingTimes(std::ostream& os);
+
   size_t NumLoadedClasses()
       LOCKS_EXCLUDED(Locks::classlinker_classes_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -331,6 +366,12 @@ class ClassLinker {
   const void* GetOatCodeFor(const mirror::ArtMethod* method)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Instance methods of classes loaded once the runtime has started only get their oat code,
+  // frame layout and maps on their first invoke, when the resolution trampoline calls this. Does
+  // nothing if method is static or already linked.
+  void EnsureCodeLinked(mirror::ArtMethod* method)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
   // Get the oat code for a method from a method index.
   const void* GetOatCodeFor(const DexFile& dex_file, uint16_t class_def_idx, uint32_t method_idx)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -466,11 +507,13 @@ class ClassLinker {
   bool LinkMethods(SirtRef<mirror::Class>& klass, mirror::ObjectArray<mirror::Class>* interfaces)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-  bool LinkVirtualMethods(SirtRef<mirror::Class>& klass)
+  // Both may fill in and use vtable_index, which describes klass's vtable.
+  bool LinkVirtualMethods(SirtRef<mirror::Class>& klass, MethodNameAndSignatureIndex* vtable_index)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   bool LinkInterfaceMethods(SirtRef<mirror::Class>& klass,
-                            mirror::ObjectArray<mirror::Class>* interfaces)
+                            mirror::ObjectArray<mirror::Class>* interfaces,
+                            MethodNameAndSignatureIndex* vtable_index)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   bool LinkStaticFields(SirtRef<mirror::Class>& klass)
@@ -525,29 +568,37 @@ class ClassLinker {
 
   mutable ReaderWriterMutex dex_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   std::vector<mirror::DexCache*> dex_caches_ GUARDED_BY(dex_lock_);
+  // Lock-free DexFile to DexCache lookup for FindDexCache, added to under dex_lock_.
+  DexCacheIndex dex_cache_index_;
+  // The first DexCache registered for each location, for FindDexCache on a DexFile that was
+  // opened again rather than registered.
+  SafeMap<std::string, mirror::DexCache*> dex_caches_by_location_ GUARDED_BY(dex_lock_);
   std::vector<const OatFile*> oat_files_ GUARDED_BY(dex_lock_);
 
 
-  // multimap from a string hash code of a class descriptor to
-  // mirror::Class* instances. Results should be compared for a matching
-  // Class::descriptor_ and Class::class_loader_.
-  typedef std::multimap<size_t, mirror::Class*> Table;
-  Table class_table_ GUARDED_BY(Locks::classlinker_classes_lock_);
+  // All loaded classes, except for image classes while dex_cache_image_class_lookup_required_.
+  // Lookups are lock free, everything else requires Locks::classlinker_classes_lock_.
+  ClassTable class_table_;
 
-  // Do we need to search dex caches to find image classes?
+  // Do we need to search the image class index to find image classes?
   bool dex_cache_image_class_lookup_required_;
-  // Number of times we've searched dex caches for a class. After a certain number of misses we move
-  // the classes into the class_table_ to avoid dex cache based searches.
-  AtomicInteger failed_dex_cache_class_lookups_;
 
-  mirror::Class* LookupClassFromTableLocked(const char* descriptor,
-                                            const mirror::ClassLoader* class_loader,
-                                            size_t hash)
-      SHARED_LOCKS_REQUIRED(Locks::classlinker_classes_lock_, Locks::mutator_lock_);
+  // Histograms of class loading times, for classes of the boot class loader and of other
+  // loaders, indexed by ClassLoadingPhase. Bucket 0 counts runs shorter than a microsecond and
+  // bucket i > 0 those of [2^(i-1), 2^i) microseconds; the last bucket also gets anything longer.
+  // They are only ever updated atomically, so that timing a phase never contends on a lock.
+  static const char* class_loading_phase_names_[];
+  static const size_t kClassLoadingTimeBuckets = 24;
+  struct ClassLoadingTimes {
+    volatile int64_t total_ns;
+    AtomicInteger buckets[kClassLoadingTimeBuckets];
+  };
+  ClassLoadingTimes boot_class_loading_times_[kClassLoadingPhaseCount];
+  ClassLoadingTimes app_class_loading_times_[kClassLoadingPhaseCount];
 
   void MoveImageClassesToClassTable() LOCKS_EXCLUDED(Locks::classlinker_classes_lock_)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
-  mirror::Class* LookupClassFromImage(const char* descriptor)
+  mirror::Class* LookupClassFromImage(const char* descriptor, size_t hash)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
   // indexes into class_roots_.
@@ -34,6 +34,7 @@
 #include "mirror/proxy.h"
 #include "mirror/stack_trace_element.h"
 #include "sirt_ref.h"
+#include "thread_pool.h"
 
 namespace art {
 
@@ -222,6 +223,53 @@ class ClassLinkerTest : public CommonTest {
       } else {
         EXPECT_EQ(interface->NumVirtualMethods(), iftable->GetMethodArrayCount(i));
       }
+      EXPECT_TRUE(interface->IsAssignableFrom(klass));
+    }
+    // The superclass display agrees with the superclass chain.
+    EXPECT_TRUE(klass->HasTypeCheckData());
+    if (!klass->IsInterface()) {
+      size_t depth = 0;
+      for (mirror::Class* super = klass; super != NULL; super = super->GetSuperClass()) {
+        EXPECT_TRUE(klass->IsSubClass(super));
+        ++depth;
+      }
+      ASSERT_EQ(std::min<size_t>(depth, 8U), klass->GetSuperClassDisplayLength());
+      mirror::Class* super = klass;
+      for (size_t i = depth; i > 0; --i) {
+        if (i <= klass->GetSuperClassDisplayLength()) {
+          EXPECT_EQ(super, klass->GetSuperClassDisplayEntry(i - 1));
+        }
+        super = super->GetSuperClass();
+      }
+    }
+    if (!klass->IsInterface()) {
+      // Every vtable entry knows its slot, overriding methods take the slot of the method they
+      // override, and interface methods map to methods of the same name and signature.
+      MethodHelper mh;
+      MethodHelper other_mh;
+      mirror::ObjectArray<mirror::ArtMethod>* vtable = klass->GetVTable();
+      for (int32_t i = 0; i < vtable->GetLength(); ++i) {
+        EXPECT_EQ(i, vtable->Get(i)->GetMethodIndex());
+      }
+      if (klass->HasSuperClass()) {
+        mirror::ObjectArray<mirror::ArtMethod>* super_vtable = klass->GetSuperClass()->GetVTable();
+        ASSERT_LE(super_vtable->GetLength(), vtable->GetLength());
+        for (int32_t i = 0; i < super_vtable->GetLength(); ++i) {
+          mh.ChangeMethod(vtable->Get(i));
+          other_mh.ChangeMethod(super_vtable->Get(i));
+          EXPECT_TRUE(mh.HasSameNameAndSignature(&other_mh)) << PrettyMethod(vtable->Get(i));
+          EXPECT_EQ(mh.ComputeNameAndSignatureHash(), other_mh.ComputeNameAndSignatureHash());
+        }
+      }
+      for (int32_t i = 0; i < klass->GetIfTableCount(); ++i) {
+        mirror::Class* interface = iftable->GetInterface(i);
+        for (size_t j = 0; j < iftable->GetMethodArrayCount(i); ++j) {
+          mh.ChangeMethod(iftable->GetMethodArray(i)->Get(j));
+          other_mh.ChangeMethod(interface->GetVirtualMethod(j));
+          EXPECT_TRUE(mh.HasSameNameAndSignature(&other_mh))
+              << PrettyMethod(interface->GetVirtualMethod(j));
+        }
+      }
     }
     if (klass->IsAbstract()) {
       EXPECT_FALSE(klass->IsFinal());
@@ -845,6 +893,64 @@ TEST_F(ClassLinkerTest, TwoClassLoadersOneClass) {
   EXPECT_NE(MyClass_1, MyClass_2);
 }
 
+TEST_F(ClassLinkerTest, FindSystemClasses) {
+  Thread* self = Thread::Current();
+  std::vector<std::string> descriptors;
+  // Subclasses ahead of their superclasses and interfaces, an array ahead of its component type,
+  // a duplicate and a class that doesn't exist.
+  descriptors.push_back("Ljava/util/LinkedHashMap;");
+  descriptors.push_back("[Ljava/util/HashMap;");
+  descriptors.push_back("Ljava/util/HashMap;");
+  descriptors.push_back("LNoSuchClass;");
+  descriptors.push_back("Ljava/util/AbstractMap;");
+  descriptors.push_back("Ljava/util/Map;");
+  descriptors.push_back("Ljava/util/HashMap;");
+  descriptors.push_back("Ljava/util/concurrent/ConcurrentHashMap;");
+  ThreadPool thread_pool(4);
+  std::vector<bool> loaded;
+  EXPECT_EQ(descriptors.size() - 1,
+            class_linker_->FindSystemClasses(self, descriptors, &thread_pool, &loaded));
+  ASSERT_EQ(descriptors.size(), loaded.size());
+
+  ScopedObjectAccess soa(self);
+  EXPECT_FALSE(self->IsExceptionPending());
+  for (size_t i = 0; i < descriptors.size(); ++i) {
+    mirror::Class* klass = class_linker_->LookupClass(descriptors[i].c_str(), NULL);
+    if (descriptors[i] == "LNoSuchClass;") {
+      EXPECT_FALSE(loaded[i]);
+      EXPECT_TRUE(klass == NULL);
+    } else {
+      EXPECT_TRUE(loaded[i]) << descriptors[i];
+      ASSERT_TRUE(klass != NULL) << descriptors[i];
+      EXPECT_TRUE(klass->IsResolved()) << descriptors[i];
+    }
+  }
+}
+
+TEST_F(ClassLinkerTest, FindDexCache) {
+  ScopedObjectAccess soa(Thread::Current());
+  SirtRef<mirror::ClassLoader> class_loader_1(soa.Self(), soa.Decode<mirror::ClassLoader*>(LoadDex("MyClass")));
+  SirtRef<mirror::ClassLoader> class_loader_2(soa.Self(), soa.Decode<mirror::ClassLoader*>(LoadDex("MyClass")));
+  mirror::Class* MyClass_1 = class_linker_->FindClass("LMyClass;", class_loader_1.get());
+  mirror::Class* MyClass_2 = class_linker_->FindClass("LMyClass;", class_loader_2.get());
+  ASSERT_TRUE(MyClass_1 != NULL);
+  ASSERT_TRUE(MyClass_2 != NULL);
+  const DexFile* dex_1 = MyClass_1->GetDexCache()->GetDexFile();
+  const DexFile* dex_2 = MyClass_2->GetDexCache()->GetDexFile();
+  ASSERT_NE(dex_1, dex_2);
+  EXPECT_EQ(MyClass_1->GetDexCache(), class_linker_->FindDexCache(*dex_1));
+  EXPECT_EQ(MyClass_2->GetDexCache(), class_linker_->FindDexCache(*dex_2));
+  for (const DexFile* dex_file : class_linker_->GetBootClassPath()) {
+    EXPECT_EQ(dex_file, class_linker_->FindDexCache(*dex_file)->GetDexFile());
+  }
+
+  // An unregistered dex file falls back to the first dex cache with the same location.
+  UniquePtr<const DexFile> dex_3(DexFile::Open(dex_1->GetLocation(), dex_1->GetLocation()));
+  ASSERT_TRUE(dex_3.get() != NULL);
+  EXPECT_FALSE(class_linker_->IsDexFileRegistered(*dex_3));
+  EXPECT_EQ(MyClass_1->GetDexCache(), class_linker_->FindDexCache(*dex_3));
+}
+
 TEST_F(ClassLinkerTest, StaticFields) {
   ScopedObjectAccess soa(Thread::Current());
   SirtRef<mirror::ClassLoader> class_loader(soa.Self(), soa.Decode<mirror::ClassLoader*>(LoadDex("Statics")));
@@ -1044,6 +1150,17 @@ TEST_F(ClassLinkerTest, FinalizableBit) {
   EXPECT_TRUE(c->IsFinalizable());
 }
 
+TEST_F(ClassLinkerTest, ClassLoadingTimes) {
+  ScopedObjectAccess soa(Thread::Current());
+  ASSERT_TRUE(class_linker_->FindSystemClass("Ljava/util/BitSet;") != NULL);
+  std::ostringstream os;
+  class_linker_->DumpClassLoadingTimes(os);
+  std::string times(os.str());
+  EXPECT_NE(std::string::npos, times.find("boot LoadClass: ")) << times;
+  EXPECT_NE(std::string::npos, times.find("boot LinkClass: ")) << times;
+  EXPECT_EQ(std::string::npos, times.find("app ")) << times;
+}
+
 TEST_F(ClassLinkerTest, ClassRootDescriptors) {
   ScopedObjectAccess soa(Thread::Current());
   ClassHelper kh;
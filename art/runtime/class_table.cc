@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "class_table.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cutils/atomic-inline.h"
+#include "mirror/class-inl.h"
+#include "object_utils.h"
+#include "utils.h"
+
+namespace art {
+
+mirror::Class* const ClassTable::kRemoved = reinterpret_cast<mirror::Class*>(1);
+
+ClassTable::ClassTable()
+    : slots_(AllocateSlots(kInitialCapacity)), size_(0), used_(0) {
+}
+
+ClassTable::~ClassTable() {
+  free(slots_);
+  for (Slots* slots : retired_slots_) {
+    free(slots);
+  }
+}
+
+ClassTable::Slots* ClassTable::AllocateSlots(size_t capacity) {
+  DCHECK(IsPowerOfTwo(capacity)) << capacity;
+  size_t bytes = sizeof(Slots) + (capacity - 1) * sizeof(Entry);
+  Slots* slots = reinterpret_cast<Slots*>(calloc(1, bytes));
+  CHECK(slots != NULL) << "Failed to allocate a class table of " << capacity << " entries";
+  slots->mask = capacity - 1;
+  return slots;
+}
+
+mirror::Class* ClassTable::Lookup(const char* descriptor,
+                                  const mirror::ClassLoader* class_loader,
+                                  size_t hash) const {
+  const Slots* slots = slots_;
+  const size_t mask = slots->mask;
+  ClassHelper kh;
+  // Tables never fill up, so the probe always reaches an unused slot.
+  for (size_t i = FirstIndex(hash, mask); ; i = (i + 1) & mask) {
+    mirror::Class* klass = slots->entries[i].klass;
+    if (klass == NULL) {
+      return NULL;
+    }
+    if (klass == kRemoved || slots->entries[i].hash != hash ||
+        klass->GetClassLoader() != class_loader) {
+      continue;
+    }
+    kh.ChangeClass(klass);
+    if (strcmp(descriptor, kh.GetDescriptor()) == 0) {
+      if (kIsDebugBuild) {
+        // Check for duplicates in the table.
+        for (size_t j = (i + 1) & mask; slots->entries[j].klass != NULL; j = (j + 1) & mask) {
+          mirror::Class* klass2 = slots->entries[j].klass;
+          if (klass2 == kRemoved || klass2->GetClassLoader() != class_loader) {
+            continue;
+          }
+          kh.ChangeClass(klass2);
+          CHECK(strcmp(descriptor, kh.GetDescriptor()) != 0)
+              << PrettyClass(klass) << " " << klass << " " << klass->GetClassLoader() << " "
+              << PrettyClass(klass2) << " " << klass2 << " " << klass2->GetClassLoader();
+        }
+      }
+      return klass;
+    }
+  }
+}
+
+void ClassTable::LookupAll(const char* descriptor, size_t hash,
+                           std::vector<mirror::Class*>* classes) const {
+  const Slots* slots = slots_;
+  const size_t mask = slots->mask;
+  ClassHelper kh;
+  for (size_t i = FirstIndex(hash, mask); ; i = (i + 1) & mask) {
+    mirror::Class* klass = slots->entries[i].klass;
+    if (klass == NULL) {
+      return;
+    }
+    if (klass != kRemoved && slots->entries[i].hash == hash) {
+      kh.ChangeClass(klass);
+      if (strcmp(descriptor, kh.GetDescriptor()) == 0) {
+        classes->push_back(klass);
+      }
+    }
+  }
+}
+
+void ClassTable::InsertInto(Slots* slots, mirror::Class* klass, size_t hash) {
+  const size_t mask = slots->mask;
+  size_t i = FirstIndex(hash, mask);
+  while (slots->entries[i].klass != NULL) {
+    i = (i + 1) & mask;
+  }
+  slots->entries[i].hash = hash;
+  // Make the hash visible before a reader can find the class.
+  ANDROID_MEMBAR_STORE();
+  slots->entries[i].klass = klass;
+}
+
+void ClassTable::Insert(mirror::Class* klass, size_t hash) {
+  // Keep the load factor, tombstones included, below 3/4.
+  if ((used_ + 1) * 4 > (slots_->mask + 1) * 3) {
+    Grow();
+  }
+  InsertInto(slots_, klass, hash);
+  ++size_;
+  ++used_;
+}
+
+void ClassTable::Grow() {
+  Slots* old_slots = slots_;
+  size_t capacity = old_slots->mask + 1;
+  // Tombstones don't survive the copy, so only grow if there are mostly live classes.
+  if (size_ * 2 >= capacity) {
+    capacity *= 2;
+  }
+  Slots* new_slots = AllocateSlots(capacity);
+  for (size_t i = 0; i <= old_slots->mask; ++i) {
+    mirror::Class* klass = old_slots->entries[i].klass;
+    if (IsLive(klass)) {
+      InsertInto(new_slots, klass, old_slots->entries[i].hash);
+    }
+  }
+  // Readers that already loaded the old table keep probing it, so it stays valid until
+  // FreeRetiredSlots.
+  ANDROID_MEMBAR_STORE();
+  slots_ = new_slots;
+  retired_slots_.push_back(old_slots);
+  used_ = size_;
+}
+
+bool ClassTable::Remove(const char* descriptor, const mirror::ClassLoader* class_loader,
+                        size_t hash) {
+  Slots* slots = slots_;
+  const size_t mask = slots->mask;
+  ClassHelper kh;
+  for (size_t i = FirstIndex(hash, mask); ; i = (i + 1) & mask) {
+    mirror::Class* klass = slots->entries[i].klass;
+    if (klass == NULL) {
+      return false;
+    }
+    if (klass != kRemoved && slots->entries[i].hash == hash &&
+        klass->GetClassLoader() == class_loader) {
+      kh.ChangeClass(klass);
+      if (strcmp(descriptor, kh.GetDescriptor()) == 0) {
+        slots->entries[i].klass = kRemoved;
+        --size_;
+        return true;
+      }
+    }
+  }
+}
+
+void ClassTable::VisitRoots(RootVisitor* visitor, void* arg) const {
+  const Slots* slots = slots_;
+  for (size_t i = 0; i <= slots->mask; ++i) {
+    mirror::Class* klass = slots->entries[i].klass;
+    if (IsLive(klass)) {
+      visitor(klass, arg);
+    }
+  }
+}
+
+void ClassTable::FreeRetiredSlots() {
+  for (Slots* slots : retired_slots_) {
+    free(slots);
+  }
+  retired_slots_.clear();
+}
+
+}  // namespace art
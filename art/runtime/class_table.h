@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_CLASS_TABLE_H_
+#define ART_RUNTIME_CLASS_TABLE_H_
+
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "root_visitor.h"
+
+namespace art {
+
+namespace mirror {
+  class Class;
+  class ClassLoader;
+}  // namespace mirror
+
+// The ClassLinker's table of loaded classes, an open-addressing hash table keyed by descriptor
+// hash and class loader.
+//
+// Changes and iteration require the classlinker_classes_lock_, but Lookup takes no lock at all:
+// slots are published with a store barrier after they are filled in, and a table that is
+// replaced when growing is kept alive until no thread can still be probing it. A lock-free
+// Lookup may miss a class that is being inserted concurrently, so callers that need a
+// definitive answer repeat the lookup with the lock held.
+//
+// Removal, which only the image writer uses, leaves a tombstone that is dropped on the next
+// growth.
+class ClassTable {
+ public:
+  ClassTable();
+  ~ClassTable();
+
+  // Returns the class with the given descriptor and defining loader, or NULL.
+  mirror::Class* Lookup(const char* descriptor, const mirror::ClassLoader* class_loader,
+                        size_t hash) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Appends every class with the given descriptor, whatever its loader, to classes.
+  void LookupAll(const char* descriptor, size_t hash, std::vector<mirror::Class*>* classes) const
+      SHARED_LOCKS_REQUIRED(Locks::classlinker_classes_lock_, Locks::mutator_lock_);
+
+  // Adds a class that isn't in the table yet.
+  void Insert(mirror::Class* klass, size_t hash)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::classlinker_classes_lock_);
+
+  bool Remove(const char* descriptor, const mirror::ClassLoader* class_loader, size_t hash)
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::classlinker_classes_lock_)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Calls visitor(klass) for each class in the table until it returns false.
+  template <typename Visitor>
+  void VisitClasses(Visitor& visitor) const
+      SHARED_LOCKS_REQUIRED(Locks::classlinker_classes_lock_) {
+    const Slots* slots = slots_;
+    for (size_t i = 0; i <= slots->mask; ++i) {
+      mirror::Class* klass = slots->entries[i].klass;
+      if (IsLive(klass) && !visitor(klass)) {
+        return;
+      }
+    }
+  }
+
+  void VisitRoots(RootVisitor* visitor, void* arg) const
+      SHARED_LOCKS_REQUIRED(Locks::classlinker_classes_lock_);
+
+  // Frees the tables replaced by growth. Must only be called while all other threads are
+  // suspended, so that none of them is in the middle of a Lookup.
+  void FreeRetiredSlots()
+      EXCLUSIVE_LOCKS_REQUIRED(Locks::classlinker_classes_lock_, Locks::mutator_lock_);
+
+  size_t Size() const SHARED_LOCKS_REQUIRED(Locks::classlinker_classes_lock_) {
+    return size_;
+  }
+
+ private:
+  static const size_t kInitialCapacity = 1024;  // Must be a power of two.
+
+  struct Entry {
+    size_t hash;
+    // NULL for a slot that was never used, kRemoved for a tombstone.
+    mirror::Class* volatile klass;
+  };
+
+  // The capacity is mask + 1, a power of two. Readers load the table pointer once, so the mask
+  // and the entries they probe always match.
+  struct Slots {
+    size_t mask;
+    Entry entries[1];
+  };
+
+  static Slots* AllocateSlots(size_t capacity);
+  static size_t FirstIndex(size_t hash, size_t mask) {
+    // The descriptor hash is a java.lang.String style hash, whose low bits are poorly mixed.
+    return ((hash ^ (hash >> 16)) * 0x9e3779b1U) & mask;
+  }
+  static bool IsLive(const mirror::Class* klass) {
+    return klass != NULL && klass != kRemoved;
+  }
+  static void InsertInto(Slots* slots, mirror::Class* klass, size_t hash);
+  void Grow() EXCLUSIVE_LOCKS_REQUIRED(Locks::classlinker_classes_lock_);
+
+  static mirror::Class* const kRemoved;
+
+  Slots* volatile slots_;
+  // Live classes, and live classes plus tombstones.
+  size_t size_;
+  size_t used_;
+  std::vector<Slots*> retired_slots_;
+
+  DISALLOW_COPY_AND_ASSIGN(ClassTable);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_CLASS_TABLE_H_
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "class_table.h"
+
+#include <string>
+#include <vector>
+
+#include "common_test.h"
+#include "mirror/class-inl.h"
+#include "object_utils.h"
+
+namespace art {
+
+class ClassTableTest : public CommonTest {};
+
+static bool CollectClass(mirror::Class* klass, void* arg) {
+  reinterpret_cast<std::vector<mirror::Class*>*>(arg)->push_back(klass);
+  return true;
+}
+
+static size_t HashDescriptor(const char* descriptor) {
+  size_t hash = 0;
+  for (; *descriptor != '\0'; ++descriptor) {
+    hash = hash * 31 + *descriptor;
+  }
+  return hash;
+}
+
+TEST_F(ClassTableTest, InsertLookupRemove) {
+  ScopedObjectAccess soa(Thread::Current());
+  std::vector<mirror::Class*> classes;
+  class_linker_->VisitClasses(CollectClass, &classes);
+  ASSERT_FALSE(classes.empty());
+
+  std::vector<std::string> descriptors;
+  for (mirror::Class* klass : classes) {
+    descriptors.push_back(ClassHelper(klass).GetDescriptor());
+  }
+
+  ClassTable table;
+  WriterMutexLock mu(soa.Self(), *Locks::classlinker_classes_lock_);
+  for (size_t i = 0; i < classes.size(); ++i) {
+    table.Insert(classes[i], HashDescriptor(descriptors[i].c_str()));
+  }
+  EXPECT_EQ(classes.size(), table.Size());
+
+  for (size_t i = 0; i < classes.size(); ++i) {
+    const char* descriptor = descriptors[i].c_str();
+    size_t hash = HashDescriptor(descriptor);
+    EXPECT_EQ(classes[i], table.Lookup(descriptor, classes[i]->GetClassLoader(), hash));
+    std::vector<mirror::Class*> all;
+    table.LookupAll(descriptor, hash, &all);
+    EXPECT_EQ(1U, all.size());
+  }
+  EXPECT_TRUE(table.Lookup("LNoSuchClass;", NULL, HashDescriptor("LNoSuchClass;")) == NULL);
+
+  // Remove every other class.
+  for (size_t i = 0; i < classes.size(); i += 2) {
+    const char* descriptor = descriptors[i].c_str();
+    EXPECT_TRUE(table.Remove(descriptor, classes[i]->GetClassLoader(),
+                             HashDescriptor(descriptor)));
+  }
+  EXPECT_EQ(classes.size() / 2, table.Size());
+  for (size_t i = 0; i < classes.size(); ++i) {
+    const char* descriptor = descriptors[i].c_str();
+    mirror::Class* expected = (i % 2 == 0) ? NULL : classes[i];
+    EXPECT_EQ(expected, table.Lookup(descriptor, classes[i]->GetClassLoader(),
+                                     HashDescriptor(descriptor)));
+  }
+
+  size_t visited = 0;
+  auto count = [&visited](mirror::Class* klass) {
+    ++visited;
+    return true;
+  };
+  table.VisitClasses(count);
+  EXPECT_EQ(table.Size(), visited);
+}
+
+}  // namespace art
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "dex_cache_index.h"
+
+#include <stdlib.h>
+
+#include "cutils/atomic-inline.h"
+#include "dex_file.h"
+#include "mirror/dex_cache.h"
+#include "utils.h"
+
+namespace art {
+
+DexCacheIndex::DexCacheIndex() : slots_(AllocateSlots(kInitialCapacity)), size_(0) {
+}
+
+DexCacheIndex::~DexCacheIndex() {
+  free(slots_);
+  for (Slots* slots : retired_slots_) {
+    free(slots);
+  }
+}
+
+DexCacheIndex::Slots* DexCacheIndex::AllocateSlots(size_t capacity) {
+  DCHECK(IsPowerOfTwo(capacity)) << capacity;
+  size_t bytes = sizeof(Slots) + (capacity - 1) * sizeof(mirror::DexCache*);
+  Slots* slots = reinterpret_cast<Slots*>(calloc(1, bytes));
+  CHECK(slots != NULL) << "Failed to allocate a dex cache index of " << capacity << " entries";
+  slots->mask = capacity - 1;
+  return slots;
+}
+
+mirror::DexCache* DexCacheIndex::Find(const DexFile* dex_file) const {
+  const Slots* slots = slots_;
+  const size_t mask = slots->mask;
+  // Tables are never more than half full, so the probe always reaches an unused slot.
+  for (size_t i = FirstIndex(dex_file, mask); ; i = (i + 1) & mask) {
+    mirror::DexCache* dex_cache = slots->entries[i];
+    if (dex_cache == NULL || dex_cache->GetDexFile() == dex_file) {
+      return dex_cache;
+    }
+  }
+}
+
+void DexCacheIndex::InsertInto(Slots* slots, mirror::DexCache* dex_cache) {
+  const size_t mask = slots->mask;
+  size_t i = FirstIndex(dex_cache->GetDexFile(), mask);
+  while (slots->entries[i] != NULL) {
+    i = (i + 1) & mask;
+  }
+  slots->entries[i] = dex_cache;
+}
+
+void DexCacheIndex::Add(mirror::DexCache* dex_cache) {
+  DCHECK(dex_cache->GetDexFile() != NULL);
+  DCHECK(Find(dex_cache->GetDexFile()) == NULL) << dex_cache->GetDexFile()->GetLocation();
+  // Make the dex cache's dex file visible before a reader can find the dex cache.
+  ANDROID_MEMBAR_STORE();
+  Slots* slots = slots_;
+  if ((size_ + 1) * 2 > slots->mask + 1) {
+    Slots* new_slots = AllocateSlots((slots->mask + 1) * 2);
+    for (size_t i = 0; i <= slots->mask; ++i) {
+      if (slots->entries[i] != NULL) {
+        InsertInto(new_slots, slots->entries[i]);
+      }
+    }
+    InsertInto(new_slots, dex_cache);
+    ANDROID_MEMBAR_STORE();
+    slots_ = new_slots;
+    retired_slots_.push_back(slots);
+  } else {
+    InsertInto(slots, dex_cache);
+  }
+  ++size_;
+}
+
+}  // namespace art
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_DEX_CACHE_INDEX_H_
+#define ART_RUNTIME_DEX_CACHE_INDEX_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+
+namespace art {
+
+class DexFile;
+namespace mirror {
+  class DexCache;
+}  // namespace mirror
+
+// Maps a registered DexFile to its DexCache for ClassLinker::FindDexCache, which is on the type,
+// method and field resolution paths.
+//
+// An open-addressing table of DexCache pointers hashed by the address of their DexFile. Find takes
+// no lock: a slot is published with a store barrier once the DexCache's dex file is set, and
+// readers check that dex file rather than a separately stored key. Dex caches are never
+// unregistered, and the few small tables that growth replaces are kept until the index is
+// destroyed, so a reader can't end up probing freed memory. Add must be serialized by the caller.
+class DexCacheIndex {
+ public:
+  DexCacheIndex();
+  ~DexCacheIndex();
+
+  // Returns the DexCache registered for dex_file, or NULL. A DexCache that is being added
+  // concurrently may not be found.
+  mirror::DexCache* Find(const DexFile* dex_file) const
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Adds a DexCache whose dex file is set and not in the index yet.
+  void Add(mirror::DexCache* dex_cache) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+ private:
+  static const size_t kInitialCapacity = 32;  // Must be a power of two.
+
+  // The capacity is mask + 1, a power of two.
+  struct Slots {
+    size_t mask;
+    mirror::DexCache* volatile entries[1];
+  };
+
+  static Slots* AllocateSlots(size_t capacity);
+  static size_t FirstIndex(const DexFile* dex_file, size_t mask) {
+    // DexFiles are heap allocated, so the low bits of their addresses carry no information.
+    return ((reinterpret_cast<uintptr_t>(dex_file) >> 4) * 0x9e3779b1U) & mask;
+  }
+  static void InsertInto(Slots* slots, mirror::DexCache* dex_cache)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  Slots* volatile slots_;
+  size_t size_;
+  std::vector<Slots*> retired_slots_;
+
+  DISALLOW_COPY_AND_ASSIGN(DexCacheIndex);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_DEX_CACHE_INDEX_H_
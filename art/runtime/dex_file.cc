@@ -28,13 +28,16 @@
 #include "base/stringprintf.h"
 #include "class_linker.h"
 #include "dex_file-inl.h"
+#include "dex_file_verification_cache.h"
 #include "dex_file_verifier.h"
 #include "globals.h"
 #include "leb128.h"
+#include "line_number_cache.h"
 #include "mirror/art_field-inl.h"
 #include "mirror/art_method-inl.h"
 #include "mirror/string.h"
 #include "os.h"
+#include "runtime.h"
 #include "safe_map.h"
 #include "thread.h"
 #include "UniquePtr.h"
@@ -197,23 +200,40 @@ const DexFile* DexFile::OpenFile(int fd,
     return NULL;
   }
 
-  if (verify && !DexFileVerifier::Verify(dex_file, dex_file->Begin(), dex_file->Size())) {
+  if (verify && !VerifyOrUseRecord(dex_file, &sbuf)) {
     LOG(ERROR) << "Failed to verify dex file '" << location << "'";
+    delete dex_file;
     return NULL;
   }
 
   return dex_file;
 }
 
+bool DexFile::VerifyOrUseRecord(const DexFile* dex_file, const struct stat* file_stat) {
+  if (file_stat != NULL && DexFileVerificationCache::IsVerified(*dex_file, *file_stat)) {
+    VLOG(class_linker) << "Skipping verification of already verified " << dex_file->GetLocation();
+    return true;
+  }
+  if (!DexFileVerifier::Verify(dex_file, dex_file->Begin(), dex_file->Size())) {
+    return false;
+  }
+  if (file_stat != NULL) {
+    DexFileVerificationCache::MarkVerified(*dex_file, *file_stat);
+  }
+  return true;
+}
+
 const char* DexFile::kClassesDex = "classes.dex";
 
 const DexFile* DexFile::OpenZip(int fd, const std::string& location) {
+  struct stat sbuf;
+  bool have_stat = (fstat(fd, &sbuf) == 0);
   UniquePtr<ZipArchive> zip_archive(ZipArchive::OpenFromFd(fd));
   if (zip_archive.get() == NULL) {
     LOG(ERROR) << "Failed to open " << location << " when looking for classes.dex";
     return NULL;
   }
-  return DexFile::Open(*zip_archive.get(), location);
+  return DexFile::OpenFromZip(*zip_archive.get(), location, have_stat ? &sbuf : NULL);
 }
 
 const DexFile* DexFile::OpenMemory(const std::string& location,
@@ -227,13 +247,22 @@ const DexFile* DexFile::OpenMemory(const std::string& location,
 }
 
 const DexFile* DexFile::Open(const ZipArchive& zip_archive, const std::string& location) {
+  return OpenFromZip(zip_archive, location, NULL);
+}
+
+const DexFile* DexFile::OpenFromZip(const ZipArchive& zip_archive, const std::string& location,
+                                    const struct stat* file_stat) {
   CHECK(!location.empty());
   UniquePtr<ZipEntry> zip_entry(zip_archive.Find(kClassesDex));
   if (zip_entry.get() == NULL) {
     LOG(ERROR) << "Failed to find classes.dex within '" << location << "'";
     return NULL;
   }
-  UniquePtr<MemMap> map(zip_entry->ExtractToMemMap(kClassesDex));
+  // A stored, zipaligned classes.dex is used in place rather than copied out of the archive.
+  UniquePtr<MemMap> map(zip_entry->MapDirectlyFromFile(kClassesDex, sizeof(uint32_t)));
+  if (map.get() == NULL) {
+    map.reset(zip_entry->ExtractToMemMap(kClassesDex));
+  }
   if (map.get() == NULL) {
     LOG(ERROR) << "Failed to extract '" << kClassesDex << "' from '" << location << "'";
     return NULL;
@@ -243,7 +272,7 @@ const DexFile* DexFile::Open(const ZipArchive& zip_archive, const std::string& l
     LOG(ERROR) << "Failed to open dex file '" << location << "' from memory";
     return NULL;
   }
-  if (!DexFileVerifier::Verify(dex_file.get(), dex_file->Begin(), dex_file->Size())) {
+  if (!VerifyOrUseRecord(dex_file.get(), file_stat)) {
     LOG(ERROR) << "Failed to verify dex file '" << location << "'";
     return NULL;
   }
@@ -274,6 +303,7 @@ DexFile::~DexFile() {
   // that's only called after DetachCurrentThread, which means there's no JNIEnv. We could
   // re-attach, but cleaning up these global references is not obviously useful. It's not as if
   // the global reference table is otherwise empty!
+  delete string_id_index_;
 }
 
 bool DexFile::Init() {
@@ -439,7 +469,67 @@ const DexFile::MethodId* DexFile::FindMethodId(const DexFile::TypeId& declaring_
   return NULL;
 }
 
+const DexFile::StringIdIndex* DexFile::GetStringIdIndex() const {
+  StringIdIndex* index = string_id_index_;
+  if (LIKELY(index != NULL)) {
+    return index;
+  }
+  size_t num_string_ids = NumStringIds();
+  if (num_string_ids < kStringIdIndexMinStrings) {
+    return NULL;
+  }
+
+  // Keep the load factor at or below one half so probe sequences stay short.
+  size_t num_slots = RoundUpToPowerOfTwo(num_string_ids * 2);
+  index = new StringIdIndex;
+  index->mask = num_slots - 1;
+  index->slots.reset(new uint32_t[num_slots]);
+  memset(index->slots.get(), 0, num_slots * sizeof(uint32_t));
+  for (size_t i = 0; i < num_string_ids; ++i) {
+    uint32_t slot = ComputeModifiedUtf8Hash(StringDataByIdx(i)) & index->mask;
+    while (index->slots[slot] != 0) {
+      slot = (slot + 1) & index->mask;
+    }
+    index->slots[slot] = i + 1;
+  }
+
+  // Several threads may race to build the index; the first to publish wins.
+  if (!__sync_bool_compare_and_swap(&string_id_index_, NULL, index)) {
+    delete index;
+    return string_id_index_;
+  }
+  VLOG(class_linker) << "Built string id index for " << GetLocation() << ": "
+                     << num_string_ids << " strings, " << PrettySize(GetStringIdIndexBytes());
+  return index;
+}
+
+size_t DexFile::GetStringIdIndexBytes() const {
+  const StringIdIndex* index = string_id_index_;
+  if (index == NULL) {
+    return 0;
+  }
+  return sizeof(*index) + (index->mask + 1) * sizeof(uint32_t);
+}
+
 const DexFile::StringId* DexFile::FindStringId(const char* string) const {
+  const StringIdIndex* index = GetStringIdIndex();
+  if (index != NULL) {
+    // Colliding entries of a different UTF-16 length are rejected without a string compare.
+    const size_t utf16_length = CountModifiedUtf8Chars(string);
+    uint32_t slot = ComputeModifiedUtf8Hash(string) & index->mask;
+    for (uint32_t entry = index->slots[slot]; entry != 0; entry = index->slots[slot]) {
+      const StringId& str_id = GetStringId(entry - 1);
+      uint32_t length;
+      const char* str = GetStringDataAndLength(str_id, &length);
+      if (length == utf16_length &&
+          CompareModifiedUtf8ToModifiedUtf8AsUtf16CodePointValues(string, str) == 0) {
+        return &str_id;
+      }
+      slot = (slot + 1) & index->mask;
+    }
+    return NULL;
+  }
+
   int32_t lo = 0;
   int32_t hi = NumStringIds() - 1;
   while (hi >= lo) {
@@ -460,6 +550,25 @@ const DexFile::StringId* DexFile::FindStringId(const char* string) const {
 }
 
 const DexFile::StringId* DexFile::FindStringId(const uint16_t* string) const {
+  const StringIdIndex* index = GetStringIdIndex();
+  if (index != NULL) {
+    size_t char_count = 0;
+    while (string[char_count] != 0) {
+      ++char_count;
+    }
+    uint32_t slot = ComputeUtf16Hash(string, char_count) & index->mask;
+    for (uint32_t entry = index->slots[slot]; entry != 0; entry = index->slots[slot]) {
+      const StringId& str_id = GetStringId(entry - 1);
+      uint32_t length;
+      const char* str = GetStringDataAndLength(str_id, &length);
+      if (length == char_count && CompareModifiedUtf8ToUtf16AsCodePointValues(str, string) == 0) {
+        return &str_id;
+      }
+      slot = (slot + 1) & index->mask;
+    }
+    return NULL;
+  }
+
   int32_t lo = 0;
   int32_t hi = NumStringIds() - 1;
   while (hi >= lo) {
@@ -627,6 +736,14 @@ int32_t DexFile::GetLineNumFromPC(const mirror::ArtMethod* method, uint32_t rel_
   const CodeItem* code_item = GetCodeItem(method->GetCodeItemOffset());
   DCHECK(code_item != NULL) << PrettyMethod(method) << " " << GetLocation();
 
+  // Stack traces ask for the same methods again and again, so prefer the runtime's cache of
+  // decoded line tables over running the debug info state machine each time.
+  Runtime* runtime = Runtime::Current();
+  if (runtime != NULL && runtime->GetLineNumberCache() != NULL) {
+    return runtime->GetLineNumberCache()->GetLineNumber(*this, code_item, method->IsStatic(),
+                                                        method->GetDexMethodIndex(), rel_pc);
+  }
+
   // A method with no line number info should return -1
   LineNumFromPcContext context(rel_pc, -1);
   DecodeDebugInfo(code_item, method->IsStatic(), method->GetDexMethodIndex(), LineNumForPcCb,
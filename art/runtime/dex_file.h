@@ -17,6 +17,8 @@
 #ifndef ART_RUNTIME_DEX_FILE_H_
 #define ART_RUNTIME_DEX_FILE_H_
 
+#include <sys/stat.h>
+
 #include <string>
 #include <vector>
 
@@ -449,6 +451,13 @@ class DexFile {
   // Looks up a string id for a given utf16 string.
   const StringId* FindStringId(const uint16_t* string) const;
 
+  // Dex files with fewer string ids than this are always searched with a binary search; for them
+  // building the FindStringId hash index would cost more than it saves.
+  static const size_t kStringIdIndexMinStrings = 1024;
+
+  // Returns the memory used by the FindStringId hash index, or 0 if it hasn't been built.
+  size_t GetStringIdIndexBytes() const;
+
   // Returns the number of type identifiers in the .dex file.
   size_t NumTypeIds() const {
     DCHECK(header_ != NULL) << GetLocation();
@@ -828,6 +837,15 @@ class DexFile {
   // Opens a dex file from within a .jar, .zip, or .apk file
   static const DexFile* OpenZip(int fd, const std::string& location);
 
+  // Opens classes.dex from an open zip archive. file_stat describes the archive file, or is NULL
+  // if it is unknown, in which case the verification cache is not used.
+  static const DexFile* OpenFromZip(const ZipArchive& zip_archive, const std::string& location,
+                                    const struct stat* file_stat);
+
+  // Runs the DexFileVerifier, unless the DexFileVerificationCache shows that the file described
+  // by file_stat was verified before. Records the result of a successful verification.
+  static bool VerifyOrUseRecord(const DexFile* dex_file, const struct stat* file_stat);
+
   // Opens a .dex file at the given address backed by a MemMap
   static const DexFile* OpenMemory(const std::string& location,
                                    uint32_t location_checksum,
@@ -856,7 +874,8 @@ class DexFile {
         field_ids_(0),
         method_ids_(0),
         proto_ids_(0),
-        class_defs_(0) {
+        class_defs_(0),
+        string_id_index_(NULL) {
     CHECK(begin_ != NULL) << GetLocation();
     CHECK_GT(size_, 0U) << GetLocation();
   }
@@ -870,6 +889,17 @@ class DexFile {
   // Returns true if the header magic and version numbers are of the expected values.
   bool CheckMagicAndVersion() const;
 
+  // Open-addressing hash table from the java.lang.String hash code of a string to its string id,
+  // used by FindStringId instead of a binary search.
+  struct StringIdIndex {
+    uint32_t mask;  // Number of slots - 1; the number of slots is a power of two.
+    UniquePtr<uint32_t[]> slots;  // String index + 1, or 0 for an empty slot.
+  };
+
+  // Returns the string id hash index, building it on first use, or NULL if this dex file is too
+  // small to have one.
+  const StringIdIndex* GetStringIdIndex() const;
+
   void DecodeDebugInfo0(const CodeItem* code_item, bool is_static, uint32_t method_idx,
       DexDebugNewPositionCb position_cb, DexDebugNewLocalCb local_cb,
       void* context, const byte* stream, LocalInfo* local_in_reg) const;
@@ -916,6 +946,10 @@ class DexFile {
 
   // Points to the base of the class definition list.
   const ClassDef* class_defs_;
+
+  // Lazily built hash index for FindStringId. Published once with a compare-and-swap, after which
+  // it is read without locking.
+  mutable StringIdIndex* volatile string_id_index_;
 };
 
 // Iterate over a dex file's ProtoId's paramters
@@ -16,8 +16,11 @@
 
 #include "dex_file.h"
 
+#include <vector>
+
 #include "UniquePtr.h"
 #include "common_test.h"
+#include "utf.h"
 
 namespace art {
 
@@ -209,6 +212,26 @@ TEST_F(DexFileTest, FindStringId) {
   }
 }
 
+// core.jar is large enough to use the string id hash index; check it finds every string, in both
+// its modified utf8 and utf16 forms, and nothing else.
+TEST_F(DexFileTest, FindStringIdIndexed) {
+  ASSERT_GE(java_lang_dex_file_->NumStringIds(), DexFile::kStringIdIndexMinStrings);
+  for (size_t i = 0; i < java_lang_dex_file_->NumStringIds(); i++) {
+    const DexFile::StringId& expected = java_lang_dex_file_->GetStringId(i);
+    const char* str = java_lang_dex_file_->GetStringData(expected);
+    EXPECT_EQ(&expected, java_lang_dex_file_->FindStringId(str)) << str;
+
+    std::vector<uint16_t> utf16(CountModifiedUtf8Chars(str) + 1, 0);
+    ConvertModifiedUtf8ToUtf16(&utf16[0], str);
+    EXPECT_EQ(&expected, java_lang_dex_file_->FindStringId(&utf16[0])) << str;
+  }
+  EXPECT_NE(0U, java_lang_dex_file_->GetStringIdIndexBytes());
+
+  EXPECT_TRUE(java_lang_dex_file_->FindStringId("Ljava/lang/NoSuchClass;") == NULL);
+  const uint16_t missing[] = { 'N', 'o', 'p', 'e', 0x2603, 0 };
+  EXPECT_TRUE(java_lang_dex_file_->FindStringId(missing) == NULL);
+}
+
 TEST_F(DexFileTest, FindTypeId) {
   for (size_t i = 0; i < java_lang_dex_file_->NumTypeIds(); i++) {
     const char* type_str = java_lang_dex_file_->StringByTypeIdx(i);
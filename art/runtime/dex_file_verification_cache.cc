@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "dex_file_verification_cache.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+#include "base/logging.h"
+#include "base/stringprintf.h"
+#include "base/unix_file/fd_file.h"
+#include "dex_file.h"
+#include "os.h"
+#include "UniquePtr.h"
+#include "utils.h"
+
+namespace art {
+
+static const char kRecordAttribute[] = "user.dex.verified";
+static const byte kRecordMagic[] = { 'd', 'v', 'r', '\n', '0', '0', '3', '\0' };
+
+// The fixed-size part of a record. The location follows it, without a terminating NUL. Records
+// are only ever compared byte for byte against one built for the dex file being opened, so the
+// layout only needs to be stable on a single device.
+//
+// Whole-second mtimes alone would let a same-sized file rewritten within a second, or given its
+// old mtime back with touch(1), reuse a stale record. So the key also has the nanosecond parts,
+// the ctime (which only the kernel sets, and which any rewrite or rename onto the path bumps)
+// and the device and inode.
+struct RecordHeader {
+  byte magic[sizeof(kRecordMagic)];
+  uint64_t mtime;
+  uint64_t mtime_nsec;
+  uint64_t ctime;
+  uint64_t ctime_nsec;
+  uint64_t dev;
+  uint64_t ino;
+  uint64_t size;
+  uint32_t location_checksum;
+  uint32_t location_size;
+  uint8_t signature[DexFile::kSha1DigestSize];
+};
+
+// The nanosecond parts of struct stat times have different names in bionic, glibc and Mac OS.
+static uint64_t GetMtimeNsec(const struct stat& file_stat) {
+#if defined(HAVE_ANDROID_OS)
+  return file_stat.st_mtime_nsec;
+#elif defined(__APPLE__)
+  return file_stat.st_mtimespec.tv_nsec;
+#else
+  return file_stat.st_mtim.tv_nsec;
+#endif
+}
+
+static uint64_t GetCtimeNsec(const struct stat& file_stat) {
+#if defined(HAVE_ANDROID_OS)
+  return file_stat.st_ctime_nsec;
+#elif defined(__APPLE__)
+  return file_stat.st_ctimespec.tv_nsec;
+#else
+  return file_stat.st_ctim.tv_nsec;
+#endif
+}
+
+// Mac OS takes an extra position and options argument for extended attributes.
+static ssize_t GetRecordAttribute(int fd, void* value, size_t size) {
+#if defined(__APPLE__)
+  return fgetxattr(fd, kRecordAttribute, value, size, 0, 0);
+#else
+  return fgetxattr(fd, kRecordAttribute, value, size);
+#endif
+}
+
+static int SetRecordAttribute(int fd, const void* value, size_t size) {
+#if defined(__APPLE__)
+  return fsetxattr(fd, kRecordAttribute, value, size, 0, 0);
+#else
+  return fsetxattr(fd, kRecordAttribute, value, size, 0);
+#endif
+}
+
+static std::string MakeRecord(const DexFile& dex_file, const struct stat& file_stat) {
+  const std::string& location = dex_file.GetLocation();
+  RecordHeader header;
+  memset(&header, 0, sizeof(header));  // Keep the padding deterministic.
+  memcpy(header.magic, kRecordMagic, sizeof(kRecordMagic));
+  header.mtime = file_stat.st_mtime;
+  header.mtime_nsec = GetMtimeNsec(file_stat);
+  header.ctime = file_stat.st_ctime;
+  header.ctime_nsec = GetCtimeNsec(file_stat);
+  header.dev = file_stat.st_dev;
+  header.ino = file_stat.st_ino;
+  header.size = file_stat.st_size;
+  header.location_checksum = dex_file.GetLocationChecksum();
+  header.location_size = location.size();
+  memcpy(header.signature, dex_file.GetHeader().signature_, sizeof(header.signature));
+  std::string record(reinterpret_cast<const char*>(&header), sizeof(header));
+  record += location;
+  return record;
+}
+
+bool DexFileVerificationCache::GetCacheFilename(const std::string& location,
+                                                std::string* cache_filename) {
+  if (location.empty() || location[0] != '/') {
+    return false;
+  }
+  // Unlike GetAndroidData and GetDalvikCacheOrDie, a missing directory just disables the cache.
+  const char* android_data = getenv("ANDROID_DATA");
+  if (android_data == NULL) {
+    android_data = "/data";
+  }
+  std::string dalvik_cache(StringPrintf("%s/dalvik-cache", android_data));
+  if (!OS::DirectoryExists(dalvik_cache.c_str())) {
+    return false;
+  }
+  *cache_filename = GetDalvikCacheFilename(location, dalvik_cache);
+  return true;
+}
+
+bool DexFileVerificationCache::IsVerified(const DexFile& dex_file, const struct stat& file_stat) {
+  if (dex_file.Size() < sizeof(DexFile::Header)) {
+    return false;
+  }
+  std::string cache_filename;
+  if (!GetCacheFilename(dex_file.GetLocation(), &cache_filename)) {
+    return false;
+  }
+  int fd = TEMP_FAILURE_RETRY(open(cache_filename.c_str(), O_RDONLY));
+  if (fd == -1) {
+    return false;
+  }
+  File file(fd);
+  struct stat cache_stat;
+  if (fstat(fd, &cache_stat) == -1 || !S_ISREG(cache_stat.st_mode)) {
+    return false;
+  }
+  // Anybody who can write the cache entry could set a record that gets a malformed dex file past
+  // the verifier.
+  if ((cache_stat.st_uid != 0 && cache_stat.st_uid != getuid()) ||
+      (cache_stat.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+    VLOG(class_linker) << "Ignoring verification record on " << cache_filename
+                       << " with unexpected owner or mode";
+    return false;
+  }
+  std::string expected(MakeRecord(dex_file, file_stat));
+  // A longer record doesn't fit and fails with ERANGE.
+  UniquePtr<char[]> actual(new char[expected.size()]);
+  ssize_t actual_size = GetRecordAttribute(fd, actual.get(), expected.size());
+  if (actual_size != static_cast<ssize_t>(expected.size())) {
+    return false;
+  }
+  return memcmp(actual.get(), expected.data(), expected.size()) == 0;
+}
+
+void DexFileVerificationCache::MarkVerified(const DexFile& dex_file,
+                                            const struct stat& file_stat) {
+  std::string cache_filename;
+  if (!GetCacheFilename(dex_file.GetLocation(), &cache_filename)) {
+    return;
+  }
+  // Never create the cache entry here: the record must not outlive it. dex2oat verifies its input
+  // after the (still empty) output entry has been created, and writing the oat file into it keeps
+  // the attribute. Only the owner of the entry may set the attribute, and the kernel replaces it
+  // atomically, so concurrent readers only ever see a complete record.
+  int fd = TEMP_FAILURE_RETRY(open(cache_filename.c_str(), O_RDONLY));
+  if (fd == -1) {
+    VLOG(class_linker) << "Not recording verification of " << dex_file.GetLocation()
+                       << ": " << strerror(errno);
+    return;
+  }
+  File file(fd);
+  std::string record(MakeRecord(dex_file, file_stat));
+  if (SetRecordAttribute(fd, record.data(), record.size()) != 0) {
+    VLOG(class_linker) << "Failed to record verification of " << dex_file.GetLocation()
+                       << " on " << cache_filename << ": " << strerror(errno);
+  }
+}
+
+}  // namespace art
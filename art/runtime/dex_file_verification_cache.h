@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_DEX_FILE_VERIFICATION_CACHE_H_
+#define ART_RUNTIME_DEX_FILE_VERIFICATION_CACHE_H_
+
+#include <sys/stat.h>
+
+#include <string>
+
+#include "base/macros.h"
+
+namespace art {
+
+class DexFile;
+
+// Remembers, across processes, which dex files have already passed DexFileVerifier. Every process
+// that opens the boot class path or an app's APK otherwise re-verifies the same unchanged dex
+// files, recomputing the header checksum each time.
+//
+// A record is an extended attribute on the dalvik-cache entry for the dex location, so it goes
+// away with that entry whenever installd or the runtime deletes or recreates it. It is keyed by
+// the location, the modification and change times (to the nanosecond), size, device and inode of
+// the file the dex was opened from, the location checksum and the header signature. Records are
+// only trusted when the cache entry is owned by root or the current user and is not writable by
+// anybody else. Caching is best effort: if there is no cache entry yet, or the file system does
+// not support user extended attributes, the dex file is simply verified as before.
+class DexFileVerificationCache {
+ public:
+  // Returns true if a valid record shows that dex_file, opened from the file described by
+  // file_stat, has already been verified.
+  static bool IsVerified(const DexFile& dex_file, const struct stat& file_stat);
+
+  // Records that dex_file, opened from the file described by file_stat, passed verification.
+  static void MarkVerified(const DexFile& dex_file, const struct stat& file_stat);
+
+  // Returns the dalvik-cache entry that holds the record for a dex location in *cache_filename, or
+  // false if there is no dalvik-cache to keep records in.
+  static bool GetCacheFilename(const std::string& location, std::string* cache_filename);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(DexFileVerificationCache);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_DEX_FILE_VERIFICATION_CACHE_H_
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "dex_file_verification_cache.h"
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+
+#include "base/unix_file/fd_file.h"
+#include "common_test.h"
+#include "dex_file.h"
+#include "os.h"
+
+namespace art {
+
+class DexFileVerificationCacheTest : public CommonTest {};
+
+// Host tmp directories are not always on a file system with user extended attributes.
+static bool SupportsUserAttributes(int fd) {
+#if defined(__APPLE__)
+  return fsetxattr(fd, "user.test", "", 0, 0, 0) == 0 || errno != ENOTSUP;
+#else
+  return fsetxattr(fd, "user.test", "", 0, 0) == 0 || errno != ENOTSUP;
+#endif
+}
+
+TEST_F(DexFileVerificationCacheTest, GetCacheFilename) {
+  std::string cache_filename;
+  ASSERT_TRUE(DexFileVerificationCache::GetCacheFilename("/system/framework/core.jar",
+                                                         &cache_filename));
+  EXPECT_EQ(dalvik_cache_ + "/system@framework@core.jar@classes.dex", cache_filename);
+  EXPECT_FALSE(DexFileVerificationCache::GetCacheFilename("core.jar", &cache_filename));
+}
+
+TEST_F(DexFileVerificationCacheTest, RecordsVerification) {
+  ScopedObjectAccess soa(Thread::Current());
+  const DexFile* dex_file = OpenTestDexFile("Nested");
+  const std::string& location = dex_file->GetLocation();
+  std::string cache_filename;
+  ASSERT_TRUE(DexFileVerificationCache::GetCacheFilename(location, &cache_filename));
+  struct stat file_stat;
+  ASSERT_EQ(0, stat(location.c_str(), &file_stat));
+
+  // Without a cache entry there is nowhere to keep a record.
+  DexFileVerificationCache::MarkVerified(*dex_file, file_stat);
+  EXPECT_FALSE(OS::FileExists(cache_filename.c_str()));
+  EXPECT_FALSE(DexFileVerificationCache::IsVerified(*dex_file, file_stat));
+
+  UniquePtr<File> cache_file(OS::CreateEmptyFile(cache_filename.c_str()));
+  ASSERT_TRUE(cache_file.get() != NULL);
+  ASSERT_EQ(0, fchmod(cache_file->Fd(), 0644));
+  if (!SupportsUserAttributes(cache_file->Fd())) {
+    LOG(WARNING) << "Skipping test: no user extended attributes in " << dalvik_cache_;
+    return;
+  }
+  EXPECT_FALSE(DexFileVerificationCache::IsVerified(*dex_file, file_stat));
+  DexFileVerificationCache::MarkVerified(*dex_file, file_stat);
+  EXPECT_TRUE(DexFileVerificationCache::IsVerified(*dex_file, file_stat));
+
+  // A changed file doesn't match the record.
+  struct stat changed_stat(file_stat);
+  changed_stat.st_size++;
+  EXPECT_FALSE(DexFileVerificationCache::IsVerified(*dex_file, changed_stat));
+  changed_stat = file_stat;
+  changed_stat.st_mtime++;
+  EXPECT_FALSE(DexFileVerificationCache::IsVerified(*dex_file, changed_stat));
+  changed_stat = file_stat;
+  changed_stat.st_ctime++;
+  EXPECT_FALSE(DexFileVerificationCache::IsVerified(*dex_file, changed_stat));
+  changed_stat = file_stat;
+  changed_stat.st_ino++;
+  EXPECT_FALSE(DexFileVerificationCache::IsVerified(*dex_file, changed_stat));
+
+  // Nor is a record on a cache entry that others could have written trusted.
+  ASSERT_EQ(0, chmod(cache_filename.c_str(), 0666));
+  EXPECT_FALSE(DexFileVerificationCache::IsVerified(*dex_file, file_stat));
+  ASSERT_EQ(0, chmod(cache_filename.c_str(), 0644));
+  EXPECT_TRUE(DexFileVerificationCache::IsVerified(*dex_file, file_stat));
+
+  // Reopening uses the record.
+  UniquePtr<const DexFile> reopened(DexFile::Open(location, location));
+  ASSERT_TRUE(reopened.get() != NULL);
+  EXPECT_EQ(dex_file->GetLocationChecksum(), reopened->GetLocationChecksum());
+
+  // The record goes away with the cache entry, and a recreated entry starts without one.
+  cache_file.reset();
+  ASSERT_EQ(0, unlink(cache_filename.c_str()));
+  EXPECT_FALSE(DexFileVerificationCache::IsVerified(*dex_file, file_stat));
+  cache_file.reset(OS::CreateEmptyFile(cache_filename.c_str()));
+  ASSERT_TRUE(cache_file.get() != NULL);
+  ASSERT_EQ(0, fchmod(cache_file->Fd(), 0644));
+  EXPECT_FALSE(DexFileVerificationCache::IsVerified(*dex_file, file_stat));
+}
+
+}  // namespace art
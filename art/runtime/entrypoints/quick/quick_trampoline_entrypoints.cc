@@ -513,7 +513,13 @@ extern "C" const void* artQuickResolutionTrampoline(mirror::ArtMethod* called,
     dex_method_idx = (is_range) ? instr->VRegB_3rc() : instr->VRegB_35c();
 
   } else {
-    invoke_type = kStatic;
+    // Either a static method of a class that wasn't initialized yet, or a method whose code is
+    // linked on its first invoke. The caller has already picked the method to run.
+    if (called->IsStatic()) {
+      invoke_type = kStatic;
+    } else {
+      invoke_type = called->IsDirect() ? kDirect : kVirtual;
+    }
     dex_file = &MethodHelper(called).GetDexFile();
     dex_method_idx = called->GetDexMethodIndex();
   }
@@ -524,7 +530,8 @@ extern "C" const void* artQuickResolutionTrampoline(mirror::ArtMethod* called,
   visitor.VisitArguments();
   thread->EndAssertNoThreadSuspension(old_cause);
   // Resolve method filling in dex cache.
-  if (called->IsRuntimeMethod()) {
+  const bool called_is_runtime = called->IsRuntimeMethod();
+  if (called_is_runtime) {
     called = linker->ResolveMethod(dex_method_idx, caller, invoke_type);
   }
   const void* code = NULL;
@@ -532,11 +539,12 @@ extern "C" const void* artQuickResolutionTrampoline(mirror::ArtMethod* called,
     // Incompatible class change should have been handled in resolve method.
     CHECK(!called->CheckIncompatibleClassChange(invoke_type));
     // Refine called method based on receiver.
-    if (invoke_type == kVirtual) {
+    if (called_is_runtime && invoke_type == kVirtual) {
       called = receiver->GetClass()->FindVirtualMethodForVirtual(called);
-    } else if (invoke_type == kInterface) {
+    } else if (called_is_runtime && invoke_type == kInterface) {
       called = receiver->GetClass()->FindVirtualMethodForInterface(called);
     }
+    linker->EnsureCodeLinked(called);
     // Ensure that the called method's class is initialized.
     mirror::Class* called_class = called->GetDeclaringClass();
     linker->EnsureInitialized(called_class, true, true);
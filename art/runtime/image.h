@@ -96,6 +96,7 @@ class PACKED(4) ImageHeader {
     kOatLocation,
     kDexCaches,
     kClassRoots,
+    kClassIndex,  // An int[] built by ImageClassIndex.
     kImageRootsMax,
   };
 
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "image_class_index.h"
+
+#include <string.h>
+
+#include "dex_file.h"
+#include "mirror/array-inl.h"
+#include "mirror/dex_cache.h"
+#include "mirror/object_array-inl.h"
+#include "utf.h"
+#include "utils.h"
+
+namespace art {
+
+static size_t FirstIndex(uint32_t hash, size_t mask) {
+  // The descriptor hash is a java.lang.String style hash, whose low bits are poorly mixed.
+  return ((hash ^ (hash >> 16)) * 0x9e3779b1U) & mask;
+}
+
+mirror::IntArray* ImageClassIndex::Create(Thread* self,
+                                          const std::vector<mirror::DexCache*>& dex_caches) {
+  // Packed entries must stay non-negative, so that they can't collide with kUnused and shifting
+  // them right recovers the dex cache index.
+  CHECK_LT(dex_caches.size(), 0x8000U);
+  size_t class_count = 0;
+  for (mirror::DexCache* dex_cache : dex_caches) {
+    mirror::ObjectArray<mirror::Class>* types = dex_cache->GetResolvedTypes();
+    for (int32_t type_idx = 0; type_idx < types->GetLength(); ++type_idx) {
+      if (types->Get(type_idx) != NULL) {
+        ++class_count;
+      }
+    }
+  }
+  // Keep the table at most half full, counting duplicates.
+  size_t capacity = 16;
+  while (capacity < class_count * 2) {
+    capacity *= 2;
+  }
+  const size_t mask = capacity - 1;
+  std::vector<int32_t> entries(capacity * 2, kUnused);
+  size_t size = 0;
+  for (size_t i = 0; i < dex_caches.size(); ++i) {
+    mirror::DexCache* dex_cache = dex_caches[i];
+    const DexFile* dex_file = dex_cache->GetDexFile();
+    mirror::ObjectArray<mirror::Class>* types = dex_cache->GetResolvedTypes();
+    for (int32_t type_idx = 0; type_idx < types->GetLength(); ++type_idx) {
+      if (types->Get(type_idx) == NULL) {
+        continue;
+      }
+      const char* descriptor = dex_file->StringByTypeIdx(type_idx);
+      uint32_t hash = ComputeModifiedUtf8Hash(descriptor);
+      size_t slot = FirstIndex(hash, mask);
+      for (; entries[slot * 2 + 1] != kUnused; slot = (slot + 1) & mask) {
+        if (static_cast<uint32_t>(entries[slot * 2]) != hash) {
+          continue;
+        }
+        int32_t packed = entries[slot * 2 + 1];
+        const DexFile* other_dex_file = dex_caches[packed >> 16]->GetDexFile();
+        if (strcmp(descriptor, other_dex_file->StringByTypeIdx(packed & 0xffff)) == 0) {
+          break;  // An earlier dex cache has it.
+        }
+      }
+      if (entries[slot * 2 + 1] == kUnused) {
+        entries[slot * 2] = hash;
+        entries[slot * 2 + 1] = static_cast<int32_t>((i << 16) | type_idx);
+        ++size;
+      }
+    }
+  }
+  mirror::IntArray* index = mirror::IntArray::Alloc(self, entries.size());
+  CHECK(index != NULL);
+  memcpy(index->GetData(), &entries[0], entries.size() * sizeof(int32_t));
+  VLOG(compiler) << "Image class index has " << size << " classes in " << capacity << " entries";
+  return index;
+}
+
+mirror::Class* ImageClassIndex::Lookup(const mirror::IntArray* index,
+                                       mirror::ObjectArray<mirror::DexCache>* dex_caches,
+                                       const char* descriptor, size_t hash) {
+  const int32_t* entries = index->GetData();
+  const size_t mask = index->GetLength() / 2 - 1;
+  for (size_t slot = FirstIndex(static_cast<uint32_t>(hash), mask); ; slot = (slot + 1) & mask) {
+    int32_t packed = entries[slot * 2 + 1];
+    if (packed == kUnused) {
+      return NULL;
+    }
+    if (static_cast<uint32_t>(entries[slot * 2]) != static_cast<uint32_t>(hash)) {
+      continue;
+    }
+    mirror::DexCache* dex_cache = dex_caches->Get(packed >> 16);
+    uint16_t type_idx = packed & 0xffff;
+    if (strcmp(descriptor, dex_cache->GetDexFile()->StringByTypeIdx(type_idx)) == 0) {
+      return dex_cache->GetResolvedType(type_idx);
+    }
+  }
+}
+
+size_t ImageClassIndex::Size(const mirror::IntArray* index) {
+  const int32_t* entries = index->GetData();
+  size_t size = 0;
+  for (int32_t i = 1; i < index->GetLength(); i += 2) {
+    if (entries[i] != kUnused) {
+      ++size;
+    }
+  }
+  return size;
+}
+
+}  // namespace art
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_IMAGE_CLASS_INDEX_H_
+#define ART_RUNTIME_IMAGE_CLASS_INDEX_H_
+
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "mirror/array.h"
+
+namespace art {
+
+namespace mirror {
+  class Class;
+  class DexCache;
+  template<class T> class ObjectArray;
+}  // namespace mirror
+class Thread;
+
+// An index from class descriptor to the image classes, stored in the image as the
+// ImageHeader::kClassIndex root so that ClassLinker::LookupClassFromImage needn't search the
+// types of every image dex cache.
+//
+// The index is an int[] holding an open-addressing hash table. Each entry is two ints: the
+// descriptor hash, and the index of the image dex cache in the kDexCaches root shifted left by 16
+// bits, or'ed with the type index that the class is resolved at in that dex cache. There may be at
+// most 0x7fff dex caches, so this is never negative. Unused entries have kUnused as their second
+// int. Each descriptor appears once, for the first dex cache that
+// has it resolved.
+class ImageClassIndex {
+ public:
+  // Builds the index for the classes resolved in the given dex caches, which are in the order of
+  // the image's kDexCaches root.
+  static mirror::IntArray* Create(Thread* self, const std::vector<mirror::DexCache*>& dex_caches)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Returns the image class with the given descriptor, whose ComputeModifiedUtf8Hash is hash,
+  // or NULL if there is none.
+  static mirror::Class* Lookup(const mirror::IntArray* index,
+                               mirror::ObjectArray<mirror::DexCache>* dex_caches,
+                               const char* descriptor, size_t hash)
+      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // Returns the number of classes in the index.
+  static size_t Size(const mirror::IntArray* index) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+ private:
+  static const int32_t kUnused = -1;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(ImageClassIndex);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_IMAGE_CLASS_INDEX_H_
@@ -49,14 +49,13 @@ static bool InstallStubsClassVisitor(mirror::Class* klass, void* arg)
 
 bool Instrumentation::InstallStubsForClass(mirror::Class* klass) {
   bool uninstall = !entry_exit_stubs_installed_ && !interpreter_stubs_installed_;
-  ClassLinker* class_linker = NULL;
-  if (uninstall) {
-    class_linker = Runtime::Current()->GetClassLinker();
-  }
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
   bool is_initialized = klass->IsInitialized();
   for (size_t i = 0; i < klass->NumDirectMethods(); i++) {
     mirror::ArtMethod* method = klass->GetDirectMethod(i);
     if (!method->IsAbstract() && !method->IsProxyMethod()) {
+      // The stubs and GetQuickCodeFor expect the method's frame layout to be known.
+      class_linker->EnsureCodeLinked(method);
       const void* new_code;
       if (uninstall) {
         if (forced_interpret_only_ && !method->IsNative()) {
@@ -79,6 +78,7 @@ bool Instrumentation::InstallStubsForClass(mirror::Class* klass) {
   for (size_t i = 0; i < klass->NumVirtualMethods(); i++) {
     mirror::ArtMethod* method = klass->GetVirtualMethod(i);
     if (!method->IsAbstract() && !method->IsProxyMethod()) {
+      class_linker->EnsureCodeLinked(method);
       const void* new_code;
       if (uninstall) {
         if (forced_interpret_only_ && !method->IsNative()) {
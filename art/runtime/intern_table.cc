@@ -16,6 +16,11 @@
 
 #include "intern_table.h"
 
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include "cutils/atomic-inline.h"
 #include "gc/space/image_space.h"
 #include "mirror/dex_cache.h"
 #include "mirror/object_array-inl.h"
@@ -24,68 +29,230 @@
 #include "thread.h"
 #include "UniquePtr.h"
 #include "utf.h"
+#include "utils.h"
 
 namespace art {
 
-InternTable::InternTable()
-    : intern_table_lock_("InternTable lock"), is_dirty_(false), allow_new_interns_(true),
-      new_intern_condition_("New intern condition", intern_table_lock_) {
+InternTable::StringSet::StringSet(bool concurrent_readers)
+    : concurrent_readers_(concurrent_readers), slots_(AllocateSlots(kInitialCapacity)),
+      size_(0) {
 }
 
-size_t InternTable::Size() const {
-  MutexLock mu(Thread::Current(), intern_table_lock_);
-  return strong_interns_.size() + weak_interns_.size();
+InternTable::StringSet::~StringSet() {
+  free(slots_);
+  FreeRetiredSlots();
 }
 
-void InternTable::DumpForSigQuit(std::ostream& os) const {
-  MutexLock mu(Thread::Current(), intern_table_lock_);
-  os << "Intern table: " << strong_interns_.size() << " strong; "
-     << weak_interns_.size() << " weak\n";
+InternTable::StringSet::Slots* InternTable::StringSet::AllocateSlots(size_t capacity) {
+  DCHECK(IsPowerOfTwo(capacity)) << capacity;
+  size_t bytes = sizeof(Slots) + (capacity - 1) * sizeof(mirror::String*);
+  Slots* slots = reinterpret_cast<Slots*>(calloc(1, bytes));
+  CHECK(slots != NULL) << "Failed to allocate an intern table of " << capacity << " entries";
+  slots->mask = capacity - 1;
+  return slots;
 }
 
-void InternTable::VisitRoots(RootVisitor* visitor, void* arg,
-                             bool only_dirty, bool clean_dirty) {
-  MutexLock mu(Thread::Current(), intern_table_lock_);
-  if (!only_dirty || is_dirty_) {
-    for (const auto& strong_intern : strong_interns_) {
-      visitor(strong_intern.second, arg);
+mirror::String* InternTable::StringSet::Find(mirror::String* s, int32_t hash_code) const {
+  const Slots* slots = slots_;
+  const size_t mask = slots->mask;
+  // Sets never fill up, so the probe always reaches an unused slot.
+  for (size_t i = FirstIndex(hash_code, mask); ; i = (i + 1) & mask) {
+    mirror::String* existing = slots->entries[i];
+    if (existing == NULL) {
+      return NULL;
     }
-    if (clean_dirty) {
-      is_dirty_ = false;
+    // The hash code of an interned string was computed before it was added.
+    if (existing->GetHashCode() == hash_code && existing->Equals(s)) {
+      return existing;
     }
   }
-  // Note: we deliberately don't visit the weak_interns_ table and the immutable
-  // image roots.
 }
 
-mirror::String* InternTable::Lookup(Table& table, mirror::String* s,
-                                    uint32_t hash_code) {
-  intern_table_lock_.AssertHeld(Thread::Current());
-  for (auto it = table.find(hash_code), end = table.end(); it != end; ++it) {
-    mirror::String* existing_string = it->second;
-    if (existing_string->Equals(s)) {
-      return existing_string;
-    }
+void InternTable::StringSet::InsertInto(Slots* slots, mirror::String* s, int32_t hash_code) {
+  const size_t mask = slots->mask;
+  size_t i = FirstIndex(hash_code, mask);
+  while (slots->entries[i] != NULL) {
+    i = (i + 1) & mask;
   }
-  return NULL;
+  slots->entries[i] = s;
 }
 
-mirror::String* InternTable::Insert(Table& table, mirror::String* s,
-                                    uint32_t hash_code) {
-  intern_table_lock_.AssertHeld(Thread::Current());
-  table.insert(std::make_pair(hash_code, s));
-  return s;
+void InternTable::StringSet::Add(mirror::String* s, int32_t hash_code) {
+  // Keep the load factor at or below 1/2 so that probes stay short.
+  if ((size_ + 1) * 2 > Capacity()) {
+    Resize(Capacity() * 2);
+  }
+  if (concurrent_readers_) {
+    // Make the string's contents and cached hash code visible before a reader can find it.
+    ANDROID_MEMBAR_STORE();
+  }
+  InsertInto(slots_, s, hash_code);
+  ++size_;
+}
+
+void InternTable::StringSet::Resize(size_t capacity) {
+  Slots* old_slots = slots_;
+  Slots* new_slots = AllocateSlots(capacity);
+  for (size_t i = 0; i <= old_slots->mask; ++i) {
+    mirror::String* s = old_slots->entries[i];
+    if (s != NULL) {
+      InsertInto(new_slots, s, s->GetHashCode());
+    }
+  }
+  if (concurrent_readers_) {
+    // Readers that already loaded the old slots keep probing them, so they stay valid until
+    // FreeRetiredSlots.
+    ANDROID_MEMBAR_STORE();
+    slots_ = new_slots;
+    retired_slots_.push_back(old_slots);
+  } else {
+    slots_ = new_slots;
+    free(old_slots);
+  }
 }
 
-void InternTable::Remove(Table& table, const mirror::String* s,
-                         uint32_t hash_code) {
-  intern_table_lock_.AssertHeld(Thread::Current());
-  for (auto it = table.find(hash_code), end = table.end(); it != end; ++it) {
-    if (it->second == s) {
-      table.erase(it);
+void InternTable::StringSet::Remove(const mirror::String* s, int32_t hash_code) {
+  DCHECK(!concurrent_readers_);
+  Slots* slots = slots_;
+  const size_t mask = slots->mask;
+  size_t i = FirstIndex(hash_code, mask);
+  while (slots->entries[i] != s) {
+    if (slots->entries[i] == NULL) {
       return;
     }
+    i = (i + 1) & mask;
+  }
+  // Shift back any later strings of the probe sequence that can no longer be reached, rather
+  // than leaving a tombstone.
+  slots->entries[i] = NULL;
+  for (size_t j = (i + 1) & mask; slots->entries[j] != NULL; j = (j + 1) & mask) {
+    size_t k = FirstIndex(slots->entries[j]->GetHashCode(), mask);
+    // Move the string at j into the hole at i unless its preferred slot k lies cyclically in
+    // (i, j], in which case the hole doesn't break its probe sequence.
+    bool reachable = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+    if (!reachable) {
+      slots->entries[i] = slots->entries[j];
+      slots->entries[j] = NULL;
+      i = j;
+    }
   }
+  --size_;
+}
+
+void InternTable::StringSet::Sweep(IsMarkedTester is_marked, void* arg) {
+  DCHECK(!concurrent_readers_);
+  Slots* slots = slots_;
+  size_t removed = 0;
+  for (size_t i = 0; i <= slots->mask; ++i) {
+    mirror::String* s = slots->entries[i];
+    if (s != NULL && !is_marked(s, arg)) {
+      slots->entries[i] = NULL;
+      ++removed;
+    }
+  }
+  if (removed == 0) {
+    return;
+  }
+  // Clearing slots breaks probe sequences, so rehash the survivors all at once, shrinking the set
+  // when most of it died.
+  size_ -= removed;
+  size_t capacity = kInitialCapacity;
+  while (size_ * 4 > capacity) {
+    capacity *= 2;
+  }
+  Resize(capacity);
+}
+
+void InternTable::StringSet::VisitRoots(RootVisitor* visitor, void* arg) const {
+  const Slots* slots = slots_;
+  for (size_t i = 0; i <= slots->mask; ++i) {
+    mirror::String* s = slots->entries[i];
+    if (s != NULL) {
+      visitor(s, arg);
+    }
+  }
+}
+
+void InternTable::StringSet::FreeRetiredSlots() {
+  for (Slots* slots : retired_slots_) {
+    free(slots);
+  }
+  retired_slots_.clear();
+}
+
+void InternTable::StringSet::GetProbeStats(size_t* total_probes, size_t* max_probes) const {
+  const Slots* slots = slots_;
+  const size_t mask = slots->mask;
+  for (size_t i = 0; i <= mask; ++i) {
+    mirror::String* s = slots->entries[i];
+    if (s != NULL) {
+      size_t distance = (i - FirstIndex(s->GetHashCode(), mask)) & mask;
+      *total_probes += distance;
+      *max_probes = std::max(*max_probes, distance);
+    }
+  }
+}
+
+InternTable::Shard::Shard()
+    : lock("InternTable lock"), is_dirty(false), allow_new_interns(true),
+      new_intern_condition("New intern condition", lock), strong_interns(true),
+      weak_interns(false) {
+}
+
+InternTable::InternTable() {
+}
+
+size_t InternTable::Size() const {
+  Thread* self = Thread::Current();
+  size_t size = 0;
+  for (const Shard& shard : shards_) {
+    MutexLock mu(self, shard.lock);
+    size += shard.strong_interns.Size() + shard.weak_interns.Size();
+  }
+  return size;
+}
+
+void InternTable::DumpForSigQuit(std::ostream& os) const {
+  Thread* self = Thread::Current();
+  size_t strong = 0;
+  size_t weak = 0;
+  size_t capacity = 0;
+  size_t total_probes = 0;
+  size_t max_probes = 0;
+  for (const Shard& shard : shards_) {
+    MutexLock mu(self, shard.lock);
+    strong += shard.strong_interns.Size();
+    weak += shard.weak_interns.Size();
+    capacity += shard.strong_interns.Capacity() + shard.weak_interns.Capacity();
+    shard.strong_interns.GetProbeStats(&total_probes, &max_probes);
+    shard.weak_interns.GetProbeStats(&total_probes, &max_probes);
+  }
+  os << "Intern table: " << strong << " strong; " << weak << " weak\n";
+  if (strong + weak != 0) {
+    os << "Intern table probes: " << capacity << " slots; mean extra probes "
+       << static_cast<double>(total_probes) / (strong + weak) << "; max " << max_probes << "\n";
+  }
+}
+
+void InternTable::VisitRoots(RootVisitor* visitor, void* arg,
+                             bool only_dirty, bool clean_dirty) {
+  Thread* self = Thread::Current();
+  // No thread can be in a lock-free lookup while the world is stopped.
+  bool free_retired_slots = Locks::mutator_lock_->IsExclusiveHeld(self);
+  for (Shard& shard : shards_) {
+    MutexLock mu(self, shard.lock);
+    if (!only_dirty || shard.is_dirty) {
+      shard.strong_interns.VisitRoots(visitor, arg);
+      if (clean_dirty) {
+        shard.is_dirty = false;
+      }
+    }
+    if (free_retired_slots) {
+      shard.strong_interns.FreeRetiredSlots();
+    }
+  }
+  // Note: we deliberately don't visit the weak tables and the immutable
+  // image roots.
 }
 
 static mirror::String* LookupStringFromImage(mirror::String* s)
@@ -115,74 +282,86 @@ static mirror::String* LookupStringFromImage(mirror::String* s)
 
 void InternTable::AllowNewInterns() {
   Thread* self = Thread::Current();
-  MutexLock mu(self, intern_table_lock_);
-  allow_new_interns_ = true;
-  new_intern_condition_.Broadcast(self);
+  for (Shard& shard : shards_) {
+    MutexLock mu(self, shard.lock);
+    shard.allow_new_interns = true;
+    shard.new_intern_condition.Broadcast(self);
+  }
 }
 
 void InternTable::DisallowNewInterns() {
   Thread* self = Thread::Current();
-  MutexLock mu(self, intern_table_lock_);
-  allow_new_interns_ = false;
+  for (Shard& shard : shards_) {
+    MutexLock mu(self, shard.lock);
+    shard.allow_new_interns = false;
+  }
 }
 
 mirror::String* InternTable::Insert(mirror::String* s, bool is_strong) {
+  DCHECK(s != NULL);
+  int32_t hash_code = s->GetHashCode();
+  Shard& shard = shards_[ShardIndex(hash_code)];
+
+  // Strongly interned strings are never removed or swept, so a match can be returned without
+  // locking or waiting for new interns to be allowed.
+  mirror::String* strong = shard.strong_interns.Find(s, hash_code);
+  if (strong != NULL) {
+    return strong;
+  }
+
   Thread* self = Thread::Current();
-  MutexLock mu(self, intern_table_lock_);
+  MutexLock mu(self, shard.lock);
 
-  DCHECK(s != NULL);
-  uint32_t hash_code = s->GetHashCode();
+  while (UNLIKELY(!shard.allow_new_interns)) {
+    shard.new_intern_condition.WaitHoldingLocks(self);
+  }
 
-  while (UNLIKELY(!allow_new_interns_)) {
-    new_intern_condition_.WaitHoldingLocks(self);
+  // Check the strong table again, another thread may have added a match since.
+  strong = shard.strong_interns.Find(s, hash_code);
+  if (strong != NULL) {
+    return strong;
   }
 
   if (is_strong) {
-    // Check the strong table for a match.
-    mirror::String* strong = Lookup(strong_interns_, s, hash_code);
-    if (strong != NULL) {
-      return strong;
-    }
-
     // Mark as dirty so that we rescan the roots.
-    is_dirty_ = true;
+    shard.is_dirty = true;
 
     // Check the image for a match.
     mirror::String* image = LookupStringFromImage(s);
     if (image != NULL) {
-      return Insert(strong_interns_, image, hash_code);
+      shard.strong_interns.Add(image, hash_code);
+      return image;
     }
 
     // There is no match in the strong table, check the weak table.
-    mirror::String* weak = Lookup(weak_interns_, s, hash_code);
+    mirror::String* weak = shard.weak_interns.Find(s, hash_code);
     if (weak != NULL) {
       // A match was found in the weak table. Promote to the strong table.
-      Remove(weak_interns_, weak, hash_code);
-      return Insert(strong_interns_, weak, hash_code);
+      shard.weak_interns.Remove(weak, hash_code);
+      shard.strong_interns.Add(weak, hash_code);
+      return weak;
     }
 
     // No match in the strong table or the weak table. Insert into the strong
     // table.
-    return Insert(strong_interns_, s, hash_code);
+    shard.strong_interns.Add(s, hash_code);
+    return s;
   }
 
-  // Check the strong table for a match.
-  mirror::String* strong = Lookup(strong_interns_, s, hash_code);
-  if (strong != NULL) {
-    return strong;
-  }
   // Check the image for a match.
   mirror::String* image = LookupStringFromImage(s);
   if (image != NULL) {
-    return Insert(weak_interns_, image, hash_code);
+    shard.weak_interns.Add(image, hash_code);
+    return image;
   }
   // Check the weak table for a match.
-  mirror::String* weak = Lookup(weak_interns_, s, hash_code);
+  mirror::String* weak = shard.weak_interns.Find(s, hash_code);
   if (weak != NULL) {
     return weak;
   }
   // Insert into the weak table.
-  return Insert(weak_interns_, s, hash_code);
+  shard.weak_interns.Add(s, hash_code);
+  return s;
 }
 
 mirror::String* InternTable::InternStrong(int32_t utf16_length,
@@ -211,21 +390,18 @@ mirror::String* InternTable::InternWeak(mirror::String* s) {
 }
 
 bool InternTable::ContainsWeak(mirror::String* s) {
-  MutexLock mu(Thread::Current(), intern_table_lock_);
-  const mirror::String* found = Lookup(weak_interns_, s, s->GetHashCode());
+  int32_t hash_code = s->GetHashCode();
+  Shard& shard = shards_[ShardIndex(hash_code)];
+  MutexLock mu(Thread::Current(), shard.lock);
+  const mirror::String* found = shard.weak_interns.Find(s, hash_code);
   return found == s;
 }
 
 void InternTable::SweepInternTableWeaks(IsMarkedTester is_marked, void* arg) {
-  MutexLock mu(Thread::Current(), intern_table_lock_);
-  // TODO: std::remove_if + lambda.
-  for (auto it = weak_interns_.begin(), end = weak_interns_.end(); it != end;) {
-    mirror::Object* object = it->second;
-    if (!is_marked(object, arg)) {
-      weak_interns_.erase(it++);
-    } else {
-      ++it;
-    }
+  Thread* self = Thread::Current();
+  for (Shard& shard : shards_) {
+    MutexLock mu(self, shard.lock);
+    shard.weak_interns.Sweep(is_marked, arg);
   }
 }
 
@@ -17,11 +17,12 @@
 #ifndef ART_RUNTIME_INTERN_TABLE_H_
 #define ART_RUNTIME_INTERN_TABLE_H_
 
+#include <vector>
+
+#include "base/macros.h"
 #include "base/mutex.h"
 #include "root_visitor.h"
 
-#include <map>
-
 namespace art {
 namespace mirror {
 class String;
@@ -36,6 +37,13 @@ class String;
  * String.intern. Some code (XML parsers being a prime example) relies on being able to intern
  * arbitrarily many strings for the duration of a parse without permanently increasing the memory
  * footprint.
+ *
+ * The strings are spread over a fixed number of shards by hash code, each with its own lock, so
+ * that threads interning unrelated strings don't contend. Within a shard both tables use open
+ * addressing. Strings are never removed from a strong table, which lets InternStrong and
+ * InternWeak find an already strongly interned string, the common case for string literals
+ * resolved by more than one dex cache, without taking any lock. Everything else happens under
+ * the shard's lock.
  */
 class InternTable {
  public:
@@ -70,22 +78,86 @@ class InternTable {
   void AllowNewInterns() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
  private:
-  typedef std::multimap<int32_t, mirror::String*> Table;
+  static const size_t kShardBits = 4;
+  static const size_t kShardCount = 1 << kShardBits;
+
+  // An open-addressing set of strings keyed by their hash code. Only a set that never has strings
+  // removed may be probed by Find without holding its shard's lock; replaced slot arrays of such
+  // a set are kept until FreeRetiredSlots.
+  class StringSet {
+   public:
+    explicit StringSet(bool concurrent_readers);
+    ~StringSet();
+
+    mirror::String* Find(mirror::String* s, int32_t hash_code) const
+        SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+    void Add(mirror::String* s, int32_t hash_code);
+    // Removes s itself, rather than a string equal to it, if present.
+    void Remove(const mirror::String* s, int32_t hash_code);
+    // Drops the strings that aren't marked, in a single pass over the set.
+    void Sweep(IsMarkedTester is_marked, void* arg);
+    void VisitRoots(RootVisitor* visitor, void* arg) const;
+    void FreeRetiredSlots();
+
+    size_t Size() const {
+      return size_;
+    }
+    size_t Capacity() const {
+      return slots_->mask + 1;
+    }
+    // Adds the distance of each string from its preferred slot to *total_probes, and raises
+    // *max_probes to the longest one.
+    void GetProbeStats(size_t* total_probes, size_t* max_probes) const;
+
+   private:
+    static const size_t kInitialCapacity = 64;  // Must be a power of two.
+
+    // The capacity is mask + 1, a power of two.
+    struct Slots {
+      size_t mask;
+      mirror::String* volatile entries[1];
+    };
+
+    static Slots* AllocateSlots(size_t capacity);
+    static size_t FirstIndex(int32_t hash_code, size_t mask) {
+      uint32_t hash = static_cast<uint32_t>(hash_code);
+      return ((hash ^ (hash >> 16)) * 0x9e3779b1U) & mask;
+    }
+    static void InsertInto(Slots* slots, mirror::String* s, int32_t hash_code);
+    void Resize(size_t capacity);
+
+    const bool concurrent_readers_;
+    Slots* volatile slots_;
+    size_t size_;
+    std::vector<Slots*> retired_slots_;
+
+    DISALLOW_COPY_AND_ASSIGN(StringSet);
+  };
+
+  struct Shard {
+    Shard();
+
+    mutable Mutex lock;
+    bool is_dirty GUARDED_BY(lock);
+    bool allow_new_interns GUARDED_BY(lock);
+    ConditionVariable new_intern_condition GUARDED_BY(lock);
+    // Mutated under lock, but Find may be called on strong_interns without it.
+    StringSet strong_interns;
+    StringSet weak_interns GUARDED_BY(lock);
+  };
+
+  static size_t ShardIndex(int32_t hash_code) {
+    // Use the high bits of the mixed hash; StringSet uses the low ones to pick a slot.
+    uint32_t hash = static_cast<uint32_t>(hash_code);
+    return ((hash ^ (hash >> 16)) * 0x9e3779b1U) >> (32 - kShardBits);
+  }
 
   mirror::String* Insert(mirror::String* s, bool is_strong)
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
-  mirror::String* Lookup(Table& table, mirror::String* s, uint32_t hash_code)
-      SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
-  mirror::String* Insert(Table& table, mirror::String* s, uint32_t hash_code);
-  void Remove(Table& table, const mirror::String* s, uint32_t hash_code);
-
-  mutable Mutex intern_table_lock_;
-  bool is_dirty_ GUARDED_BY(intern_table_lock_);
-  bool allow_new_interns_ GUARDED_BY(intern_table_lock_);
-  ConditionVariable new_intern_condition_ GUARDED_BY(intern_table_lock_);
-  Table strong_interns_ GUARDED_BY(intern_table_lock_);
-  Table weak_interns_ GUARDED_BY(intern_table_lock_);
+  Shard shards_[kShardCount];
+
+  DISALLOW_COPY_AND_ASSIGN(InternTable);
 };
 
 }  // namespace art
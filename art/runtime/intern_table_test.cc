@@ -16,8 +16,13 @@
 
 #include "intern_table.h"
 
+#include <set>
+
+#include "base/stringprintf.h"
+#include "class_linker-inl.h"
 #include "common_test.h"
 #include "mirror/object.h"
+#include "mirror/object_array-inl.h"
 #include "sirt_ref.h"
 
 namespace art {
@@ -167,4 +172,46 @@ TEST_F(InternTableTest, ContainsWeak) {
   }
 }
 
+static bool IsInSet(const mirror::Object* object, void* arg) {
+  return reinterpret_cast<std::set<const mirror::Object*>*>(arg)->count(object) != 0;
+}
+
+TEST_F(InternTableTest, ManyStrings) {
+  ScopedObjectAccess soa(Thread::Current());
+  const int32_t kStringCount = 1000;  // Enough to grow every shard several times.
+  SirtRef<mirror::ObjectArray<mirror::String> > strings(soa.Self(),
+      class_linker_->AllocStringArray(soa.Self(), kStringCount));
+  ASSERT_TRUE(strings.get() != NULL);
+  InternTable t;
+  for (int32_t i = 0; i < kStringCount; ++i) {
+    std::string utf8(StringPrintf("string %d", i));
+    strings->Set(i, mirror::String::AllocFromModifiedUtf8(soa.Self(), utf8.c_str()));
+    ASSERT_EQ(strings->Get(i), t.InternWeak(strings->Get(i)));
+  }
+  EXPECT_EQ(static_cast<size_t>(kStringCount), t.Size());
+
+  // Promote every other string, which removes it from its weak table.
+  for (int32_t i = 0; i < kStringCount; i += 2) {
+    std::string utf8(StringPrintf("string %d", i));
+    EXPECT_EQ(strings->Get(i), t.InternStrong(utf8.c_str()));
+    EXPECT_FALSE(t.ContainsWeak(strings->Get(i)));
+  }
+  EXPECT_EQ(static_cast<size_t>(kStringCount), t.Size());
+
+  // Sweep half of the remaining weak strings.
+  std::set<const mirror::Object*> marked;
+  for (int32_t i = 1; i < kStringCount; i += 4) {
+    marked.insert(strings->Get(i));
+  }
+  {
+    ReaderMutexLock mu(soa.Self(), *Locks::heap_bitmap_lock_);
+    t.SweepInternTableWeaks(IsInSet, &marked);
+  }
+  EXPECT_EQ(static_cast<size_t>(kStringCount / 2) + marked.size(), t.Size());
+  for (int32_t i = 0; i < kStringCount; ++i) {
+    bool is_weak = (i % 4) == 1;
+    EXPECT_EQ(is_weak, t.ContainsWeak(strings->Get(i))) << i;
+  }
+}
+
 }  // namespace art
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "line_number_cache.h"
+
+#include <algorithm>
+#include <ostream>
+
+#include "thread.h"
+
+namespace art {
+
+LineNumberCache::LineNumberCache(size_t capacity)
+    : capacity_(capacity),
+      lock_("line number cache lock"),
+      hits_(0),
+      misses_(0) {
+  CHECK_GT(capacity_, 0U);
+}
+
+bool LineNumberCache::AppendPositionCb(void* context, uint32_t address, uint32_t line_num) {
+  reinterpret_cast<LineTable*>(context)->push_back(std::make_pair(address, line_num));
+  return false;  // Keep going; we want the whole table.
+}
+
+int32_t LineNumberCache::LookUp(const LineTable& table, uint32_t dex_pc) {
+  // The decoder stops at the first position whose address is dex_pc, or else reports the last
+  // position before dex_pc.
+  LineTable::const_iterator it =
+      std::lower_bound(table.begin(), table.end(), std::make_pair(dex_pc, 0U));
+  if (it != table.end() && it->first == dex_pc) {
+    return it->second;
+  }
+  if (it == table.begin()) {
+    return -1;
+  }
+  return (it - 1)->second;
+}
+
+int32_t LineNumberCache::GetLineNumber(const DexFile& dex_file,
+                                       const DexFile::CodeItem* code_item,
+                                       bool is_static, uint32_t method_idx, uint32_t dex_pc) {
+  Thread* self = Thread::Current();
+  {
+    MutexLock mu(self, lock_);
+    SafeMap<const DexFile::CodeItem*, Entry>::iterator it = entries_.find(code_item);
+    if (it != entries_.end()) {
+      ++hits_;
+      lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+      return LookUp(it->second.table, dex_pc);
+    }
+    ++misses_;
+  }
+
+  // Decode without holding the lock; another thread may race us to insert the same table, in
+  // which case the copies are identical and we keep the first.
+  LineTable table;
+  dex_file.DecodeDebugInfo(code_item, is_static, method_idx, AppendPositionCb, NULL, &table);
+  int32_t line_number = LookUp(table, dex_pc);
+
+  MutexLock mu(self, lock_);
+  if (entries_.find(code_item) == entries_.end()) {
+    if (entries_.size() >= capacity_) {
+      entries_.erase(lru_.back());
+      lru_.pop_back();
+    }
+    lru_.push_front(code_item);
+    entries_.Put(code_item, Entry());
+    Entry& entry = entries_.find(code_item)->second;
+    entry.table.swap(table);
+    entry.lru_position = lru_.begin();
+  }
+  return line_number;
+}
+
+uint64_t LineNumberCache::GetHitCount() const {
+  MutexLock mu(Thread::Current(), lock_);
+  return hits_;
+}
+
+uint64_t LineNumberCache::GetMissCount() const {
+  MutexLock mu(Thread::Current(), lock_);
+  return misses_;
+}
+
+void LineNumberCache::DumpForSigQuit(std::ostream& os) const {
+  MutexLock mu(Thread::Current(), lock_);
+  os << "Line number cache: " << entries_.size() << "/" << capacity_ << " methods; "
+     << hits_ << " hits; " << misses_ << " misses\n";
+}
+
+}  // namespace art
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_LINE_NUMBER_CACHE_H_
+#define ART_RUNTIME_LINE_NUMBER_CACHE_H_
+
+#include <iosfwd>
+#include <list>
+#include <utility>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "dex_file.h"
+#include "safe_map.h"
+
+namespace art {
+
+// A bounded, least-recently-used cache of decoded dex pc to line number tables, one per code item.
+// Stack trace formatting (Throwable, SIGQUIT dumps, the debugger and lock contention logging) asks
+// for line numbers of the same few methods over and over, and without the cache each request
+// runs the method's whole debug info state machine again.
+class LineNumberCache {
+ public:
+  static const size_t kDefaultCapacity = 1024;  // In methods.
+
+  explicit LineNumberCache(size_t capacity = kDefaultCapacity);
+
+  // Returns the line number for dex_pc in the given code item, or -1 if there is no line number
+  // information for it. Decodes and caches the code item's line table on a miss.
+  int32_t GetLineNumber(const DexFile& dex_file, const DexFile::CodeItem* code_item,
+                        bool is_static, uint32_t method_idx, uint32_t dex_pc)
+      LOCKS_EXCLUDED(lock_);
+
+  uint64_t GetHitCount() const LOCKS_EXCLUDED(lock_);
+  uint64_t GetMissCount() const LOCKS_EXCLUDED(lock_);
+
+  void DumpForSigQuit(std::ostream& os) const LOCKS_EXCLUDED(lock_);
+
+ private:
+  // (dex pc, line number) pairs in the order the debug info emits them, i.e. ascending dex pc.
+  typedef std::vector<std::pair<uint32_t, uint32_t> > LineTable;
+  typedef std::list<const DexFile::CodeItem*> LruList;
+
+  struct Entry {
+    LineTable table;
+    LruList::iterator lru_position;
+  };
+
+  static bool AppendPositionCb(void* context, uint32_t address, uint32_t line_num);
+
+  // Looks up dex_pc the same way DexFile::LineNumForPcCb does while the debug info is decoded.
+  static int32_t LookUp(const LineTable& table, uint32_t dex_pc);
+
+  const size_t capacity_;
+
+  mutable Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  SafeMap<const DexFile::CodeItem*, Entry> entries_ GUARDED_BY(lock_);
+  // Most recently used first.
+  LruList lru_ GUARDED_BY(lock_);
+  uint64_t hits_ GUARDED_BY(lock_);
+  uint64_t misses_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(LineNumberCache);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_LINE_NUMBER_CACHE_H_
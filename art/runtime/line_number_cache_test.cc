@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "line_number_cache.h"
+
+#include "common_test.h"
+#include "dex_file-inl.h"
+
+namespace art {
+
+class LineNumberCacheTest : public CommonTest {};
+
+struct ReferenceLineNumContext {
+  uint32_t address;
+  int32_t line_num;
+};
+
+// Mirrors DexFile::LineNumForPcCb.
+static bool ReferenceLineNumCb(void* raw_context, uint32_t address, uint32_t line_num) {
+  ReferenceLineNumContext* context = reinterpret_cast<ReferenceLineNumContext*>(raw_context);
+  if (address > context->address) {
+    return true;
+  }
+  context->line_num = line_num;
+  return address == context->address;
+}
+
+// Checks every dex pc of every method in dex_file against a full decode of its debug info.
+static size_t CheckAllMethods(const DexFile& dex_file, LineNumberCache* cache) {
+  size_t method_count = 0;
+  for (size_t i = 0; i < dex_file.NumClassDefs(); ++i) {
+    const byte* class_data = dex_file.GetClassData(dex_file.GetClassDef(i));
+    if (class_data == NULL) {
+      continue;
+    }
+    ClassDataItemIterator it(dex_file, class_data);
+    while (it.HasNextStaticField() || it.HasNextInstanceField()) {
+      it.Next();
+    }
+    for (; it.HasNextDirectMethod() || it.HasNextVirtualMethod(); it.Next()) {
+      const DexFile::CodeItem* code_item = it.GetMethodCodeItem();
+      if (code_item == NULL) {
+        continue;
+      }
+      bool is_static = (it.GetMemberAccessFlags() & kAccStatic) != 0;
+      for (uint32_t dex_pc = 0; dex_pc <= code_item->insns_size_in_code_units_; ++dex_pc) {
+        ReferenceLineNumContext context = { dex_pc, -1 };
+        dex_file.DecodeDebugInfo(code_item, is_static, it.GetMemberIndex(), ReferenceLineNumCb,
+                                 NULL, &context);
+        EXPECT_EQ(context.line_num,
+                  cache->GetLineNumber(dex_file, code_item, is_static, it.GetMemberIndex(),
+                                       dex_pc));
+      }
+      ++method_count;
+    }
+  }
+  return method_count;
+}
+
+TEST_F(LineNumberCacheTest, MatchesDecoder) {
+  ScopedObjectAccess soa(Thread::Current());
+  const DexFile* dex_file(OpenTestDexFile("Nested"));
+  ASSERT_TRUE(dex_file != NULL);
+
+  LineNumberCache cache;
+  size_t method_count = CheckAllMethods(*dex_file, &cache);
+  ASSERT_GT(method_count, 0U);
+  // One miss per method, everything else is served from the cache.
+  EXPECT_EQ(method_count, cache.GetMissCount());
+  EXPECT_GT(cache.GetHitCount(), 0U);
+}
+
+TEST_F(LineNumberCacheTest, Eviction) {
+  ScopedObjectAccess soa(Thread::Current());
+  const DexFile* dex_file(OpenTestDexFile("Nested"));
+  ASSERT_TRUE(dex_file != NULL);
+
+  // With room for a single table, each method still misses only once since CheckAllMethods
+  // walks one method at a time; walking everything again misses once per method again.
+  LineNumberCache cache(1);
+  size_t method_count = CheckAllMethods(*dex_file, &cache);
+  ASSERT_GT(method_count, 1U);
+  EXPECT_EQ(method_count, cache.GetMissCount());
+  CheckAllMethods(*dex_file, &cache);
+  EXPECT_EQ(2 * method_count, cache.GetMissCount());
+}
+
+}  // namespace art
@@ -143,6 +143,9 @@ inline void Class::SetVTable(ObjectArray<ArtMethod>* new_vtable)
 inline bool Class::Implements(const Class* klass) const {
   DCHECK(klass != NULL);
   DCHECK(klass->IsInterface()) << PrettyClass(this);
+  if (LIKELY(HasTypeCheckData()) && (interface_bits_ & InterfaceBit(klass)) == 0) {
+    return false;
+  }
   // All interfaces implemented directly and by our superclass, and
   // recursively all super-interfaces of those interfaces, are listed
   // in iftable_, so we can just do a linear scan through that.
@@ -198,6 +201,21 @@ inline bool Class::IsAssignableFromArray(const Class* src) const {
 inline bool Class::IsSubClass(const Class* klass) const {
   DCHECK(!IsInterface()) << PrettyClass(this);
   DCHECK(!IsArrayClass()) << PrettyClass(this);
+  if (LIKELY(HasTypeCheckData() && klass->HasTypeCheckData())) {
+    // klass is a superclass exactly if it is our superclass at its own depth.
+    uint32_t klass_depth = klass->type_check_depth_ - 1;
+    if (klass_depth >= type_check_depth_) {
+      return false;
+    }
+    if (LIKELY(klass_depth < kSuperClassDisplaySize)) {
+      return super_class_display_[klass_depth] == klass;
+    }
+    const Class* current = this;
+    for (uint32_t depth = type_check_depth_ - 1; depth != klass_depth; --depth) {
+      current = current->GetSuperClass();
+    }
+    return current == klass;
+  }
   const Class* current = this;
   do {
     if (current == klass) {
@@ -208,6 +226,10 @@ inline bool Class::IsSubClass(const Class* klass) const {
   return false;
 }
 
+inline uint32_t Class::InterfaceBit(const Class* klass) {
+  return 1U << ((klass->GetDexTypeIndex() * 0x9e3779b1U) >> 27);
+}
+
 inline ArtMethod* Class::FindVirtualMethodForInterface(ArtMethod* method) const {
   Class* declaring_class = method->GetDeclaringClass();
   DCHECK(declaring_class != NULL) << PrettyClass(this);
@@ -38,6 +38,7 @@ namespace art {
 namespace mirror {
 
 Class* Class::java_lang_Class_ = NULL;
+const size_t Class::kSuperClassDisplaySize;
 
 void Class::SetClassClass(Class* java_lang_Class) {
   CHECK(java_lang_Class_ == NULL) << java_lang_Class_ << " " << java_lang_Class;
@@ -268,6 +269,40 @@ void Class::SetReferenceStaticOffsets(uint32_t new_reference_offsets) {
              new_reference_offsets, false);
 }
 
+void Class::SetUpTypeCheckData() {
+  uint32_t interface_bits = 0;
+  int32_t iftable_count = GetIfTableCount();
+  IfTable* iftable = GetIfTable();
+  for (int32_t i = 0; i < iftable_count; ++i) {
+    Class* interface = iftable->GetInterface(i);
+    if (interface == NULL) {
+      // The class linker is still filling in the shared array iftable.
+      return;
+    }
+    interface_bits |= InterfaceBit(interface);
+  }
+  uint32_t depth = 0;
+  Class* super_class = GetSuperClass();
+  if (super_class != NULL) {
+    if (!super_class->HasTypeCheckData()) {
+      // Only happens for the classes the class linker sets up by hand while bootstrapping.
+      super_class->SetUpTypeCheckData();
+      if (!super_class->HasTypeCheckData()) {
+        return;
+      }
+    }
+    depth = super_class->type_check_depth_;
+    for (size_t i = 0; i < super_class->GetSuperClassDisplayLength(); ++i) {
+      super_class_display_[i] = super_class->super_class_display_[i];
+    }
+  }
+  if (depth < kSuperClassDisplaySize) {
+    super_class_display_[depth] = this;
+  }
+  interface_bits_ = interface_bits;
+  type_check_depth_ = depth + 1;
+}
+
 bool Class::IsInSamePackage(const StringPiece& descriptor1, const StringPiece& descriptor2) {
   size_t i = 0;
   while (descriptor1[i] != '\0' && descriptor1[i] == descriptor2[i]) {
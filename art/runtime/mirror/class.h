@@ -17,6 +17,8 @@
 #ifndef ART_RUNTIME_MIRROR_CLASS_H_
 #define ART_RUNTIME_MIRROR_CLASS_H_
 
+#include <algorithm>
+
 #include "modifiers.h"
 #include "object.h"
 #include "primitive.h"
@@ -441,6 +443,31 @@ class MANAGED Class : public StaticStorageBase {
   bool IsSubClass(const Class* klass) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 
+  // Fills in the data that makes IsSubClass and Implements constant time, from the superclass
+  // chain and the iftable. Called once both are final; until then type checks walk the hierarchy.
+  void SetUpTypeCheckData() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  bool HasTypeCheckData() const {
+    return type_check_depth_ != 0;
+  }
+
+  // The superclass at the given depth, java.lang.Object being at depth 0, for the image writer
+  // to relocate. Only the first kSuperClassDisplaySize depths are recorded.
+  Class* GetSuperClassDisplayEntry(size_t depth) const {
+    DCHECK(HasTypeCheckData());
+    DCHECK_LT(depth, std::min<size_t>(type_check_depth_, kSuperClassDisplaySize));
+    return super_class_display_[depth];
+  }
+
+  void SetSuperClassDisplayEntry(size_t depth, Class* klass) {
+    DCHECK_LT(depth, kSuperClassDisplaySize);
+    super_class_display_[depth] = klass;
+  }
+
+  size_t GetSuperClassDisplayLength() const {
+    return std::min<size_t>(type_check_depth_, kSuperClassDisplaySize);
+  }
+
   // Can src be assigned to this class? For example, String can be assigned to Object (by an
   // upcast), however, an Object cannot be assigned to a String as a potentially exception throwing
   // downcast would be necessary. Similarly for interfaces, a class that implements (or an interface
@@ -494,6 +521,9 @@ class MANAGED Class : public StaticStorageBase {
     kDumpClassFullDetail = 1,
     kDumpClassClassLoader = (1 << 1),
     kDumpClassInitialized = (1 << 2),
+    // For VMDebug.printLoadedClasses: log the class loading time histograms instead of the
+    // classes.
+    kDumpClassLoadingTimes = (1 << 3),
   };
 
   void DumpClass(std::ostream& os, int flags) const SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
@@ -759,6 +789,10 @@ class MANAGED Class : public StaticStorageBase {
 
   bool Implements(const Class* klass) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
+
+  // The bit standing for the interface klass in interface_bits_. The dex type index is used as
+  // the key because, unlike the address, it survives the image writer relocating the class.
+  static uint32_t InterfaceBit(const Class* klass) SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   bool IsArrayAssignableFromArray(const Class* klass) const
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
   bool IsAssignableFromArray(const Class* klass) const
@@ -871,6 +905,23 @@ class MANAGED Class : public StaticStorageBase {
   // values are kept in a table in gDvm.
   // InitiatingLoaderList initiating_loader_list_;
 
+  // The fields below up to fields_ are native only, and make subtype checks constant time in
+  // the common case: a Cohen display of the first superclasses and a one word bloom filter of the
+  // implemented interfaces. The classes they refer to are also reachable from super_class_ and
+  // iftable_, so the GC doesn't visit them. Their size is a multiple of 8 bytes so that the 64-bit
+  // static fields of the java.lang classes mirrored below keep their alignment.
+  static const size_t kSuperClassDisplaySize = 8;
+
+  // The depth of this class plus one, or 0 if SetUpTypeCheckData hasn't been called yet.
+  uint32_t type_check_depth_;
+
+  // The union of InterfaceBit of every interface in iftable_.
+  uint32_t interface_bits_;
+
+  // super_class_display_[i] is the superclass at depth i, this class included, for the first
+  // kSuperClassDisplaySize depths.
+  Class* super_class_display_[kSuperClassDisplaySize];
+
   // Location of first static field.
   uint32_t fields_[0];
 
@@ -29,6 +29,7 @@
 
 #include "runtime.h"
 #include "sirt_ref.h"
+#include "utf.h"
 
 #include <string>
 
@@ -581,6 +582,24 @@ class MethodHelper {
     return name == other_name && GetSignature() == other->GetSignature();
   }
 
+  // Returns a hash of the name and signature. Unlike the indices HasSameNameAndSignature compares
+  // within a dex file, it is equal for equal methods from different dex files.
+  uint32_t ComputeNameAndSignatureHash() SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
+    const DexFile& dex_file = GetDexFile();
+    const DexFile::MethodId& mid = dex_file.GetMethodId(method_->GetDexMethodIndex());
+    const DexFile::ProtoId& proto = dex_file.GetMethodPrototype(mid);
+    uint32_t hash = ComputeModifiedUtf8Hash(dex_file.GetMethodName(mid));
+    hash = hash * 31 + ComputeModifiedUtf8Hash(dex_file.StringByTypeIdx(proto.return_type_idx_));
+    const DexFile::TypeList* params = dex_file.GetProtoParameters(proto);
+    if (params != NULL) {
+      for (uint32_t i = 0; i < params->Size(); ++i) {
+        const char* descriptor = dex_file.StringByTypeIdx(params->GetTypeItem(i).type_idx_);
+        hash = hash * 31 + ComputeModifiedUtf8Hash(descriptor);
+      }
+    }
+    return hash;
+  }
+
   const DexFile::CodeItem* GetCodeItem()
       SHARED_LOCKS_REQUIRED(Locks::mutator_lock_) {
     return GetDexFile().GetCodeItem(method_->GetCodeItemOffset());
@@ -40,6 +40,7 @@
 #include "image.h"
 #include "instrumentation.h"
 #include "intern_table.h"
+#include "line_number_cache.h"
 #include "invoke_arg_array_builder.h"
 #include "jni_internal.h"
 #include "mirror/art_field-inl.h"
@@ -78,6 +79,7 @@ Runtime::Runtime()
       monitor_list_(NULL),
       thread_list_(NULL),
       intern_table_(NULL),
+      line_number_cache_(NULL),
       class_linker_(NULL),
       signal_catcher_(NULL),
       java_vm_(NULL),
@@ -131,6 +133,7 @@ Runtime::~Runtime() {
   delete class_linker_;
   delete heap_;
   delete intern_table_;
+  delete line_number_cache_;
   delete java_vm_;
   Thread::Shutdown();
   QuasiAtomic::Shutdown();
@@ -868,6 +871,7 @@ bool Runtime::Init(const Options& raw_options, bool ignore_unrecognized) {
   monitor_list_ = new MonitorList;
   thread_list_ = new ThreadList;
   intern_table_ = new InternTable;
+  line_number_cache_ = new LineNumberCache;
 
 
   if (options->interpreter_only_) {
@@ -1034,6 +1038,7 @@ void Runtime::RegisterRuntimeNativeMethods(JNIEnv* env) {
 void Runtime::DumpForSigQuit(std::ostream& os) {
   GetClassLinker()->DumpForSigQuit(os);
   GetInternTable()->DumpForSigQuit(os);
+  GetLineNumberCache()->DumpForSigQuit(os);
   GetJavaVM()->DumpForSigQuit(os);
   GetHeap()->DumpForSigQuit(os);
   os << "\n";
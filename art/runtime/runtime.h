@@ -53,6 +53,7 @@ namespace mirror {
 class ClassLinker;
 class DexFile;
 class InternTable;
+class LineNumberCache;
 struct JavaVMExt;
 class MonitorList;
 class SignalCatcher;
@@ -282,6 +283,10 @@ class Runtime {
     return intern_table_;
   }
 
+  LineNumberCache* GetLineNumberCache() const {
+    return line_number_cache_;
+  }
+
   JavaVMExt* GetJavaVM() const {
     return java_vm_;
   }
@@ -457,6 +462,8 @@ class Runtime {
 
   InternTable* intern_table_;
 
+  LineNumberCache* line_number_cache_;
+
   ClassLinker* class_linker_;
 
   SignalCatcher* signal_catcher_;
@@ -16,14 +16,64 @@
 
 #include "utf.h"
 
+#include <string.h>
+
 #include "base/logging.h"
+#include "globals.h"
 #include "mirror/array.h"
 #include "mirror/object-inl.h"
 
 namespace art {
 
+static const uintptr_t kWordOnes = static_cast<uintptr_t>(0x0101010101010101ULL);
+static const uintptr_t kWordHighBits = static_cast<uintptr_t>(0x8080808080808080ULL);
+
+// True if a word-sized load at p cannot cross into the next page.
+static inline bool CanLoadWord(const char* p) {
+  return (reinterpret_cast<uintptr_t>(p) & (kPageSize - 1)) <= kPageSize - sizeof(uintptr_t);
+}
+
+static inline uintptr_t LoadWord(const char* p) {
+  uintptr_t word;
+  memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+// True if any byte of the word is either '\0' or has its high bit set, i.e. the word is not a run
+// of plain one-byte characters.
+static inline bool HasZeroOrNonAsciiByte(uintptr_t word) {
+  return (((word - kWordOnes) | word) & kWordHighBits) != 0;
+}
+
+size_t CountAsciiPrefix(const char* utf8) {
+  const char* p = utf8;
+  while (CanLoadWord(p) && !HasZeroOrNonAsciiByte(LoadWord(p))) {
+    p += sizeof(uintptr_t);
+  }
+  while (*p != '\0' && (static_cast<uint8_t>(*p) & 0x80) == 0) {
+    ++p;
+  }
+  return p - utf8;
+}
+
+// Returns the length of the common prefix of utf8_1 and utf8_2 that consists only of one-byte
+// (ASCII, non-NUL) characters. Both strings may be skipped by that amount without changing the
+// result of a code point comparison, since the byte after the prefix starts a character in both.
+static inline size_t CommonAsciiPrefix(const char* utf8_1, const char* utf8_2) {
+  size_t i = 0;
+  while (CanLoadWord(utf8_1 + i) && CanLoadWord(utf8_2 + i)) {
+    uintptr_t word = LoadWord(utf8_1 + i);
+    if (word != LoadWord(utf8_2 + i) || HasZeroOrNonAsciiByte(word)) {
+      break;
+    }
+    i += sizeof(uintptr_t);
+  }
+  return i;
+}
+
 size_t CountModifiedUtf8Chars(const char* utf8) {
-  size_t len = 0;
+  size_t len = CountAsciiPrefix(utf8);
+  utf8 += len;
   int ic;
   while ((ic = *utf8++) != '\0') {
     len++;
@@ -84,6 +134,14 @@ int32_t ComputeUtf16Hash(const uint16_t* chars, size_t char_count) {
   return hash;
 }
 
+int32_t ComputeModifiedUtf8Hash(const char* utf8) {
+  int32_t hash = 0;
+  while (*utf8 != '\0') {
+    hash = hash * 31 + GetUtf16FromUtf8(&utf8);
+  }
+  return hash;
+}
+
 
 uint16_t GetUtf16FromUtf8(const char** utf8_data_in) {
   uint8_t one = *(*utf8_data_in)++;
@@ -103,7 +161,24 @@ uint16_t GetUtf16FromUtf8(const char** utf8_data_in) {
 }
 
 int CompareModifiedUtf8ToModifiedUtf8AsUtf16CodePointValues(const char* utf8_1, const char* utf8_2) {
+  size_t prefix = CommonAsciiPrefix(utf8_1, utf8_2);
+  utf8_1 += prefix;
+  utf8_2 += prefix;
   for (;;) {
+    uint8_t b1 = *utf8_1;
+    uint8_t b2 = *utf8_2;
+    if ((b1 | b2) < 0x80) {
+      // Both one-byte characters (or '\0'): compare the bytes directly.
+      if (b1 != b2) {
+        return b1 > b2 ? 1 : -1;
+      } else if (b1 == '\0') {
+        return 0;
+      }
+      utf8_1++;
+      utf8_2++;
+      continue;
+    }
+
     if (*utf8_1 == '\0') {
       return (*utf8_2 == '\0') ? 0 : -1;
     } else if (*utf8_2 == '\0') {
@@ -121,6 +196,18 @@ int CompareModifiedUtf8ToModifiedUtf8AsUtf16CodePointValues(const char* utf8_1,
 
 int CompareModifiedUtf8ToUtf16AsCodePointValues(const char* utf8_1, const uint16_t* utf8_2) {
   for (;;) {
+    uint8_t b1 = *utf8_1;
+    if (b1 < 0x80 && b1 != '\0') {
+      // One-byte character: no decoding needed.
+      int c2 = *utf8_2;
+      if (b1 != c2) {
+        return b1 > c2 ? 1 : -1;
+      }
+      utf8_1++;
+      utf8_2++;
+      continue;
+    }
+
     if (*utf8_1 == '\0') {
       return (*utf8_2 == '\0') ? 0 : -1;
     } else if (*utf8_2 == '\0') {
@@ -128,7 +215,7 @@ int CompareModifiedUtf8ToUtf16AsCodePointValues(const char* utf8_1, const uint16
     }
 
     int c1 = GetUtf16FromUtf8(&utf8_1);
-    int c2 = *utf8_2;
+    int c2 = *utf8_2++;
 
     if (c1 != c2) {
       return c1 > c2 ? 1 : -1;
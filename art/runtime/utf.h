@@ -39,6 +39,12 @@ typedef PrimitiveArray<uint16_t> CharArray;
  */
 size_t CountModifiedUtf8Chars(const char* utf8);
 
+/*
+ * Returns the number of leading one-byte (non-NUL ASCII) characters in the given modified UTF-8
+ * string. Runs are scanned a machine word at a time.
+ */
+size_t CountAsciiPrefix(const char* utf8);
+
 /*
  * Returns the number of modified UTF-8 bytes needed to represent the given
  * UTF-16 string.
@@ -76,6 +82,12 @@ int32_t ComputeUtf16Hash(const mirror::CharArray* chars, int32_t offset, size_t
     SHARED_LOCKS_REQUIRED(Locks::mutator_lock_);
 int32_t ComputeUtf16Hash(const uint16_t* chars, size_t char_count);
 
+/*
+ * The java.lang.String hashCode() algorithm applied to the UTF-16 form of a
+ * NUL-terminated modified UTF-8 string, without converting it first.
+ */
+int32_t ComputeModifiedUtf8Hash(const char* utf8);
+
 /*
  * Retrieve the next UTF-16 character from a UTF-8 string.
  *
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "utf.h"
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "common_test.h"
+
+namespace art {
+
+class UtfTest : public CommonTest {
+};
+
+static int Sign(int value) {
+  return (value > 0) - (value < 0);
+}
+
+TEST_F(UtfTest, CountAsciiPrefix) {
+  EXPECT_EQ(0U, CountAsciiPrefix(""));
+  EXPECT_EQ(3U, CountAsciiPrefix("abc"));
+  EXPECT_EQ(25U, CountAsciiPrefix("Ljava/lang/StringBuilder;\xc3\xa9"));
+  EXPECT_EQ(1U, CountAsciiPrefix("a\xc0\x80z"));
+}
+
+TEST_F(UtfTest, CountModifiedUtf8Chars) {
+  EXPECT_EQ(0U, CountModifiedUtf8Chars(""));
+  EXPECT_EQ(25U, CountModifiedUtf8Chars("Ljava/lang/StringBuilder;"));
+  // One-, two- and three-byte encodings, including an encoded '\0'.
+  EXPECT_EQ(5U, CountModifiedUtf8Chars("a\xc3\xa9\xc0\x80\xe2\x80\x80z"));
+}
+
+TEST_F(UtfTest, CompareModifiedUtf8) {
+  EXPECT_EQ(0, CompareModifiedUtf8ToModifiedUtf8AsUtf16CodePointValues("", ""));
+  EXPECT_EQ(-1, CompareModifiedUtf8ToModifiedUtf8AsUtf16CodePointValues("", "a"));
+  EXPECT_EQ(1, CompareModifiedUtf8ToModifiedUtf8AsUtf16CodePointValues("a", ""));
+  EXPECT_EQ(0, CompareModifiedUtf8ToModifiedUtf8AsUtf16CodePointValues(
+      "Ljava/lang/StringBuilder;", "Ljava/lang/StringBuilder;"));
+  EXPECT_EQ(-1, CompareModifiedUtf8ToModifiedUtf8AsUtf16CodePointValues(
+      "Ljava/lang/StringBuilder;", "Ljava/lang/StringBuilderX;"));
+  EXPECT_EQ(1, CompareModifiedUtf8ToModifiedUtf8AsUtf16CodePointValues(
+      "Ljava/lang/StringBuilder;", "Ljava/lang/String;"));
+  // Differences beyond the first word, and after a long shared prefix.
+  EXPECT_EQ(-1, CompareModifiedUtf8ToModifiedUtf8AsUtf16CodePointValues(
+      "Landroid/support/v4/app/FragmentA;", "Landroid/support/v4/app/FragmentB;"));
+  // Non-ASCII characters order by code point, after all of ASCII.
+  EXPECT_EQ(1, CompareModifiedUtf8ToModifiedUtf8AsUtf16CodePointValues(
+      "Lcom/example/\xc3\xa9", "Lcom/example/z"));
+  EXPECT_EQ(-1, CompareModifiedUtf8ToModifiedUtf8AsUtf16CodePointValues(
+      "Lcom/example/\xc3\xa9", "Lcom/example/\xe2\x80\x80"));
+  // An encoded '\0' sorts before every other character but is not a terminator.
+  EXPECT_EQ(-1, CompareModifiedUtf8ToModifiedUtf8AsUtf16CodePointValues(
+      "Lcom/example/\xc0\x80", "Lcom/example/a"));
+  EXPECT_EQ(1, CompareModifiedUtf8ToModifiedUtf8AsUtf16CodePointValues(
+      "Lcom/example/\xc0\x80", "Lcom/example/"));
+}
+
+TEST_F(UtfTest, CompareModifiedUtf8ToUtf16) {
+  const char* utf8 = "Lcom/example/\xc3\xa9z;";
+  size_t length = CountModifiedUtf8Chars(utf8);
+  std::vector<uint16_t> utf16(length + 1, 0);
+  ConvertModifiedUtf8ToUtf16(&utf16[0], utf8);
+  EXPECT_EQ(0, CompareModifiedUtf8ToUtf16AsCodePointValues(utf8, &utf16[0]));
+  EXPECT_EQ(-1, CompareModifiedUtf8ToUtf16AsCodePointValues("Lcom/example/", &utf16[0]));
+  EXPECT_EQ(1, CompareModifiedUtf8ToUtf16AsCodePointValues("Lcom/example/\xc3\xa9z;x", &utf16[0]));
+  EXPECT_EQ(-1, CompareModifiedUtf8ToUtf16AsCodePointValues("Lcom/example/\xc3\xa9y;", &utf16[0]));
+  EXPECT_EQ(1, CompareModifiedUtf8ToUtf16AsCodePointValues("Lcom/example/\xe2\x80\x80", &utf16[0]));
+}
+
+// Check every alignment of both strings, so the word-at-a-time prefix scan sees a mismatch, a
+// terminator and a multibyte character at every position within a word. kTails is in code point
+// order.
+TEST_F(UtfTest, CompareModifiedUtf8Alignments) {
+  static const char* kTails[] = { "", "\xc0\x80", "a", "b", "\xc3\xa9", "\xe2\x80\x80" };
+  const size_t kNumTails = sizeof(kTails) / sizeof(kTails[0]);
+  char buffer1[64];
+  char buffer2[64];
+  for (size_t offset1 = 0; offset1 < 8; ++offset1) {
+    for (size_t offset2 = 0; offset2 < 8; ++offset2) {
+      for (size_t prefix = 0; prefix < 20; ++prefix) {
+        for (size_t t1 = 0; t1 < kNumTails; ++t1) {
+          for (size_t t2 = 0; t2 < kNumTails; ++t2) {
+            std::string s1 = std::string(prefix, 'x') + kTails[t1];
+            std::string s2 = std::string(prefix, 'x') + kTails[t2];
+            strcpy(buffer1 + offset1, s1.c_str());
+            strcpy(buffer2 + offset2, s2.c_str());
+            int expected = Sign(static_cast<int>(t1) - static_cast<int>(t2));
+            EXPECT_EQ(expected, CompareModifiedUtf8ToModifiedUtf8AsUtf16CodePointValues(
+                buffer1 + offset1, buffer2 + offset2)) << s1 << " vs " << s2;
+          }
+        }
+      }
+    }
+  }
+}
+
+}  // namespace art
@@ -17,6 +17,7 @@
 #include "utils.h"
 
 #include <pthread.h>
+#include <stdlib.h>
 #include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
@@ -662,6 +663,22 @@ uint32_t DEX_MEMBER_VALID_LOW_ASCII[4] = {
   0x07fffffe   // 60..7f lowercase etc.; valid: 'a'..'z'
 };
 
+// Returns whether the low-ascii character c is valid as part of a member name.
+static inline bool IsValidPartOfMemberNameAscii(uint8_t c) {
+  return (DEX_MEMBER_VALID_LOW_ASCII[c >> 5] & (1 << (c & 0x1f))) != 0;
+}
+
+// Advances s past the longest run of low-ascii characters that are valid as part of a member
+// name. Names are nearly always entirely ascii, so this handles the bulk of the string without
+// the per-character call and multibyte checks of IsValidPartOfMemberNameUtf8().
+static inline const char* SkipValidMemberNameAscii(const char* s) {
+  uint8_t c;
+  while ((c = static_cast<uint8_t>(*s)) <= 0x7f && IsValidPartOfMemberNameAscii(c)) {
+    s++;
+  }
+  return s;
+}
+
 // Helper for IsValidPartOfMemberNameUtf8(); do not call directly.
 bool IsValidPartOfMemberNameUtf8Slow(const char** pUtf8Ptr) {
   /*
@@ -722,10 +739,8 @@ bool IsValidPartOfMemberNameUtf8(const char** pUtf8Ptr) {
   uint8_t c = (uint8_t) **pUtf8Ptr;
   if (c <= 0x7f) {
     // It's low-ascii, so check the table.
-    uint32_t wordIdx = c >> 5;
-    uint32_t bitIdx = c & 0x1f;
     (*pUtf8Ptr)++;
-    return (DEX_MEMBER_VALID_LOW_ASCII[wordIdx] & (1 << bitIdx)) != 0;
+    return IsValidPartOfMemberNameAscii(c);
   }
 
   // It's a multibyte encoded character. Call a non-inline function
@@ -747,6 +762,7 @@ bool IsValidMemberName(const char* s) {
   }
 
   while (true) {
+    s = SkipValidMemberNameAscii(s);
     switch (*s) {
       case '\0':
         return !angle_name;
@@ -820,6 +836,11 @@ bool IsValidClassName(const char* s, ClassNameType type, char separator) {
 
   bool sepOrFirst = true;  // first character or just encountered a separator.
   for (;;) {
+    const char* run_end = SkipValidMemberNameAscii(s);
+    if (run_end != s) {
+      sepOrFirst = false;
+      s = run_end;
+    }
     uint8_t c = (uint8_t) *s;
     switch (c) {
     case '\0':
@@ -923,6 +944,16 @@ bool EndsWith(const std::string& s, const char* suffix) {
   return s.compare(offset, suffix_length, suffix) == 0;
 }
 
+bool ParseInt(const char* in, int* out) {
+  char* end;
+  int result = strtol(in, &end, 10);
+  if (in == end || *end != '\0') {
+    return false;
+  }
+  *out = result;
+  return true;
+}
+
 void SetThreadName(const char* thread_name) {
   int hasAt = 0;
   int hasDot = 0;
@@ -1199,6 +1230,11 @@ std::string GetDalvikCacheFilenameOrDie(const std::string& location) {
   if (location[0] != '/') {
     LOG(FATAL) << "Expected path in location to be absolute: "<< location;
   }
+  return GetDalvikCacheFilename(location, dalvik_cache);
+}
+
+std::string GetDalvikCacheFilename(const std::string& location, const std::string& dalvik_cache) {
+  DCHECK_EQ(location[0], '/') << location;
   std::string cache_file(location, 1);  // skip leading slash
   if (!EndsWith(location, ".dex") && !EndsWith(location, ".art")) {
     cache_file += "/";
@@ -182,6 +182,10 @@ bool StartsWith(const std::string& s, const char* prefix);
 // Tests whether 's' starts with 'suffix'.
 bool EndsWith(const std::string& s, const char* suffix);
 
+// Parses 'in' as a decimal int into '*out'. Returns false, leaving '*out' alone, unless all of
+// 'in' is a number.
+bool ParseInt(const char* in, int* out);
+
 // Used to implement PrettyClass, PrettyField, PrettyMethod, and PrettyTypeOf,
 // one of which is probably more useful to you.
 // Returns a human-readable equivalent of 'descriptor'. So "I" would be "int",
@@ -355,6 +359,9 @@ std::string GetDalvikCacheOrDie(const char* android_data);
 // Returns the dalvik-cache location for a DexFile or OatFile, or dies trying.
 std::string GetDalvikCacheFilenameOrDie(const std::string& location);
 
+// Returns the name a DexFile or OatFile with the given absolute location has in dalvik_cache.
+std::string GetDalvikCacheFilename(const std::string& location, const std::string& dalvik_cache);
+
 // Check whether the given magic matches a known file type.
 bool IsZipMagic(uint32_t magic);
 bool IsDexMagic(uint32_t magic);
@@ -335,6 +335,18 @@ TEST_F(UtilsTest, EndsWith) {
   EXPECT_FALSE(EndsWith("oo", "foo"));
 }
 
+TEST_F(UtilsTest, ParseInt) {
+  int i = 42;
+  EXPECT_FALSE(ParseInt("", &i));
+  EXPECT_FALSE(ParseInt("4x", &i));
+  EXPECT_FALSE(ParseInt("x4", &i));
+  EXPECT_EQ(42, i);
+  EXPECT_TRUE(ParseInt("-7", &i));
+  EXPECT_EQ(-7, i);
+  EXPECT_TRUE(ParseInt("16", &i));
+  EXPECT_EQ(16, i);
+}
+
 void CheckGetDalvikCacheFilenameOrDie(const char* in, const char* out) {
   std::string expected(getenv("ANDROID_DATA"));
   expected += "/dalvik-cache/";
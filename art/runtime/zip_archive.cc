@@ -16,15 +16,22 @@
 
 #include "zip_archive.h"
 
+#include <algorithm>
 #include <vector>
 
 #include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "base/crc32.h"
 #include "base/unix_file/fd_file.h"
+#include "thread.h"
+#include "thread_pool.h"
 #include "UniquePtr.h"
+#include "utils.h"
 
 namespace art {
 
@@ -44,6 +51,29 @@ static uint32_t Le32ToHost(const byte* src) {
           (src[3] << 24));
 }
 
+// Reads exactly count bytes at offset without moving the file offset, so that concurrent
+// extractions from the same archive don't interfere with each other.
+static bool PreadFully(int fd, void* buf, size_t count, off64_t offset) {
+  uint8_t* dst = reinterpret_cast<uint8_t*>(buf);
+  while (count != 0) {
+    ssize_t actual = TEMP_FAILURE_RETRY(pread64(fd, dst, count, offset));
+    if (actual <= 0) {
+      return false;
+    }
+    dst += actual;
+    offset += actual;
+    count -= actual;
+  }
+  return true;
+}
+
+uint64_t ZipExtractionStats::GetBytesPerSecond() const {
+  if (duration_ns == 0) {
+    return 0;
+  }
+  return static_cast<uint64_t>(uncompressed_length) * 1000000000ULL / duration_ns;
+}
+
 uint16_t ZipEntry::GetCompressionMethod() {
   return Le16ToHost(ptr_ + ZipArchive::kCDEMethod);
 }
@@ -76,15 +106,9 @@ off64_t ZipEntry::GetDataOffset() {
     return -1;
   }
 
-  if (lseek64(zip_archive_->fd_, lfh_offset, SEEK_SET) != lfh_offset) {
-    PLOG(WARNING) << "Zip: failed seeking to LFH at offset " << lfh_offset;
-    return -1;
-  }
-
   uint8_t lfh_buf[ZipArchive::kLFHLen];
-  ssize_t actual = TEMP_FAILURE_RETRY(read(zip_archive_->fd_, lfh_buf, sizeof(lfh_buf)));
-  if (actual != sizeof(lfh_buf)) {
-    LOG(WARNING) << "Zip: failed reading LFH from offset " << lfh_offset;
+  if (!PreadFully(zip_archive_->fd_, lfh_buf, sizeof(lfh_buf), lfh_offset)) {
+    PLOG(WARNING) << "Zip: failed reading LFH from offset " << lfh_offset;
     return -1;
   }
 
@@ -127,21 +151,72 @@ off64_t ZipEntry::GetDataOffset() {
   return data_offset;
 }
 
-static bool CopyFdToMemory(uint8_t* begin, size_t size, int in, size_t count) {
-  uint8_t* dst = begin;
-  std::vector<uint8_t> buf(kBufSize);
-  while (count != 0) {
-    size_t bytes_to_read = (count > kBufSize) ? kBufSize : count;
-    ssize_t actual = TEMP_FAILURE_RETRY(read(in, &buf[0], bytes_to_read));
-    if (actual != static_cast<ssize_t>(bytes_to_read)) {
+// A read-only mapping of just the compressed bytes of one entry. Mapping is only an optimization:
+// if it fails Begin() returns NULL and the caller falls back to positional reads, so failure is
+// not worth more than a verbose log.
+class ZipEntryDataMap {
+ public:
+  ZipEntryDataMap(int fd, off64_t offset, size_t length)
+      : base_(MAP_FAILED), base_size_(0), begin_(NULL) {
+    if (length == 0) {
+      return;
+    }
+    size_t page_offset = offset % kPageSize;
+    base_size_ = RoundUp(length + page_offset, kPageSize);
+    base_ = mmap(NULL, base_size_, PROT_READ, MAP_SHARED, fd, offset - page_offset);
+    if (base_ == MAP_FAILED) {
+      VLOG(startup) << "Zip: failed to map " << length << " bytes at " << offset
+                    << ", falling back to reads: " << strerror(errno);
+      return;
+    }
+    begin_ = reinterpret_cast<const uint8_t*>(base_) + page_offset;
+  }
+
+  ~ZipEntryDataMap() {
+    if (base_ != MAP_FAILED && munmap(base_, base_size_) == -1) {
+      PLOG(WARNING) << "Zip: munmap failed";
+    }
+  }
+
+  const uint8_t* Begin() const {
+    return begin_;
+  }
+
+ private:
+  void* base_;
+  size_t base_size_;
+  const uint8_t* begin_;
+
+  DISALLOW_COPY_AND_ASSIGN(ZipEntryDataMap);
+};
+
+// Where an entry's data lives: in a ZipEntryDataMap if it could be mapped, otherwise at offset
+// in fd.
+struct ZipInput {
+  int fd;
+  off64_t offset;
+  const uint8_t* mapped;
+};
+
+// Copies stored data kBufSize bytes at a time, folding each piece into *crc while it is still in
+// the cache.
+static bool CopyToMemory(uint8_t* begin, size_t size, const ZipInput& in, size_t count,
+                         uint32_t* crc) {
+  if (count != size) {
+    LOG(WARNING) << "Zip: size mismatch on stored file (" << count << " vs " << size << ")";
+    return false;
+  }
+  for (size_t done = 0; done != count; ) {
+    size_t chunk = std::min(count - done, kBufSize);
+    if (in.mapped != NULL) {
+      memcpy(begin + done, in.mapped + done, chunk);
+    } else if (!PreadFully(in.fd, begin + done, chunk, in.offset + done)) {
       PLOG(WARNING) << "Zip: short read";
       return false;
     }
-    memcpy(dst, &buf[0], bytes_to_read);
-    dst += bytes_to_read;
-    count -= bytes_to_read;
+    *crc = ComputeCrc32(*crc, begin + done, chunk);
+    done += chunk;
   }
-  DCHECK_EQ(dst, begin + size);
   return true;
 }
 
@@ -171,17 +246,22 @@ class ZStream {
   z_stream zstream_;
 };
 
-static bool InflateToMemory(uint8_t* begin, size_t size,
-                            int in, size_t uncompressed_length, size_t compressed_length) {
-  uint8_t* dst = begin;
-  UniquePtr<uint8_t[]> read_buf(new uint8_t[kBufSize]);
-  UniquePtr<uint8_t[]> write_buf(new uint8_t[kBufSize]);
-  if (read_buf.get() == NULL || write_buf.get() == NULL) {
-    LOG(WARNING) << "Zip: failed to allocate buffer to inflate";
-    return false;
+// Inflates straight into the destination. Compressed input is handed to zlib in one piece when
+// the entry is mapped, and otherwise read in kBufSize chunks. Output is produced kBufSize bytes
+// at a time so that each piece can be folded into *crc while it is still in the cache.
+static bool InflateToMemory(uint8_t* begin, size_t size, const ZipInput& in,
+                            size_t uncompressed_length, size_t compressed_length,
+                            uint32_t* crc) {
+  UniquePtr<uint8_t[]> read_buf;
+  if (in.mapped == NULL) {
+    read_buf.reset(new uint8_t[kBufSize]);
+    if (read_buf.get() == NULL) {
+      LOG(WARNING) << "Zip: failed to allocate buffer to inflate";
+      return false;
+    }
   }
 
-  UniquePtr<ZStream> zstream(new ZStream(write_buf.get(), kBufSize));
+  UniquePtr<ZStream> zstream(new ZStream(begin, std::min(size, kBufSize)));
 
   // Use the undocumented "negative window bits" feature to tell zlib
   // that there's no zlib header waiting for it.
@@ -195,24 +275,38 @@ static bool InflateToMemory(uint8_t* begin, size_t size,
     return false;
   }
 
+  if (in.mapped != NULL) {
+    zstream->Get().next_in = const_cast<Bytef*>(in.mapped);
+    zstream->Get().avail_in = compressed_length;
+  }
+
   size_t remaining = compressed_length;
+  off64_t offset = in.offset;
   do {
     // read as much as we can
-    if (zstream->Get().avail_in == 0) {
+    if (zstream->Get().avail_in == 0 && in.mapped == NULL) {
       size_t bytes_to_read = (remaining > kBufSize) ? kBufSize : remaining;
+      if (!PreadFully(in.fd, read_buf.get(), bytes_to_read, offset)) {
+        PLOG(WARNING) << "Zip: inflate read of " << bytes_to_read << " bytes at " << offset
+                      << " failed";
+        return false;
+      }
+      remaining -= bytes_to_read;
+      offset += bytes_to_read;
+      zstream->Get().next_in = read_buf.get();
+      zstream->Get().avail_in = bytes_to_read;
+    }
 
-        ssize_t actual = TEMP_FAILURE_RETRY(read(in, read_buf.get(), bytes_to_read));
-        if (actual != static_cast<ssize_t>(bytes_to_read)) {
-          LOG(WARNING) << "Zip: inflate read failed (" << actual << " vs " << bytes_to_read << ")";
-          return false;
-        }
-        remaining -= bytes_to_read;
-        zstream->Get().next_in = read_buf.get();
-        zstream->Get().avail_in = bytes_to_read;
+    // open up the next piece of the destination once zlib has filled this one
+    if (zstream->Get().avail_out == 0) {
+      size_t produced = zstream->Get().next_out - begin;
+      zstream->Get().avail_out = std::min(size - produced, kBufSize);
     }
 
     // uncompress the data
+    uint8_t* out_start = zstream->Get().next_out;
     zerr = inflate(&zstream->Get(), Z_NO_FLUSH);
+    *crc = ComputeCrc32(*crc, out_start, zstream->Get().next_out - out_start);
     if (zerr != Z_OK && zerr != Z_STREAM_END) {
       LOG(WARNING) << "Zip: inflate zerr=" << zerr
                    << " (next_in=" << zstream->Get().next_in
@@ -222,16 +316,6 @@ static bool InflateToMemory(uint8_t* begin, size_t size,
                    << ")";
       return false;
     }
-
-    // write when we're full or when we're done
-    if (zstream->Get().avail_out == 0 ||
-        (zerr == Z_STREAM_END && zstream->Get().avail_out != kBufSize)) {
-      size_t bytes_to_write = zstream->Get().next_out - write_buf.get();
-      memcpy(dst, write_buf.get(), bytes_to_write);
-      dst += bytes_to_write;
-      zstream->Get().next_out = write_buf.get();
-      zstream->Get().avail_out = kBufSize;
-    }
   } while (zerr == Z_OK);
 
   DCHECK_EQ(zerr, Z_STREAM_END);  // other errors should've been caught
@@ -243,7 +327,7 @@ static bool InflateToMemory(uint8_t* begin, size_t size,
     return false;
   }
 
-  DCHECK_EQ(dst, begin + size);
+  DCHECK_EQ(zstream->Get().next_out, begin + size);
   return true;
 }
 
@@ -274,23 +358,33 @@ bool ZipEntry::ExtractToMemory(uint8_t* begin, size_t size) {
     LOG(WARNING) << "Zip: data_offset=" << data_offset;
     return false;
   }
-  if (lseek64(zip_archive_->fd_, data_offset, SEEK_SET) != data_offset) {
-    PLOG(WARNING) << "Zip: lseek to data at " << data_offset << " failed";
-    return false;
-  }
+  ZipEntryDataMap data_map(zip_archive_->fd_, data_offset, GetCompressedLength());
+  ZipInput in;
+  in.fd = zip_archive_->fd_;
+  in.offset = data_offset;
+  in.mapped = data_map.Begin();
 
-  // TODO: this doesn't verify the data's CRC, but probably should (especially
-  // for uncompressed data).
+  // The CRC is computed as the data is produced rather than in a second pass over it.
+  uint32_t crc = 0;
+  bool success;
   switch (GetCompressionMethod()) {
     case kCompressStored:
-      return CopyFdToMemory(begin, size, zip_archive_->fd_, GetUncompressedLength());
+      success = CopyToMemory(begin, size, in, GetUncompressedLength(), &crc);
+      break;
     case kCompressDeflated:
-      return InflateToMemory(begin, size, zip_archive_->fd_,
-                             GetUncompressedLength(), GetCompressedLength());
+      success = InflateToMemory(begin, size, in, GetUncompressedLength(), GetCompressedLength(),
+                                &crc);
+      break;
     default:
       LOG(WARNING) << "Zip: unknown compression method " << std::hex << GetCompressionMethod();
       return false;
   }
+  if (success && crc != GetCrc32()) {
+    LOG(WARNING) << "Zip: CRC mismatch: expected " << std::hex << GetCrc32() << ", computed "
+                 << crc;
+    return false;
+  }
+  return success;
 }
 
 MemMap* ZipEntry::ExtractToMemMap(const char* entry_filename) {
@@ -315,6 +409,29 @@ MemMap* ZipEntry::ExtractToMemMap(const char* entry_filename) {
   return map.release();
 }
 
+MemMap* ZipEntry::MapDirectlyFromFile(const char* entry_filename, size_t alignment) {
+  DCHECK(IsPowerOfTwo(alignment));
+  if (GetCompressionMethod() != kCompressStored) {
+    VLOG(startup) << "Zip: can't map compressed '" << entry_filename << "' directly";
+    return NULL;
+  }
+  uint32_t length = GetUncompressedLength();
+  if (length == 0) {
+    return NULL;
+  }
+  off64_t data_offset = GetDataOffset();
+  if (data_offset == -1) {
+    return NULL;
+  }
+  if ((data_offset & (alignment - 1)) != 0) {
+    VLOG(startup) << "Zip: can't map '" << entry_filename << "' directly, its data at "
+                  << data_offset << " isn't " << alignment << "-byte aligned";
+    return NULL;
+  }
+  return MemMap::MapFile(length, PROT_READ | PROT_WRITE, MAP_PRIVATE, zip_archive_->fd_,
+                         data_offset);
+}
+
 static void SetCloseOnExec(int fd) {
   // This dance is more portable than Linux's O_CLOEXEC open(2) flag.
   int flags = fcntl(fd, F_GETFD);
@@ -374,6 +491,112 @@ void ZipArchive::Close() {
   dir_offset_ = 0;
 }
 
+namespace {
+
+// Extracts one entry of ZipArchive::ExtractToMemMaps.
+class ZipExtractTask : public Task {
+ public:
+  ZipExtractTask(const ZipArchive* zip_archive, const std::string& name)
+      : zip_archive_(zip_archive), name_(name), success_(false) {
+    memset(&stats_, 0, sizeof(stats_));
+  }
+
+  virtual void Run(Thread* /*self*/) {
+    uint64_t start_ns = NanoTime();
+    UniquePtr<ZipEntry> zip_entry(zip_archive_->Find(name_.c_str()));
+    if (zip_entry.get() == NULL) {
+      LOG(WARNING) << "Zip: no entry '" << name_ << "' to extract";
+      return;
+    }
+    map_.reset(zip_entry->ExtractToMemMap(name_.c_str()));
+    if (map_.get() == NULL) {
+      return;
+    }
+    stats_.compressed_length = zip_entry->GetCompressedLength();
+    stats_.uncompressed_length = zip_entry->GetUncompressedLength();
+    stats_.duration_ns = NanoTime() - start_ns;
+    success_ = true;
+    VLOG(startup) << "Zip: extracted '" << name_ << "' ("
+                  << PrettySize(stats_.compressed_length) << " -> "
+                  << PrettySize(stats_.uncompressed_length) << ") in "
+                  << PrettyDuration(stats_.duration_ns) << ", "
+                  << PrettySize(stats_.GetBytesPerSecond()) << "/s";
+  }
+
+  bool IsSuccess() const {
+    return success_;
+  }
+
+  MemMap* ReleaseMap() {
+    return map_.release();
+  }
+
+  const ZipExtractionStats& GetStats() const {
+    return stats_;
+  }
+
+ private:
+  const ZipArchive* const zip_archive_;
+  const std::string name_;
+  UniquePtr<MemMap> map_;
+  ZipExtractionStats stats_;
+  bool success_;
+
+  DISALLOW_COPY_AND_ASSIGN(ZipExtractTask);
+};
+
+}  // namespace
+
+bool ZipArchive::ExtractToMemMaps(const std::vector<std::string>& names, ThreadPool* thread_pool,
+                                  std::vector<MemMap*>* maps,
+                                  std::vector<ZipExtractionStats>* stats) const {
+  DCHECK(maps != NULL);
+  Thread* self = Thread::Current();
+  std::vector<ZipExtractTask*> tasks;
+  for (size_t i = 0; i < names.size(); ++i) {
+    tasks.push_back(new ZipExtractTask(this, names[i]));
+  }
+  // Each entry is one task, so the largest entries bound the wall time; queue them first so they
+  // don't start last.
+  if (thread_pool != NULL && tasks.size() > 1) {
+    std::vector<std::pair<uint32_t, size_t> > order;
+    for (size_t i = 0; i < names.size(); ++i) {
+      UniquePtr<ZipEntry> zip_entry(Find(names[i].c_str()));
+      uint32_t length = (zip_entry.get() != NULL) ? zip_entry->GetUncompressedLength() : 0;
+      order.push_back(std::make_pair(length, i));
+    }
+    std::sort(order.rbegin(), order.rend());
+    for (size_t i = 0; i < order.size(); ++i) {
+      thread_pool->AddTask(self, tasks[order[i].second]);
+    }
+    thread_pool->StartWorkers(self);
+    thread_pool->Wait(self, true, false);
+  } else {
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      tasks[i]->Run(self);
+    }
+  }
+
+  bool success = true;
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    success = success && tasks[i]->IsSuccess();
+  }
+  maps->clear();
+  if (stats != NULL) {
+    stats->clear();
+  }
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    if (success) {
+      maps->push_back(tasks[i]->ReleaseMap());
+      if (stats != NULL) {
+        stats->push_back(tasks[i]->GetStats());
+      }
+    }
+    delete tasks[i];
+  }
+  return success;
+}
+
 // Find the zip Central Directory and memory-map it.
 //
 // On success, returns true after populating fields from the EOCD area:
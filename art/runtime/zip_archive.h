@@ -20,6 +20,9 @@
 #include <stdint.h>
 #include <zlib.h>
 
+#include <string>
+#include <vector>
+
 #include "base/logging.h"
 #include "base/stringpiece.h"
 #include "base/unix_file/random_access_file.h"
@@ -33,13 +36,34 @@ namespace art {
 
 class ZipArchive;
 class MemMap;
+class ThreadPool;
+
+// Sizes and wall time of one entry extracted by ZipArchive::ExtractToMemMaps.
+struct ZipExtractionStats {
+  uint32_t compressed_length;
+  uint32_t uncompressed_length;
+  uint64_t duration_ns;
 
+  // Uncompressed bytes produced per second.
+  uint64_t GetBytesPerSecond() const;
+};
+
+// Extraction maps just the entry's data (or uses positional reads if that fails) and never moves
+// the archive's file offset, so several entries of one archive may be extracted concurrently.
 class ZipEntry {
  public:
   bool ExtractToFile(File& file);
   bool ExtractToMemory(uint8_t* begin, size_t size);
   MemMap* ExtractToMemMap(const char* entry_filename);
 
+  // Maps a stored (uncompressed) entry straight from the archive file instead of copying it, so
+  // its clean pages are shared with every other process mapping the same archive. The mapping is
+  // private and writable; written pages are copied on write and never reach the archive. Returns
+  // NULL if the entry is compressed or its data is not aligned to alignment bytes, in which case
+  // the caller should fall back to ExtractToMemMap.
+  MemMap* MapDirectlyFromFile(const char* entry_filename, size_t alignment);
+
+  uint32_t GetCompressedLength();
   uint32_t GetUncompressedLength();
   uint32_t GetCrc32();
 
@@ -55,8 +79,6 @@ class ZipEntry {
   // kCompressStored, kCompressDeflated, ...
   uint16_t GetCompressionMethod();
 
-  uint32_t GetCompressedLength();
-
   // returns -1 on error
   off64_t GetDataOffset();
 
@@ -114,6 +136,14 @@ class ZipArchive {
 
   ZipEntry* Find(const char* name) const;
 
+  // Extracts the named entries into anonymous maps, inflating several entries at once on
+  // thread_pool's workers and the calling thread, or one after another if thread_pool is NULL.
+  // On success (*maps)[i] holds names[i] and is owned by the caller, and if stats is not NULL
+  // (*stats)[i] describes its extraction. On failure returns false and no maps are returned.
+  bool ExtractToMemMaps(const std::vector<std::string>& names, ThreadPool* thread_pool,
+                        std::vector<MemMap*>* maps,
+                        std::vector<ZipExtractionStats>* stats) const;
+
   ~ZipArchive() {
     Close();
   }
@@ -20,14 +20,86 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <string>
+#include <vector>
+
 #include "UniquePtr.h"
 #include "common_test.h"
 #include "os.h"
+#include "thread_pool.h"
 
 namespace art {
 
 class ZipArchiveTest : public CommonTest {};
 
+static void AppendLe16(std::vector<uint8_t>* out, uint16_t value) {
+  out->push_back(value & 0xff);
+  out->push_back(value >> 8);
+}
+
+static void AppendLe32(std::vector<uint8_t>* out, uint32_t value) {
+  AppendLe16(out, value & 0xffff);
+  AppendLe16(out, value >> 16);
+}
+
+// Writes a zip archive holding data as a single stored entry called name, padding the local
+// header's extra field so that the data starts at data_offset.
+static void WriteStoredZip(File* file, const char* name, const std::vector<uint8_t>& data,
+                           size_t data_offset) {
+  uint16_t name_len = strlen(name);
+  size_t header_len = ZipArchive::kLFHLen + name_len;
+  ASSERT_GE(data_offset, header_len);
+  uint16_t extra_len = data_offset - header_len;
+  uint32_t crc = crc32(crc32(0L, Z_NULL, 0), &data[0], data.size());
+
+  std::vector<uint8_t> zip;
+  AppendLe32(&zip, ZipArchive::kLFHSignature);
+  AppendLe16(&zip, 10);  // version needed
+  AppendLe16(&zip, 0);  // flags
+  AppendLe16(&zip, 0);  // method: stored
+  AppendLe32(&zip, 0);  // mod time/date
+  AppendLe32(&zip, crc);
+  AppendLe32(&zip, data.size());
+  AppendLe32(&zip, data.size());
+  AppendLe16(&zip, name_len);
+  AppendLe16(&zip, extra_len);
+  zip.insert(zip.end(), name, name + name_len);
+  zip.resize(zip.size() + extra_len, 0);
+  ASSERT_EQ(data_offset, zip.size());
+  zip.insert(zip.end(), data.begin(), data.end());
+
+  uint32_t dir_offset = zip.size();
+  AppendLe32(&zip, ZipArchive::kCDESignature);
+  AppendLe16(&zip, 10);  // version made by
+  AppendLe16(&zip, 10);  // version needed
+  AppendLe16(&zip, 0);  // flags
+  AppendLe16(&zip, 0);  // method: stored
+  AppendLe32(&zip, 0);  // mod time/date
+  AppendLe32(&zip, crc);
+  AppendLe32(&zip, data.size());
+  AppendLe32(&zip, data.size());
+  AppendLe16(&zip, name_len);
+  AppendLe16(&zip, 0);  // extra length
+  AppendLe16(&zip, 0);  // comment length
+  AppendLe16(&zip, 0);  // disk number
+  AppendLe16(&zip, 0);  // internal attributes
+  AppendLe32(&zip, 0);  // external attributes
+  AppendLe32(&zip, 0);  // local header offset
+  zip.insert(zip.end(), name, name + name_len);
+  uint32_t dir_size = zip.size() - dir_offset;
+
+  AppendLe32(&zip, ZipArchive::kEOCDSignature);
+  AppendLe16(&zip, 0);  // disk number
+  AppendLe16(&zip, 0);  // disk with central directory
+  AppendLe16(&zip, 1);  // entries on this disk
+  AppendLe16(&zip, 1);  // total entries
+  AppendLe32(&zip, dir_size);
+  AppendLe32(&zip, dir_offset);
+  AppendLe16(&zip, 0);  // comment length
+
+  ASSERT_TRUE(file->WriteFully(&zip[0], zip.size()));
+}
+
 TEST_F(ZipArchiveTest, FindAndExtract) {
   UniquePtr<ZipArchive> zip_archive(ZipArchive::Open(GetLibCoreDexFileName()));
   ASSERT_TRUE(zip_archive.get() != false);
@@ -57,4 +129,72 @@ TEST_F(ZipArchiveTest, FindAndExtract) {
   EXPECT_EQ(zip_entry->GetCrc32(), computed_crc);
 }
 
+TEST_F(ZipArchiveTest, ExtractToMemMaps) {
+  UniquePtr<ZipArchive> zip_archive(ZipArchive::Open(GetLibCoreDexFileName()));
+  ASSERT_TRUE(zip_archive.get() != NULL);
+  UniquePtr<ZipEntry> zip_entry(zip_archive->Find("classes.dex"));
+  ASSERT_TRUE(zip_entry.get() != NULL);
+
+  // Extracting the same entry several times at once exercises concurrent reads of one archive.
+  std::vector<std::string> names(4, "classes.dex");
+  ThreadPool thread_pool(2);
+  std::vector<MemMap*> maps;
+  std::vector<ZipExtractionStats> stats;
+  ASSERT_TRUE(zip_archive->ExtractToMemMaps(names, &thread_pool, &maps, &stats));
+  ASSERT_EQ(names.size(), maps.size());
+  ASSERT_EQ(names.size(), stats.size());
+  for (size_t i = 0; i < maps.size(); ++i) {
+    UniquePtr<MemMap> map(maps[i]);
+    ASSERT_EQ(zip_entry->GetUncompressedLength(), map->Size());
+    uint32_t computed_crc = crc32(crc32(0L, Z_NULL, 0), map->Begin(), map->Size());
+    EXPECT_EQ(zip_entry->GetCrc32(), computed_crc);
+    EXPECT_EQ(zip_entry->GetCompressedLength(), stats[i].compressed_length);
+    EXPECT_EQ(zip_entry->GetUncompressedLength(), stats[i].uncompressed_length);
+  }
+
+  // A missing entry fails the whole request.
+  names.push_back("no-such-entry");
+  EXPECT_FALSE(zip_archive->ExtractToMemMaps(names, NULL, &maps, NULL));
+  EXPECT_TRUE(maps.empty());
+}
+
+TEST_F(ZipArchiveTest, MapDirectlyFromFile) {
+  std::vector<uint8_t> data;
+  for (size_t i = 0; i < 3 * kPageSize + 17; ++i) {
+    data.push_back(i * 31);
+  }
+
+  // Aligned stored data is mapped in place, with the same contents an extraction produces.
+  ScratchFile aligned;
+  WriteStoredZip(aligned.GetFile(), "classes.dex", data, 64);
+  UniquePtr<ZipArchive> zip_archive(ZipArchive::Open(aligned.GetFilename()));
+  ASSERT_TRUE(zip_archive.get() != NULL);
+  UniquePtr<ZipEntry> zip_entry(zip_archive->Find("classes.dex"));
+  ASSERT_TRUE(zip_entry.get() != NULL);
+  UniquePtr<MemMap> mapped(zip_entry->MapDirectlyFromFile("classes.dex", 4));
+  ASSERT_TRUE(mapped.get() != NULL);
+  ASSERT_EQ(data.size(), mapped->Size());
+  EXPECT_EQ(0, memcmp(&data[0], mapped->Begin(), data.size()));
+  UniquePtr<MemMap> extracted(zip_entry->ExtractToMemMap("classes.dex"));
+  ASSERT_TRUE(extracted.get() != NULL);
+  ASSERT_EQ(data.size(), extracted->Size());
+  EXPECT_EQ(0, memcmp(&data[0], extracted->Begin(), data.size()));
+
+  // Misaligned stored data has to be extracted.
+  ScratchFile misaligned;
+  WriteStoredZip(misaligned.GetFile(), "classes.dex", data, 63);
+  zip_archive.reset(ZipArchive::Open(misaligned.GetFilename()));
+  ASSERT_TRUE(zip_archive.get() != NULL);
+  zip_entry.reset(zip_archive->Find("classes.dex"));
+  ASSERT_TRUE(zip_entry.get() != NULL);
+  EXPECT_TRUE(zip_entry->MapDirectlyFromFile("classes.dex", 4) == NULL);
+
+  // So does compressed data.
+  zip_archive.reset(ZipArchive::Open(GetLibCoreDexFileName()));
+  ASSERT_TRUE(zip_archive.get() != NULL);
+  zip_entry.reset(zip_archive->Find("classes.dex"));
+  ASSERT_TRUE(zip_entry.get() != NULL);
+  EXPECT_TRUE(zip_entry->MapDirectlyFromFile("classes.dex", 4) == NULL);
+}
+
 }  // namespace art
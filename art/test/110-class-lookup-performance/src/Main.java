@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Class lookup and loading benchmark. Every Class.forName goes through the
+ * class linker's table of loaded classes, first to load the application
+ * classes below and then, from several threads at once, to look up classes
+ * that are already loaded.
+ */
+public class Main {
+    static final int THREADS = 4;
+    static final int ITERATIONS = 1000;
+
+    static final String[] BOOT_CLASSES = {
+        "java.lang.Object", "java.lang.String", "java.lang.Integer",
+        "java.lang.Long", "java.lang.Thread", "java.lang.StringBuilder",
+        "java.lang.Math", "java.lang.System", "java.lang.Runtime",
+        "java.util.ArrayList", "java.util.HashMap", "java.util.LinkedList",
+        "java.util.TreeMap", "java.util.Collections", "java.util.Arrays",
+        "java.io.File", "java.io.InputStream", "java.io.PrintStream",
+        "java.util.concurrent.ConcurrentHashMap",
+        "java.util.concurrent.atomic.AtomicInteger",
+        "[I", "[Ljava.lang.String;", "[[J",
+    };
+
+    static class A0 {} static class A1 {} static class A2 {} static class A3 {}
+    static class A4 {} static class A5 {} static class A6 {} static class A7 {}
+    static class A8 {} static class A9 {} static class A10 {} static class A11 {}
+    static class A12 {} static class A13 {} static class A14 {} static class A15 {}
+
+    static final int APP_CLASSES = 16;
+
+    static public void main(String[] args) throws Exception {
+        boolean timing = (args.length >= 1) && args[0].equals("--timing");
+        run(timing);
+    }
+
+    static public void run(boolean timing) throws Exception {
+        long time0 = System.nanoTime();
+        int loaded = 0;
+        for (int i = 0; i < APP_CLASSES; i++) {
+            if (Class.forName("Main$A" + i).getSimpleName().equals("A" + i)) {
+                loaded++;
+            }
+        }
+        long time1 = System.nanoTime();
+        int iterations = lookup();
+        long time2 = System.nanoTime();
+
+        System.out.println("loaded " + loaded + " application classes");
+        System.out.println("lookup: performed " + iterations + " iterations on " + THREADS +
+                           " threads");
+
+        if (timing) {
+            double loadMsec = (time1 - time0) / (double) APP_CLASSES / 1000000;
+            double lookupMsec = (time2 - time1) / (double) iterations / 1000000;
+            System.out.printf("load: %.3g msec per class\n", loadMsec);
+            System.out.printf("lookup: %.3g msec per iteration\n", lookupMsec);
+        }
+    }
+
+    /**
+     * Looks up all of BOOT_CLASSES and the application classes ITERATIONS
+     * times on each of THREADS threads, returning the total iteration count.
+     */
+    static int lookup() throws Exception {
+        final int[] counts = new int[THREADS];
+        Thread[] threads = new Thread[THREADS];
+        for (int t = 0; t < THREADS; t++) {
+            final int id = t;
+            threads[t] = new Thread() {
+                public void run() {
+                    try {
+                        for (int i = 0; i < ITERATIONS; i++) {
+                            for (String name : BOOT_CLASSES) {
+                                Class.forName(name);
+                            }
+                            Class.forName("Main$A" + (i % APP_CLASSES));
+                            counts[id]++;
+                        }
+                    } catch (ClassNotFoundException ex) {
+                        throw new AssertionError(ex);
+                    }
+                }
+            };
+        }
+        for (Thread thread : threads) {
+            thread.start();
+        }
+        int total = 0;
+        for (int t = 0; t < THREADS; t++) {
+            threads[t].join();
+            total += counts[t];
+        }
+        return total;
+    }
+}
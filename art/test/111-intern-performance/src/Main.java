@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Intern table benchmark. Several threads intern the same set of strings
+ * over and over, racing to add them on the first pass and finding them
+ * already interned afterwards, and then each interns strings that only it
+ * uses. Every thread must get the same canonical string for equal contents.
+ */
+public class Main {
+    static final int THREADS = 8;
+    static final int STRINGS = 2000;
+    static final int ITERATIONS = 20;
+
+    static public void main(String[] args) throws Exception {
+        boolean timing = (args.length >= 1) && args[0].equals("--timing");
+        run(timing);
+    }
+
+    static public void run(boolean timing) throws Exception {
+        final String[][] shared = new String[THREADS][];
+        long time0 = System.nanoTime();
+        runThreads(new Body() {
+            public void run(int id) {
+                String[] canonical = new String[STRINGS];
+                for (int i = 0; i < ITERATIONS; i++) {
+                    for (int j = 0; j < STRINGS; j++) {
+                        // Build a new string each time so that intern() has real work to do.
+                        String s = new StringBuilder("shared-").append(j).toString().intern();
+                        if (canonical[j] == null) {
+                            canonical[j] = s;
+                        } else if (canonical[j] != s) {
+                            throw new AssertionError("intern of " + s + " changed");
+                        }
+                    }
+                }
+                shared[id] = canonical;
+            }
+        });
+        long time1 = System.nanoTime();
+        runThreads(new Body() {
+            public void run(int id) {
+                for (int j = 0; j < STRINGS; j++) {
+                    String s = new StringBuilder("unique-").append(id).append('-').append(j)
+                        .toString();
+                    if (s.intern() != s) {
+                        throw new AssertionError("first intern of " + s + " was not itself");
+                    }
+                }
+            }
+        });
+        long time2 = System.nanoTime();
+
+        boolean agree = true;
+        for (int t = 1; t < THREADS; t++) {
+            for (int j = 0; j < STRINGS; j++) {
+                if (shared[t][j] != shared[0][j]) {
+                    agree = false;
+                }
+            }
+        }
+
+        System.out.println("shared: interned " + STRINGS + " strings " + ITERATIONS +
+                           " times on " + THREADS + " threads");
+        System.out.println("unique: interned " + STRINGS + " strings on each of " + THREADS +
+                           " threads");
+        System.out.println(agree ? "all threads agree" : "threads disagree");
+
+        if (timing) {
+            double sharedUsec = (time1 - time0) / (double) (THREADS * ITERATIONS * STRINGS) / 1000;
+            double uniqueUsec = (time2 - time1) / (double) (THREADS * STRINGS) / 1000;
+            System.out.printf("shared: %.3g usec per intern\n", sharedUsec);
+            System.out.printf("unique: %.3g usec per intern\n", uniqueUsec);
+        }
+    }
+
+    interface Body {
+        void run(int id);
+    }
+
+    /**
+     * Runs body on THREADS threads at once and waits for all of them.
+     */
+    static void runThreads(final Body body) throws Exception {
+        Thread[] threads = new Thread[THREADS];
+        for (int t = 0; t < THREADS; t++) {
+            final int id = t;
+            threads[t] = new Thread() {
+                public void run() {
+                    body.run(id);
+                }
+            };
+        }
+        for (Thread thread : threads) {
+            thread.start();
+        }
+        for (Thread thread : threads) {
+            thread.join();
+        }
+    }
+}
@@ -0,0 +1,447 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Class linking benchmark. Each class in the chain C0 .. C11 declares 24
+ * virtual methods, overriding half of its superclass's and adding the rest,
+ * and implements an interface, so that building its vtable and interface
+ * table has to match many methods by name and signature.
+ */
+public class Main {
+    static final int DEPTH = 12;
+
+    static public void main(String[] args) throws Exception {
+        boolean timing = (args.length >= 1) && args[0].equals("--timing");
+        run(timing);
+    }
+
+    static public void run(boolean timing) throws Exception {
+        long time0 = System.nanoTime();
+        for (int i = 0; i < DEPTH; i++) {
+            Class.forName("Main$C" + i);
+        }
+        long time1 = System.nanoTime();
+        C0 c = (C0) Class.forName("Main$C" + (DEPTH - 1)).newInstance();
+
+        System.out.println("linked " + DEPTH + " classes");
+        System.out.println("m0 returns " + c.m0() + ", i0_0 returns " + ((I0) c).i0_0());
+
+        if (timing) {
+            double linkMsec = (time1 - time0) / (double) DEPTH / 1000000;
+            System.out.printf("link: %.3g msec per class\n", linkMsec);
+        }
+    }
+
+    interface I0 {
+        int i0_0();
+        int i0_1();
+        int i0_2();
+        int i0_3();
+        int i0_4();
+        int i0_5();
+        int i0_6();
+        int i0_7();
+    }
+
+    interface I1 {
+        int i1_0();
+        int i1_1();
+        int i1_2();
+        int i1_3();
+        int i1_4();
+        int i1_5();
+        int i1_6();
+        int i1_7();
+    }
+
+    interface I2 {
+        int i2_0();
+        int i2_1();
+        int i2_2();
+        int i2_3();
+        int i2_4();
+        int i2_5();
+        int i2_6();
+        int i2_7();
+    }
+
+    interface I3 {
+        int i3_0();
+        int i3_1();
+        int i3_2();
+        int i3_3();
+        int i3_4();
+        int i3_5();
+        int i3_6();
+        int i3_7();
+    }
+
+    public static class C0 implements I0 {
+        public int m0() { return 0; }
+        public int m1() { return 0; }
+        public int m2() { return 0; }
+        public int m3() { return 0; }
+        public int m4() { return 0; }
+        public int m5() { return 0; }
+        public int m6() { return 0; }
+        public int m7() { return 0; }
+        public int m8() { return 0; }
+        public int m9() { return 0; }
+        public int m10() { return 0; }
+        public int m11() { return 0; }
+        public int m12() { return 0; }
+        public int m13() { return 0; }
+        public int m14() { return 0; }
+        public int m15() { return 0; }
+        public int m16() { return 0; }
+        public int m17() { return 0; }
+        public int m18() { return 0; }
+        public int m19() { return 0; }
+        public int m20() { return 0; }
+        public int m21() { return 0; }
+        public int m22() { return 0; }
+        public int m23() { return 0; }
+        public int i0_0() { return 0; }
+        public int i0_1() { return 0; }
+        public int i0_2() { return 0; }
+        public int i0_3() { return 0; }
+        public int i0_4() { return 0; }
+        public int i0_5() { return 0; }
+        public int i0_6() { return 0; }
+        public int i0_7() { return 0; }
+    }
+
+    public static class C1 extends C0 implements I1 {
+        public int m0() { return 1; }
+        public int m2() { return 1; }
+        public int m4() { return 1; }
+        public int m6() { return 1; }
+        public int m8() { return 1; }
+        public int m10() { return 1; }
+        public int m12() { return 1; }
+        public int m14() { return 1; }
+        public int m16() { return 1; }
+        public int m18() { return 1; }
+        public int m20() { return 1; }
+        public int m22() { return 1; }
+        public int m24() { return 1; }
+        public int m25() { return 1; }
+        public int m26() { return 1; }
+        public int m27() { return 1; }
+        public int m28() { return 1; }
+        public int m29() { return 1; }
+        public int m30() { return 1; }
+        public int m31() { return 1; }
+        public int m32() { return 1; }
+        public int m33() { return 1; }
+        public int m34() { return 1; }
+        public int m35() { return 1; }
+        public int i1_0() { return 1; }
+        public int i1_1() { return 1; }
+        public int i1_2() { return 1; }
+        public int i1_3() { return 1; }
+        public int i1_4() { return 1; }
+        public int i1_5() { return 1; }
+        public int i1_6() { return 1; }
+        public int i1_7() { return 1; }
+    }
+
+    public static class C2 extends C1 implements I2 {
+        public int m0() { return 2; }
+        public int m2() { return 2; }
+        public int m4() { return 2; }
+        public int m6() { return 2; }
+        public int m8() { return 2; }
+        public int m10() { return 2; }
+        public int m12() { return 2; }
+        public int m14() { return 2; }
+        public int m16() { return 2; }
+        public int m18() { return 2; }
+        public int m20() { return 2; }
+        public int m22() { return 2; }
+        public int m36() { return 2; }
+        public int m37() { return 2; }
+        public int m38() { return 2; }
+        public int m39() { return 2; }
+        public int m40() { return 2; }
+        public int m41() { return 2; }
+        public int m42() { return 2; }
+        public int m43() { return 2; }
+        public int m44() { return 2; }
+        public int m45() { return 2; }
+        public int m46() { return 2; }
+        public int m47() { return 2; }
+        public int i2_0() { return 2; }
+        public int i2_1() { return 2; }
+        public int i2_2() { return 2; }
+        public int i2_3() { return 2; }
+        public int i2_4() { return 2; }
+        public int i2_5() { return 2; }
+        public int i2_6() { return 2; }
+        public int i2_7() { return 2; }
+    }
+
+    public static class C3 extends C2 implements I3 {
+        public int m0() { return 3; }
+        public int m2() { return 3; }
+        public int m4() { return 3; }
+        public int m6() { return 3; }
+        public int m8() { return 3; }
+        public int m10() { return 3; }
+        public int m12() { return 3; }
+        public int m14() { return 3; }
+        public int m16() { return 3; }
+        public int m18() { return 3; }
+        public int m20() { return 3; }
+        public int m22() { return 3; }
+        public int m48() { return 3; }
+        public int m49() { return 3; }
+        public int m50() { return 3; }
+        public int m51() { return 3; }
+        public int m52() { return 3; }
+        public int m53() { return 3; }
+        public int m54() { return 3; }
+        public int m55() { return 3; }
+        public int m56() { return 3; }
+        public int m57() { return 3; }
+        public int m58() { return 3; }
+        public int m59() { return 3; }
+        public int i3_0() { return 3; }
+        public int i3_1() { return 3; }
+        public int i3_2() { return 3; }
+        public int i3_3() { return 3; }
+        public int i3_4() { return 3; }
+        public int i3_5() { return 3; }
+        public int i3_6() { return 3; }
+        public int i3_7() { return 3; }
+    }
+
+    public static class C4 extends C3 implements I0 {
+        public int m0() { return 4; }
+        public int m2() { return 4; }
+        public int m4() { return 4; }
+        public int m6() { return 4; }
+        public int m8() { return 4; }
+        public int m10() { return 4; }
+        public int m12() { return 4; }
+        public int m14() { return 4; }
+        public int m16() { return 4; }
+        public int m18() { return 4; }
+        public int m20() { return 4; }
+        public int m22() { return 4; }
+        public int m60() { return 4; }
+        public int m61() { return 4; }
+        public int m62() { return 4; }
+        public int m63() { return 4; }
+        public int m64() { return 4; }
+        public int m65() { return 4; }
+        public int m66() { return 4; }
+        public int m67() { return 4; }
+        public int m68() { return 4; }
+        public int m69() { return 4; }
+        public int m70() { return 4; }
+        public int m71() { return 4; }
+    }
+
+    public static class C5 extends C4 implements I1 {
+        public int m0() { return 5; }
+        public int m2() { return 5; }
+        public int m4() { return 5; }
+        public int m6() { return 5; }
+        public int m8() { return 5; }
+        public int m10() { return 5; }
+        public int m12() { return 5; }
+        public int m14() { return 5; }
+        public int m16() { return 5; }
+        public int m18() { return 5; }
+        public int m20() { return 5; }
+        public int m22() { return 5; }
+        public int m72() { return 5; }
+        public int m73() { return 5; }
+        public int m74() { return 5; }
+        public int m75() { return 5; }
+        public int m76() { return 5; }
+        public int m77() { return 5; }
+        public int m78() { return 5; }
+        public int m79() { return 5; }
+        public int m80() { return 5; }
+        public int m81() { return 5; }
+        public int m82() { return 5; }
+        public int m83() { return 5; }
+    }
+
+    public static class C6 extends C5 implements I2 {
+        public int m0() { return 6; }
+        public int m2() { return 6; }
+        public int m4() { return 6; }
+        public int m6() { return 6; }
+        public int m8() { return 6; }
+        public int m10() { return 6; }
+        public int m12() { return 6; }
+        public int m14() { return 6; }
+        public int m16() { return 6; }
+        public int m18() { return 6; }
+        public int m20() { return 6; }
+        public int m22() { return 6; }
+        public int m84() { return 6; }
+        public int m85() { return 6; }
+        public int m86() { return 6; }
+        public int m87() { return 6; }
+        public int m88() { return 6; }
+        public int m89() { return 6; }
+        public int m90() { return 6; }
+        public int m91() { return 6; }
+        public int m92() { return 6; }
+        public int m93() { return 6; }
+        public int m94() { return 6; }
+        public int m95() { return 6; }
+    }
+
+    public static class C7 extends C6 implements I3 {
+        public int m0() { return 7; }
+        public int m2() { return 7; }
+        public int m4() { return 7; }
+        public int m6() { return 7; }
+        public int m8() { return 7; }
+        public int m10() { return 7; }
+        public int m12() { return 7; }
+        public int m14() { return 7; }
+        public int m16() { return 7; }
+        public int m18() { return 7; }
+        public int m20() { return 7; }
+        public int m22() { return 7; }
+        public int m96() { return 7; }
+        public int m97() { return 7; }
+        public int m98() { return 7; }
+        public int m99() { return 7; }
+        public int m100() { return 7; }
+        public int m101() { return 7; }
+        public int m102() { return 7; }
+        public int m103() { return 7; }
+        public int m104() { return 7; }
+        public int m105() { return 7; }
+        public int m106() { return 7; }
+        public int m107() { return 7; }
+    }
+
+    public static class C8 extends C7 implements I0 {
+        public int m0() { return 8; }
+        public int m2() { return 8; }
+        public int m4() { return 8; }
+        public int m6() { return 8; }
+        public int m8() { return 8; }
+        public int m10() { return 8; }
+        public int m12() { return 8; }
+        public int m14() { return 8; }
+        public int m16() { return 8; }
+        public int m18() { return 8; }
+        public int m20() { return 8; }
+        public int m22() { return 8; }
+        public int m108() { return 8; }
+        public int m109() { return 8; }
+        public int m110() { return 8; }
+        public int m111() { return 8; }
+        public int m112() { return 8; }
+        public int m113() { return 8; }
+        public int m114() { return 8; }
+        public int m115() { return 8; }
+        public int m116() { return 8; }
+        public int m117() { return 8; }
+        public int m118() { return 8; }
+        public int m119() { return 8; }
+    }
+
+    public static class C9 extends C8 implements I1 {
+        public int m0() { return 9; }
+        public int m2() { return 9; }
+        public int m4() { return 9; }
+        public int m6() { return 9; }
+        public int m8() { return 9; }
+        public int m10() { return 9; }
+        public int m12() { return 9; }
+        public int m14() { return 9; }
+        public int m16() { return 9; }
+        public int m18() { return 9; }
+        public int m20() { return 9; }
+        public int m22() { return 9; }
+        public int m120() { return 9; }
+        public int m121() { return 9; }
+        public int m122() { return 9; }
+        public int m123() { return 9; }
+        public int m124() { return 9; }
+        public int m125() { return 9; }
+        public int m126() { return 9; }
+        public int m127() { return 9; }
+        public int m128() { return 9; }
+        public int m129() { return 9; }
+        public int m130() { return 9; }
+        public int m131() { return 9; }
+    }
+
+    public static class C10 extends C9 implements I2 {
+        public int m0() { return 10; }
+        public int m2() { return 10; }
+        public int m4() { return 10; }
+        public int m6() { return 10; }
+        public int m8() { return 10; }
+        public int m10() { return 10; }
+        public int m12() { return 10; }
+        public int m14() { return 10; }
+        public int m16() { return 10; }
+        public int m18() { return 10; }
+        public int m20() { return 10; }
+        public int m22() { return 10; }
+        public int m132() { return 10; }
+        public int m133() { return 10; }
+        public int m134() { return 10; }
+        public int m135() { return 10; }
+        public int m136() { return 10; }
+        public int m137() { return 10; }
+        public int m138() { return 10; }
+        public int m139() { return 10; }
+        public int m140() { return 10; }
+        public int m141() { return 10; }
+        public int m142() { return 10; }
+        public int m143() { return 10; }
+    }
+
+    public static class C11 extends C10 implements I3 {
+        public int m0() { return 11; }
+        public int m2() { return 11; }
+        public int m4() { return 11; }
+        public int m6() { return 11; }
+        public int m8() { return 11; }
+        public int m10() { return 11; }
+        public int m12() { return 11; }
+        public int m14() { return 11; }
+        public int m16() { return 11; }
+        public int m18() { return 11; }
+        public int m20() { return 11; }
+        public int m22() { return 11; }
+        public int m144() { return 11; }
+        public int m145() { return 11; }
+        public int m146() { return 11; }
+        public int m147() { return 11; }
+        public int m148() { return 11; }
+        public int m149() { return 11; }
+        public int m150() { return 11; }
+        public int m151() { return 11; }
+        public int m152() { return 11; }
+        public int m153() { return 11; }
+        public int m154() { return 11; }
+        public int m155() { return 11; }
+    }
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Type check benchmark. D0 .. D11 form a chain of subclasses, deeper than
+ * the runtime's superclass display, and some of them implement interfaces.
+ * Every object is checked against a shallow and a deep class, an interface
+ * that half of them implement and one that none of them do.
+ */
+public class Main {
+    static final int ITERATIONS = 100000;
+
+    static public void main(String[] args) throws Exception {
+        boolean timing = (args.length >= 1) && args[0].equals("--timing");
+        run(timing);
+    }
+
+    static public void run(boolean timing) throws Exception {
+        Object[] objects = new Object[] {
+            new D0(), new D1(), new D2(), new D3(), new D4(), new D5(),
+            new D6(), new D7(), new D8(), new D9(), new D10(), new D11(),
+        };
+
+        int[] counts = count(objects);
+        System.out.println("D3: " + counts[0] + ", D10: " + counts[1] +
+                           ", J1: " + counts[2] + ", J3: " + counts[3]);
+
+        long time0 = System.nanoTime();
+        for (int i = 0; i < ITERATIONS; i++) {
+            count(objects);
+        }
+        long time1 = System.nanoTime();
+        for (int i = 0; i < ITERATIONS; i++) {
+            cast(objects);
+        }
+        long time2 = System.nanoTime();
+        System.out.println("checked " + objects.length + " objects");
+
+        if (timing) {
+            double checks = (double) ITERATIONS * objects.length;
+            System.out.printf("instance-of: %.3g nsec per object\n", (time1 - time0) / checks);
+            System.out.printf("check-cast: %.3g nsec per object\n", (time2 - time1) / checks);
+        }
+    }
+
+    static int[] count(Object[] objects) {
+        int[] counts = new int[4];
+        for (Object o : objects) {
+            if (o instanceof D3) {
+                counts[0]++;
+            }
+            if (o instanceof D10) {
+                counts[1]++;
+            }
+            if (o instanceof J1) {
+                counts[2]++;
+            }
+            if (o instanceof J3) {
+                counts[3]++;
+            }
+        }
+        return counts;
+    }
+
+    static int cast(Object[] objects) {
+        int sum = 0;
+        for (Object o : objects) {
+            sum += ((D0) o).depth();
+            sum += ((J0) o).depth();
+        }
+        return sum;
+    }
+
+    interface J0 { int depth(); }
+    interface J1 { }
+    interface J2 { }
+    interface J3 { }
+
+    static class D0 implements J0 { public int depth() { return 0; } }
+    static class D1 extends D0 { }
+    static class D2 extends D1 { }
+    static class D3 extends D2 { }
+    static class D4 extends D3 implements J1 { }
+    static class D5 extends D4 { }
+    static class D6 extends D5 { }
+    static class D7 extends D6 { }
+    static class D8 extends D7 implements J2 { }
+    static class D9 extends D8 { }
+    static class D10 extends D9 { }
+    static class D11 extends D10 { }
+}
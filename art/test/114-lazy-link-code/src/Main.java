@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.io.File;
+import java.lang.reflect.Method;
+
+/**
+ * Lazy code linking test. The runtime leaves the code of instance methods
+ * unlinked until they are first invoked, so each family of classes below
+ * is used exactly once, and its methods are first reached through:
+ *  - a virtual call (Derived.v through a Base reference),
+ *  - a super call (Derived.v calling Base.v),
+ *  - an interface call (Iface.i),
+ *  - Method.invoke (Impl.r).
+ * Method tracing installs instrumentation stubs in every loaded class, and
+ * removes them again when it stops, so it is toggled around the first
+ * calls in each of the ways that matter.
+ */
+public class Main {
+    static Method startMethodTracing;
+    static Method stopMethodTracing;
+    static String traceFileName;
+
+    static public void main(String[] args) throws Exception {
+        boolean timing = (args.length >= 1) && args[0].equals("--timing");
+        findTracingMethods();
+        run(timing);
+    }
+
+    static public void run(boolean timing) throws Exception {
+        // Tracing off throughout.
+        long time0 = System.nanoTime();
+        Family f = new FamilyOff();
+        long time1 = System.nanoTime();
+        f.callAll("off");
+        long time2 = System.nanoTime();
+        f.callAll(null);
+        long time3 = System.nanoTime();
+
+        // Loaded, then tracing turned on before the first calls.
+        f = new FamilyOnBefore();
+        startTracing();
+        f.callAll("on before first call");
+        stopTracing();
+        f.callAll(null);
+
+        // Called once, then called with tracing on and after it is off.
+        f = new FamilyOnAfter();
+        f.callAll("on after first call");
+        startTracing();
+        f.callAll("on after first call");
+        stopTracing();
+        f.callAll("on after first call");
+
+        // Loaded while tracing, so linked eagerly, and first called after.
+        startTracing();
+        f = new FamilyOnLoad();
+        stopTracing();
+        f.callAll("on while loading");
+
+        if (timing) {
+            System.out.printf("load: %.3g usec\n", (time1 - time0) / 1000.0);
+            System.out.printf("first calls: %.3g usec\n", (time2 - time1) / 1000.0);
+            System.out.printf("second calls: %.3g usec\n", (time3 - time2) / 1000.0);
+        }
+        if (traceFileName != null) {
+            new File(traceFileName).delete();
+        }
+    }
+
+    /**
+     * Finds VMDebug's method tracing calls through reflection. In the
+     * reference implementation they are not available, and the test runs
+     * without toggling tracing.
+     */
+    static void findTracingMethods() {
+        File tmpDir = new File("/tmp");
+        File sdcard = new File("/sdcard");
+        if (tmpDir.isDirectory()) {
+            traceFileName = "/tmp/114-lazy-link-code.trace";
+        } else if (sdcard.isDirectory()) {
+            traceFileName = "/sdcard/114-lazy-link-code.trace";
+        } else {
+            return;
+        }
+        try {
+            Class<?> vmDebug = Class.forName("dalvik.system.VMDebug");
+            startMethodTracing = vmDebug.getMethod("startMethodTracing",
+                    String.class, Integer.TYPE, Integer.TYPE);
+            stopMethodTracing = vmDebug.getMethod("stopMethodTracing");
+        } catch (Exception e) {
+            startMethodTracing = null;
+            stopMethodTracing = null;
+        }
+    }
+
+    static void startTracing() throws Exception {
+        if (startMethodTracing != null) {
+            startMethodTracing.invoke(null, traceFileName, 64 * 1024, 0);
+        }
+    }
+
+    static void stopTracing() throws Exception {
+        if (stopMethodTracing != null) {
+            stopMethodTracing.invoke(null);
+        }
+    }
+
+    static abstract class Family {
+        abstract void callAll(String label) throws Exception;
+
+        static void print(String label, int derived, int base, int iface, int reflect) {
+            if (label != null) {
+                System.out.println(label + ": derived " + derived + ", base " + base +
+                                   ", interface " + iface + ", reflect " + reflect);
+            }
+        }
+    }
+
+    interface OffIface { int i(); }
+    static class OffBase { int v() { return 1; } }
+    static class OffDerived extends OffBase { int v() { return super.v() + 10; } }
+    public static class OffImpl implements OffIface {
+        public int i() { return 2; }
+        public int r() { return 3; }
+    }
+
+    static class FamilyOff extends Family {
+        final OffBase derived = new OffDerived();
+        final OffBase base = new OffBase();
+        final OffIface impl = new OffImpl();
+
+        void callAll(String label) throws Exception {
+            int d = derived.v();
+            int b = base.v();
+            int i = impl.i();
+            int r = (Integer) OffImpl.class.getMethod("r").invoke(impl);
+            print(label, d, b, i, r);
+        }
+    }
+
+    interface OnBeforeIface { int i(); }
+    static class OnBeforeBase { int v() { return 1; } }
+    static class OnBeforeDerived extends OnBeforeBase { int v() { return super.v() + 10; } }
+    public static class OnBeforeImpl implements OnBeforeIface {
+        public int i() { return 2; }
+        public int r() { return 3; }
+    }
+
+    static class FamilyOnBefore extends Family {
+        final OnBeforeBase derived = new OnBeforeDerived();
+        final OnBeforeBase base = new OnBeforeBase();
+        final OnBeforeIface impl = new OnBeforeImpl();
+
+        void callAll(String label) throws Exception {
+            int d = derived.v();
+            int b = base.v();
+            int i = impl.i();
+            int r = (Integer) OnBeforeImpl.class.getMethod("r").invoke(impl);
+            print(label, d, b, i, r);
+        }
+    }
+
+    interface OnAfterIface { int i(); }
+    static class OnAfterBase { int v() { return 1; } }
+    static class OnAfterDerived extends OnAfterBase { int v() { return super.v() + 10; } }
+    public static class OnAfterImpl implements OnAfterIface {
+        public int i() { return 2; }
+        public int r() { return 3; }
+    }
+
+    static class FamilyOnAfter extends Family {
+        final OnAfterBase derived = new OnAfterDerived();
+        final OnAfterBase base = new OnAfterBase();
+        final OnAfterIface impl = new OnAfterImpl();
+
+        void callAll(String label) throws Exception {
+            int d = derived.v();
+            int b = base.v();
+            int i = impl.i();
+            int r = (Integer) OnAfterImpl.class.getMethod("r").invoke(impl);
+            print(label, d, b, i, r);
+        }
+    }
+
+    interface OnLoadIface { int i(); }
+    static class OnLoadBase { int v() { return 1; } }
+    static class OnLoadDerived extends OnLoadBase { int v() { return super.v() + 10; } }
+    public static class OnLoadImpl implements OnLoadIface {
+        public int i() { return 2; }
+        public int r() { return 3; }
+    }
+
+    static class FamilyOnLoad extends Family {
+        final OnLoadBase derived = new OnLoadDerived();
+        final OnLoadBase base = new OnLoadBase();
+        final OnLoadIface impl = new OnLoadImpl();
+
+        void callAll(String label) throws Exception {
+            int d = derived.v();
+            int b = base.v();
+            int i = impl.i();
+            int r = (Integer) OnLoadImpl.class.getMethod("r").invoke(impl);
+            print(label, d, b, i, r);
+        }
+    }
+}
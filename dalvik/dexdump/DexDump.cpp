@@ -36,6 +36,7 @@
 #include "libdex/DexCatch.h"
 #include "libdex/DexClass.h"
 #include "libdex/DexDebugInfo.h"
+#include "libdex/DexIndex.h"
 #include "libdex/DexOpcodes.h"
 #include "libdex/DexProto.h"
 #include "libdex/InstrUtils.h"
@@ -49,12 +50,17 @@
 #include <getopt.h>
 #include <errno.h>
 #include <assert.h>
+#include <stdarg.h>
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
 
 static const char* gProgName = "dexdump";
 
 enum OutputFormat {
     OUTPUT_PLAIN = 0,               /* default */
     OUTPUT_XML,                     /* fancy */
+    OUTPUT_JSON,                    /* method index, one object per line */
 };
 
 /* command-line options */
@@ -69,6 +75,8 @@ struct Options {
     const char* tempFileName;
     bool exportsOnly;
     bool verbose;
+    int numThreads;
+    const char* indexFileName;
 };
 
 struct Options gOptions;
@@ -96,6 +104,108 @@ static inline u4 get4LE(unsigned char const* pSrc)
     return pSrc[0] | (pSrc[1] << 8) | (pSrc[2] << 16) | (pSrc[3] << 24);
 }
 
+/*
+ * A growable block of output text.
+ */
+struct OutputBuffer {
+    char* data;
+    size_t length;
+    size_t capacity;
+};
+
+#ifdef HAVE_PTHREADS
+/*
+ * When dumping classes in parallel, each worker thread points this at its
+ * own OutputBuffer.  Output from threads without one goes to stdout.
+ */
+static pthread_key_t gOutputBufferKey;
+static bool gOutputBufferKeyCreated = false;
+#endif
+
+static OutputBuffer* currentOutputBuffer()
+{
+#ifdef HAVE_PTHREADS
+    if (gOutputBufferKeyCreated)
+        return (OutputBuffer*) pthread_getspecific(gOutputBufferKey);
+#endif
+    return NULL;
+}
+
+/*
+ * Make room for "extra" more bytes (plus a '\0') in "pBuf".
+ */
+static void growOutputBuffer(OutputBuffer* pBuf, size_t extra)
+{
+    size_t needed = pBuf->length + extra + 1;
+    if (needed <= pBuf->capacity)
+        return;
+
+    size_t newCapacity = (pBuf->capacity < 4096) ? 4096 : pBuf->capacity;
+    while (newCapacity < needed)
+        newCapacity *= 2;
+
+    char* newData = (char*) realloc(pBuf->data, newCapacity);
+    if (newData == NULL) {
+        fprintf(stderr, "ERROR: out of memory for output buffer\n");
+        exit(1);
+    }
+    pBuf->data = newData;
+    pBuf->capacity = newCapacity;
+}
+
+/*
+ * All dump output goes through here, so that it can be redirected into a
+ * per-thread buffer.
+ */
+static void outPrintf(const char* fmt, ...)
+    __attribute__ ((format (printf, 1, 2)));
+
+static void outPrintf(const char* fmt, ...)
+{
+    OutputBuffer* pBuf = currentOutputBuffer();
+    va_list args;
+
+    if (pBuf == NULL) {
+        va_start(args, fmt);
+        vprintf(fmt, args);
+        va_end(args);
+        return;
+    }
+
+    /* try to format in place; if that doesn't fit, grow and go again */
+    size_t avail = pBuf->capacity - pBuf->length;
+    va_start(args, fmt);
+    int len = vsnprintf(pBuf->data + pBuf->length, avail, fmt, args);
+    va_end(args);
+    if (len < 0)
+        return;
+    if ((size_t) len >= avail) {
+        growOutputBuffer(pBuf, len);
+        va_start(args, fmt);
+        vsnprintf(pBuf->data + pBuf->length, len + 1, fmt, args);
+        va_end(args);
+    }
+    pBuf->length += len;
+}
+
+/*
+ * Output a string without formatting it.
+ */
+static void outPuts(const char* str)
+{
+    OutputBuffer* pBuf = currentOutputBuffer();
+
+    if (pBuf == NULL) {
+        fputs(str, stdout);
+        return;
+    }
+
+    size_t len = strlen(str);
+    growOutputBuffer(pBuf, len);
+    memcpy(pBuf->data + pBuf->length, str, len + 1);
+    pBuf->length += len;
+}
+
 /*
  * Converts a single-character primitive type into its human-readable
  * equivalent.
@@ -398,59 +508,59 @@ void dumpFileHeader(const DexFile* pDexFile)
     assert(sizeof(pHeader->magic) == sizeof(pOptHeader->magic));
 
     if (pOptHeader != NULL) {
-        printf("Optimized DEX file header:\n");
+        outPrintf("Optimized DEX file header:\n");
 
         asciify(sanitized, pOptHeader->magic, sizeof(pOptHeader->magic));
-        printf("magic               : '%s'\n", sanitized);
-        printf("dex_offset          : %d (0x%06x)\n",
+        outPrintf("magic               : '%s'\n", sanitized);
+        outPrintf("dex_offset          : %d (0x%06x)\n",
             pOptHeader->dexOffset, pOptHeader->dexOffset);
-        printf("dex_length          : %d\n", pOptHeader->dexLength);
-        printf("deps_offset         : %d (0x%06x)\n",
+        outPrintf("dex_length          : %d\n", pOptHeader->dexLength);
+        outPrintf("deps_offset         : %d (0x%06x)\n",
             pOptHeader->depsOffset, pOptHeader->depsOffset);
-        printf("deps_length         : %d\n", pOptHeader->depsLength);
-        printf("opt_offset          : %d (0x%06x)\n",
+        outPrintf("deps_length         : %d\n", pOptHeader->depsLength);
+        outPrintf("opt_offset          : %d (0x%06x)\n",
             pOptHeader->optOffset, pOptHeader->optOffset);
-        printf("opt_length          : %d\n", pOptHeader->optLength);
-        printf("flags               : %08x\n", pOptHeader->flags);
-        printf("checksum            : %08x\n", pOptHeader->checksum);
-        printf("\n");
+        outPrintf("opt_length          : %d\n", pOptHeader->optLength);
+        outPrintf("flags               : %08x\n", pOptHeader->flags);
+        outPrintf("checksum            : %08x\n", pOptHeader->checksum);
+        outPrintf("\n");
     }
 
-    printf("DEX file header:\n");
+    outPrintf("DEX file header:\n");
     asciify(sanitized, pHeader->magic, sizeof(pHeader->magic));
-    printf("magic               : '%s'\n", sanitized);
-    printf("checksum            : %08x\n", pHeader->checksum);
-    printf("signature           : %02x%02x...%02x%02x\n",
+    outPrintf("magic               : '%s'\n", sanitized);
+    outPrintf("checksum            : %08x\n", pHeader->checksum);
+    outPrintf("signature           : %02x%02x...%02x%02x\n",
         pHeader->signature[0], pHeader->signature[1],
         pHeader->signature[kSHA1DigestLen-2],
         pHeader->signature[kSHA1DigestLen-1]);
-    printf("file_size           : %d\n", pHeader->fileSize);
-    printf("header_size         : %d\n", pHeader->headerSize);
-    printf("link_size           : %d\n", pHeader->linkSize);
-    printf("link_off            : %d (0x%06x)\n",
+    outPrintf("file_size           : %d\n", pHeader->fileSize);
+    outPrintf("header_size         : %d\n", pHeader->headerSize);
+    outPrintf("link_size           : %d\n", pHeader->linkSize);
+    outPrintf("link_off            : %d (0x%06x)\n",
         pHeader->linkOff, pHeader->linkOff);
-    printf("string_ids_size     : %d\n", pHeader->stringIdsSize);
-    printf("string_ids_off      : %d (0x%06x)\n",
+    outPrintf("string_ids_size     : %d\n", pHeader->stringIdsSize);
+    outPrintf("string_ids_off      : %d (0x%06x)\n",
         pHeader->stringIdsOff, pHeader->stringIdsOff);
-    printf("type_ids_size       : %d\n", pHeader->typeIdsSize);
-    printf("type_ids_off        : %d (0x%06x)\n",
+    outPrintf("type_ids_size       : %d\n", pHeader->typeIdsSize);
+    outPrintf("type_ids_off        : %d (0x%06x)\n",
         pHeader->typeIdsOff, pHeader->typeIdsOff);
-    printf("proto_ids_size       : %d\n", pHeader->protoIdsSize);
-    printf("proto_ids_off        : %d (0x%06x)\n",
+    outPrintf("proto_ids_size       : %d\n", pHeader->protoIdsSize);
+    outPrintf("proto_ids_off        : %d (0x%06x)\n",
         pHeader->protoIdsOff, pHeader->protoIdsOff);
-    printf("field_ids_size      : %d\n", pHeader->fieldIdsSize);
-    printf("field_ids_off       : %d (0x%06x)\n",
+    outPrintf("field_ids_size      : %d\n", pHeader->fieldIdsSize);
+    outPrintf("field_ids_off       : %d (0x%06x)\n",
         pHeader->fieldIdsOff, pHeader->fieldIdsOff);
-    printf("method_ids_size     : %d\n", pHeader->methodIdsSize);
-    printf("method_ids_off      : %d (0x%06x)\n",
+    outPrintf("method_ids_size     : %d\n", pHeader->methodIdsSize);
+    outPrintf("method_ids_off      : %d (0x%06x)\n",
         pHeader->methodIdsOff, pHeader->methodIdsOff);
-    printf("class_defs_size     : %d\n", pHeader->classDefsSize);
-    printf("class_defs_off      : %d (0x%06x)\n",
+    outPrintf("class_defs_size     : %d\n", pHeader->classDefsSize);
+    outPrintf("class_defs_off      : %d (0x%06x)\n",
         pHeader->classDefsOff, pHeader->classDefsOff);
-    printf("data_size           : %d\n", pHeader->dataSize);
-    printf("data_off            : %d (0x%06x)\n",
+    outPrintf("data_size           : %d\n", pHeader->dataSize);
+    outPrintf("data_off            : %d (0x%06x)\n",
         pHeader->dataOff, pHeader->dataOff);
-    printf("\n");
+    outPrintf("\n");
 }
 
 /*
@@ -462,12 +572,12 @@ void dumpOptDirectory(const DexFile* pDexFile)
     if (pOptHeader == NULL)
         return;
 
-    printf("OPT section contents:\n");
+    outPrintf("OPT section contents:\n");
 
     const u4* pOpt = (const u4*) ((u1*) pOptHeader + pOptHeader->optOffset);
 
     if (*pOpt == 0) {
-        printf("(1.0 format, only class lookup table is present)\n\n");
+        outPrintf("(1.0 format, only class lookup table is present)\n\n");
         return;
     }
 
@@ -492,14 +602,14 @@ void dumpOptDirectory(const DexFile* pDexFile)
             break;
         }
 
-        printf("Chunk %08x (%c%c%c%c) - %s (%d bytes)\n", *pOpt,
+        outPrintf("Chunk %08x (%c%c%c%c) - %s (%d bytes)\n", *pOpt,
             *pOpt >> 24, (char)(*pOpt >> 16), (char)(*pOpt >> 8), (char)*pOpt,
             verboseStr, size);
 
         size = (size + 8 + 7) & ~7;
         pOpt += size / sizeof(u4);
     }
-    printf("\n");
+    outPrintf("\n");
 }
 
 /*
@@ -520,25 +630,27 @@ void dumpClassDef(DexFile* pDexFile, int idx)
         return;
     }
 
-    printf("Class #%d header:\n", idx);
-    printf("class_idx           : %d\n", pClassDef->classIdx);
-    printf("access_flags        : %d (0x%04x)\n",
+    outPrintf("Class #%d header:\n", idx);
+    outPrintf("class_idx           : %d\n", pClassDef->classIdx);
+    outPrintf("access_flags        : %d (0x%04x)\n",
         pClassDef->accessFlags, pClassDef->accessFlags);
-    printf("superclass_idx      : %d\n", pClassDef->superclassIdx);
-    printf("interfaces_off      : %d (0x%06x)\n",
+    outPrintf("superclass_idx      : %d\n", pClassDef->superclassIdx);
+    outPrintf("interfaces_off      : %d (0x%06x)\n",
         pClassDef->interfacesOff, pClassDef->interfacesOff);
-    printf("source_file_idx     : %d\n", pClassDef->sourceFileIdx);
-    printf("annotations_off     : %d (0x%06x)\n",
+    outPrintf("source_file_idx     : %d\n", pClassDef->sourceFileIdx);
+    outPrintf("annotations_off     : %d (0x%06x)\n",
         pClassDef->annotationsOff, pClassDef->annotationsOff);
-    printf("class_data_off      : %d (0x%06x)\n",
+    outPrintf("class_data_off      : %d (0x%06x)\n",
         pClassDef->classDataOff, pClassDef->classDataOff);
-    printf("static_fields_size  : %d\n", pClassData->header.staticFieldsSize);
-    printf("instance_fields_size: %d\n",
+    outPrintf("static_fields_size  : %d\n",
+            pClassData->header.staticFieldsSize);
+    outPrintf("instance_fields_size: %d\n",
             pClassData->header.instanceFieldsSize);
-    printf("direct_methods_size : %d\n", pClassData->header.directMethodsSize);
-    printf("virtual_methods_size: %d\n",
+    outPrintf("direct_methods_size : %d\n",
+            pClassData->header.directMethodsSize);
+    outPrintf("virtual_methods_size: %d\n",
             pClassData->header.virtualMethodsSize);
-    printf("\n");
+    outPrintf("\n");
 
     free(pClassData);
 }
@@ -553,10 +665,10 @@ void dumpInterface(const DexFile* pDexFile, const DexTypeItem* pTypeItem,
         dexStringByTypeIdx(pDexFile, pTypeItem->typeIdx);
 
     if (gOptions.outputFormat == OUTPUT_PLAIN) {
-        printf("    #%d              : '%s'\n", i, interfaceName);
+        outPrintf("    #%d              : '%s'\n", i, interfaceName);
     } else {
         char* dotted = descriptorToDot(interfaceName);
-        printf("<implements name=\"%s\">\n</implements>\n", dotted);
+        outPrintf("<implements name=\"%s\">\n</implements>\n", dotted);
         free(dotted);
     }
 }
@@ -569,11 +681,11 @@ void dumpCatches(DexFile* pDexFile, const DexCode* pCode)
     u4 triesSize = pCode->triesSize;
 
     if (triesSize == 0) {
-        printf("      catches       : (none)\n");
+        outPrintf("      catches       : (none)\n");
         return;
     }
 
-    printf("      catches       : %d\n", triesSize);
+    outPrintf("      catches       : %d\n", triesSize);
 
     const DexTry* pTries = dexGetTries(pCode);
     u4 i;
@@ -584,7 +696,7 @@ void dumpCatches(DexFile* pDexFile, const DexCode* pCode)
         u4 end = start + pTry->insnCount;
         DexCatchIterator iterator;
 
-        printf("        0x%04x - 0x%04x\n", start, end);
+        outPrintf("        0x%04x - 0x%04x\n", start, end);
 
         dexCatchIteratorInit(&iterator, pCode, pTry->handlerOff);
 
@@ -599,7 +711,7 @@ void dumpCatches(DexFile* pDexFile, const DexCode* pCode)
             descriptor = (handler->typeIdx == kDexNoIndex) ? "<any>" :
                 dexStringByTypeIdx(pDexFile, handler->typeIdx);
 
-            printf("          %s -> 0x%04x\n", descriptor,
+            outPrintf("          %s -> 0x%04x\n", descriptor,
                     handler->address);
         }
     }
@@ -607,7 +719,7 @@ void dumpCatches(DexFile* pDexFile, const DexCode* pCode)
 
 static int dumpPositionsCb(void *cnxt, u4 address, u4 lineNum)
 {
-    printf("        0x%04x line=%d\n", address, lineNum);
+    outPrintf("        0x%04x line=%d\n", address, lineNum);
     return 0;
 }
 
@@ -617,7 +729,7 @@ static int dumpPositionsCb(void *cnxt, u4 address, u4 lineNum)
 void dumpPositions(DexFile* pDexFile, const DexCode* pCode,
         const DexMethod *pDexMethod)
 {
-    printf("      positions     : \n");
+    outPrintf("      positions     : \n");
     const DexMethodId *pMethodId
             = dexGetMethodId(pDexFile, pDexMethod->methodIdx);
     const char *classDescriptor
@@ -631,7 +743,7 @@ static void dumpLocalsCb(void *cnxt, u2 reg, u4 startAddress,
         u4 endAddress, const char *name, const char *descriptor,
         const char *signature)
 {
-    printf("        0x%04x - 0x%04x reg=%d %s %s %s\n",
+    outPrintf("        0x%04x - 0x%04x reg=%d %s %s %s\n",
             startAddress, endAddress, reg, name, descriptor,
             signature);
 }
@@ -642,7 +754,7 @@ static void dumpLocalsCb(void *cnxt, u2 reg, u4 startAddress,
 void dumpLocals(DexFile* pDexFile, const DexCode* pCode,
         const DexMethod *pDexMethod)
 {
-    printf("      locals        : \n");
+    outPrintf("      locals        : \n");
 
     const DexMethodId *pMethodId
             = dexGetMethodId(pDexFile, pDexMethod->methodIdx);
@@ -691,6 +803,111 @@ bool getFieldInfo(DexFile* pDexFile, u4 fieldIdx, FieldMethodInfo* pFieldInfo)
 }
 
 
+/*
+ * Formatted "class.name:signature" strings for method and field refs,
+ * built the first time an index is disassembled.  Slots are filled with a
+ * compare-and-swap so worker threads can share the cache without a lock.
+ */
+struct NameCache {
+    u4 methodCount;
+    char* volatile* methods;
+    u4 fieldCount;
+    char* volatile* fields;
+};
+
+static NameCache gNameCache;
+
+static void createNameCache(const DexFile* pDexFile)
+{
+    gNameCache.methodCount = pDexFile->pHeader->methodIdsSize;
+    gNameCache.methods =
+        (char* volatile*) calloc(gNameCache.methodCount, sizeof(char*));
+    gNameCache.fieldCount = pDexFile->pHeader->fieldIdsSize;
+    gNameCache.fields =
+        (char* volatile*) calloc(gNameCache.fieldCount, sizeof(char*));
+    if (gNameCache.methods == NULL || gNameCache.fields == NULL) {
+        fprintf(stderr, "ERROR: out of memory for name cache\n");
+        exit(1);
+    }
+}
+
+static void freeNameCache()
+{
+    u4 i;
+
+    for (i = 0; i < gNameCache.methodCount; i++)
+        free(gNameCache.methods[i]);
+    for (i = 0; i < gNameCache.fieldCount; i++)
+        free(gNameCache.fields[i]);
+    free((void*) gNameCache.methods);
+    free((void*) gNameCache.fields);
+    memset(&gNameCache, 0, sizeof(gNameCache));
+}
+
+/*
+ * Join the parts of "pInfo" and publish the result in "*pSlot", unless
+ * another thread beat us to it.
+ */
+static const char* publishName(char* volatile* pSlot,
+    const FieldMethodInfo* pInfo)
+{
+    size_t len = strlen(pInfo->classDescriptor) + strlen(pInfo->name) +
+        strlen(pInfo->signature) + 3;
+    char* name = (char*) malloc(len);
+    if (name == NULL)
+        return NULL;
+    snprintf(name, len, "%s.%s:%s",
+        pInfo->classDescriptor, pInfo->name, pInfo->signature);
+
+    if (!__sync_bool_compare_and_swap(pSlot, (char*) NULL, name)) {
+        free(name);
+        name = *pSlot;
+    }
+    return name;
+}
+
+/*
+ * Get the cached "class.name:signature" string for a method, or NULL if
+ * the index is bad.
+ */
+static const char* getMethodName(DexFile* pDexFile, u4 methodIdx)
+{
+    FieldMethodInfo methInfo;
+    const char* name;
+
+    if (methodIdx >= gNameCache.methodCount)
+        return NULL;
+    name = gNameCache.methods[methodIdx];
+    if (name != NULL)
+        return name;
+
+    if (!getMethodInfo(pDexFile, methodIdx, &methInfo))
+        return NULL;
+    name = publishName(&gNameCache.methods[methodIdx], &methInfo);
+    free((void *) methInfo.signature);
+    return name;
+}
+
+/*
+ * Get the cached "class.name:type" string for a field, or NULL if the
+ * index is bad.
+ */
+static const char* getFieldName(DexFile* pDexFile, u4 fieldIdx)
+{
+    FieldMethodInfo fieldInfo;
+    const char* name;
+
+    if (fieldIdx >= gNameCache.fieldCount)
+        return NULL;
+    name = gNameCache.fields[fieldIdx];
+    if (name != NULL)
+        return name;
+
+    if (!getFieldInfo(pDexFile, fieldIdx, &fieldInfo))
+        return NULL;
+    return publishName(&gNameCache.fields[fieldIdx], &fieldInfo);
+}
+
 /*
  * Look up a class' descriptor.
  */
@@ -785,12 +1002,10 @@ static char* indexString(DexFile* pDexFile,
         break;
     case kIndexMethodRef:
         {
-            FieldMethodInfo methInfo;
-            if (getMethodInfo(pDexFile, index, &methInfo)) {
-                outSize = snprintf(buf, bufSize, "%s.%s:%s // method@%0*x",
-                        methInfo.classDescriptor, methInfo.name,
-                        methInfo.signature, width, index);
-                free((void *) methInfo.signature);
+            const char* methodName = getMethodName(pDexFile, index);
+            if (methodName != NULL) {
+                outSize = snprintf(buf, bufSize, "%s // method@%0*x",
+                        methodName, width, index);
             } else {
                 outSize = snprintf(buf, bufSize, "<method?> // method@%0*x",
                         width, index);
@@ -799,11 +1014,10 @@ static char* indexString(DexFile* pDexFile,
         break;
     case kIndexFieldRef:
         {
-            FieldMethodInfo fieldInfo;
-            if (getFieldInfo(pDexFile, index, &fieldInfo)) {
-                outSize = snprintf(buf, bufSize, "%s.%s:%s // field@%0*x",
-                        fieldInfo.classDescriptor, fieldInfo.name,
-                        fieldInfo.signature, width, index);
+            const char* fieldName = getFieldName(pDexFile, index);
+            if (fieldName != NULL) {
+                outSize = snprintf(buf, bufSize, "%s // field@%0*x",
+                        fieldName, width, index);
             } else {
                 outSize = snprintf(buf, bufSize, "<field?> // field@%0*x",
                         width, index);
@@ -854,37 +1068,37 @@ void dumpInstruction(DexFile* pDexFile, const DexCode* pCode, int insnIdx,
     const u2* insns = pCode->insns;
     int i;
 
-    printf("%06x:", ((u1*)insns - pDexFile->baseAddr) + insnIdx*2);
+    outPrintf("%06x:", ((u1*)insns - pDexFile->baseAddr) + insnIdx*2);
     for (i = 0; i < 8; i++) {
         if (i < insnWidth) {
             if (i == 7) {
-                printf(" ... ");
+                outPrintf(" ... ");
             } else {
                 /* print 16-bit value in little-endian order */
                 const u1* bytePtr = (const u1*) &insns[insnIdx+i];
-                printf(" %02x%02x", bytePtr[0], bytePtr[1]);
+                outPrintf(" %02x%02x", bytePtr[0], bytePtr[1]);
             }
         } else {
-            fputs("     ", stdout);
+            outPuts("     ");
         }
     }
 
     if (pDecInsn->opcode == OP_NOP) {
         u2 instr = get2LE((const u1*) &insns[insnIdx]);
         if (instr == kPackedSwitchSignature) {
-            printf("|%04x: packed-switch-data (%d units)",
+            outPrintf("|%04x: packed-switch-data (%d units)",
                 insnIdx, insnWidth);
         } else if (instr == kSparseSwitchSignature) {
-            printf("|%04x: sparse-switch-data (%d units)",
+            outPrintf("|%04x: sparse-switch-data (%d units)",
                 insnIdx, insnWidth);
         } else if (instr == kArrayDataSignature) {
-            printf("|%04x: array-data (%d units)",
+            outPrintf("|%04x: array-data (%d units)",
                 insnIdx, insnWidth);
         } else {
-            printf("|%04x: nop // spacer", insnIdx);
+            outPrintf("|%04x: nop // spacer", insnIdx);
         }
     } else {
-        printf("|%04x: %s", insnIdx, dexGetOpcodeName(pDecInsn->opcode));
+        outPrintf("|%04x: %s", insnIdx, dexGetOpcodeName(pDecInsn->opcode));
     }
 
     if (pDecInsn->indexType != kIndexNone) {
@@ -896,83 +1110,83 @@ void dumpInstruction(DexFile* pDexFile, const DexCode* pCode, int insnIdx,
     case kFmt10x:        // op
         break;
     case kFmt12x:        // op vA, vB
-        printf(" v%d, v%d", pDecInsn->vA, pDecInsn->vB);
+        outPrintf(" v%d, v%d", pDecInsn->vA, pDecInsn->vB);
         break;
     case kFmt11n:        // op vA, #+B
-        printf(" v%d, #int %d // #%x",
+        outPrintf(" v%d, #int %d // #%x",
             pDecInsn->vA, (s4)pDecInsn->vB, (u1)pDecInsn->vB);
         break;
     case kFmt11x:        // op vAA
-        printf(" v%d", pDecInsn->vA);
+        outPrintf(" v%d", pDecInsn->vA);
         break;
     case kFmt10t:        // op +AA
     case kFmt20t:        // op +AAAA
         {
             s4 targ = (s4) pDecInsn->vA;
-            printf(" %04x // %c%04x",
+            outPrintf(" %04x // %c%04x",
                 insnIdx + targ,
                 (targ < 0) ? '-' : '+',
                 (targ < 0) ? -targ : targ);
         }
         break;
     case kFmt22x:        // op vAA, vBBBB
-        printf(" v%d, v%d", pDecInsn->vA, pDecInsn->vB);
+        outPrintf(" v%d, v%d", pDecInsn->vA, pDecInsn->vB);
         break;
     case kFmt21t:        // op vAA, +BBBB
         {
             s4 targ = (s4) pDecInsn->vB;
-            printf(" v%d, %04x // %c%04x", pDecInsn->vA,
+            outPrintf(" v%d, %04x // %c%04x", pDecInsn->vA,
                 insnIdx + targ,
                 (targ < 0) ? '-' : '+',
                 (targ < 0) ? -targ : targ);
         }
         break;
     case kFmt21s:        // op vAA, #+BBBB
-        printf(" v%d, #int %d // #%x",
+        outPrintf(" v%d, #int %d // #%x",
             pDecInsn->vA, (s4)pDecInsn->vB, (u2)pDecInsn->vB);
         break;
     case kFmt21h:        // op vAA, #+BBBB0000[00000000]
         // The printed format varies a bit based on the actual opcode.
         if (pDecInsn->opcode == OP_CONST_HIGH16) {
             s4 value = pDecInsn->vB << 16;
-            printf(" v%d, #int %d // #%x",
+            outPrintf(" v%d, #int %d // #%x",
                 pDecInsn->vA, value, (u2)pDecInsn->vB);
         } else {
             s8 value = ((s8) pDecInsn->vB) << 48;
-            printf(" v%d, #long %lld // #%x",
+            outPrintf(" v%d, #long %lld // #%x",
                 pDecInsn->vA, value, (u2)pDecInsn->vB);
         }
         break;
     case kFmt21c:        // op vAA, thing@BBBB
     case kFmt31c:        // op vAA, thing@BBBBBBBB
-        printf(" v%d, %s", pDecInsn->vA, indexBuf);
+        outPrintf(" v%d, %s", pDecInsn->vA, indexBuf);
         break;
     case kFmt23x:        // op vAA, vBB, vCC
-        printf(" v%d, v%d, v%d", pDecInsn->vA, pDecInsn->vB, pDecInsn->vC);
+        outPrintf(" v%d, v%d, v%d", pDecInsn->vA, pDecInsn->vB, pDecInsn->vC);
         break;
     case kFmt22b:        // op vAA, vBB, #+CC
-        printf(" v%d, v%d, #int %d // #%02x",
+        outPrintf(" v%d, v%d, #int %d // #%02x",
             pDecInsn->vA, pDecInsn->vB, (s4)pDecInsn->vC, (u1)pDecInsn->vC);
         break;
     case kFmt22t:        // op vA, vB, +CCCC
         {
             s4 targ = (s4) pDecInsn->vC;
-            printf(" v%d, v%d, %04x // %c%04x", pDecInsn->vA, pDecInsn->vB,
+            outPrintf(" v%d, v%d, %04x // %c%04x", pDecInsn->vA, pDecInsn->vB,
                 insnIdx + targ,
                 (targ < 0) ? '-' : '+',
                 (targ < 0) ? -targ : targ);
         }
         break;
     case kFmt22s:        // op vA, vB, #+CCCC
-        printf(" v%d, v%d, #int %d // #%04x",
+        outPrintf(" v%d, v%d, #int %d // #%04x",
             pDecInsn->vA, pDecInsn->vB, (s4)pDecInsn->vC, (u2)pDecInsn->vC);
         break;
     case kFmt22c:        // op vA, vB, thing@CCCC
     case kFmt22cs:       // [opt] op vA, vB, field offset CCCC
-        printf(" v%d, v%d, %s", pDecInsn->vA, pDecInsn->vB, indexBuf);
+        outPrintf(" v%d, v%d, %s", pDecInsn->vA, pDecInsn->vB, indexBuf);
         break;
     case kFmt30t:
-        printf(" #%08x", pDecInsn->vA);
+        outPrintf(" #%08x", pDecInsn->vA);
         break;
     case kFmt31i:        // op vAA, #+BBBBBBBB
         {
@@ -982,29 +1196,29 @@ void dumpInstruction(DexFile* pDexFile, const DexCode* pCode, int insnIdx,
                 u4 i;
             } conv;
             conv.i = pDecInsn->vB;
-            printf(" v%d, #float %f // #%08x",
+            outPrintf(" v%d, #float %f // #%08x",
                 pDecInsn->vA, conv.f, pDecInsn->vB);
         }
         break;
     case kFmt31t:       // op vAA, offset +BBBBBBBB
-        printf(" v%d, %08x // +%08x",
+        outPrintf(" v%d, %08x // +%08x",
             pDecInsn->vA, insnIdx + pDecInsn->vB, pDecInsn->vB);
         break;
     case kFmt32x:        // op vAAAA, vBBBB
-        printf(" v%d, v%d", pDecInsn->vA, pDecInsn->vB);
+        outPrintf(" v%d, v%d", pDecInsn->vA, pDecInsn->vB);
         break;
     case kFmt35c:        // op {vC, vD, vE, vF, vG}, thing@BBBB
     case kFmt35ms:       // [opt] invoke-virtual+super
     case kFmt35mi:       // [opt] inline invoke
         {
-            fputs(" {", stdout);
+            outPuts(" {");
             for (i = 0; i < (int) pDecInsn->vA; i++) {
                 if (i == 0)
-                    printf("v%d", pDecInsn->arg[i]);
+                    outPrintf("v%d", pDecInsn->arg[i]);
                 else
-                    printf(", v%d", pDecInsn->arg[i]);
+                    outPrintf(", v%d", pDecInsn->arg[i]);
             }
-            printf("}, %s", indexBuf);
+            outPrintf("}, %s", indexBuf);
         }
         break;
     case kFmt3rc:        // op {vCCCC .. v(CCCC+AA-1)}, thing@BBBB
@@ -1015,14 +1229,14 @@ void dumpInstruction(DexFile* pDexFile, const DexCode* pCode, int insnIdx,
              * This doesn't match the "dx" output when some of the args are
              * 64-bit values -- dx only shows the first register.
              */
-            fputs(" {", stdout);
+            outPuts(" {");
             for (i = 0; i < (int) pDecInsn->vA; i++) {
                 if (i == 0)
-                    printf("v%d", pDecInsn->vC + i);
+                    outPrintf("v%d", pDecInsn->vC + i);
                 else
-                    printf(", v%d", pDecInsn->vC + i);
+                    outPrintf(", v%d", pDecInsn->vC + i);
             }
-            printf("}, %s", indexBuf);
+            outPrintf("}, %s", indexBuf);
         }
         break;
     case kFmt51l:        // op vAA, #+BBBBBBBBBBBBBBBB
@@ -1033,18 +1247,18 @@ void dumpInstruction(DexFile* pDexFile, const DexCode* pCode, int insnIdx,
                 u8 j;
             } conv;
             conv.j = pDecInsn->vB_wide;
-            printf(" v%d, #double %f // #%016llx",
+            outPrintf(" v%d, #double %f // #%016llx",
                 pDecInsn->vA, conv.d, pDecInsn->vB_wide);
         }
         break;
     case kFmt00x:        // unknown op or breakpoint
         break;
     default:
-        printf(" ???");
+        outPrintf(" ???");
         break;
     }
 
-    putchar('\n');
+    outPuts("\n");
 
     if (indexBuf != indexBufChars) {
         free(indexBuf);
@@ -1070,7 +1284,7 @@ void dumpBytecodes(DexFile* pDexFile, const DexMethod* pDexMethod)
     startAddr = ((u1*)pCode - pDexFile->baseAddr);
     className = descriptorToDot(methInfo.classDescriptor);
 
-    printf("%06x:                                        |[%06x] %s.%s:%s\n",
+    outPrintf("%06x:                                        |[%06x] %s.%s:%s\n",
         startAddr, startAddr,
         className, methInfo.name, methInfo.signature);
     free((void *) methInfo.signature);
@@ -1127,10 +1341,10 @@ void dumpCode(DexFile* pDexFile, const DexMethod* pDexMethod)
 {
     const DexCode* pCode = dexGetCode(pDexFile, pDexMethod);
 
-    printf("      registers     : %d\n", pCode->registersSize);
-    printf("      ins           : %d\n", pCode->insSize);
-    printf("      outs          : %d\n", pCode->outsSize);
-    printf("      insns size    : %d 16-bit code units\n", pCode->insnsSize);
+    outPrintf("      registers     : %d\n", pCode->registersSize);
+    outPrintf("      ins           : %d\n", pCode->insSize);
+    outPrintf("      outs          : %d\n", pCode->outsSize);
+    outPrintf("      insns size    : %d 16-bit code units\n", pCode->insnsSize);
 
     if (gOptions.disassemble)
         dumpBytecodes(pDexFile, pDexMethod);
@@ -1168,21 +1382,21 @@ void dumpMethod(DexFile* pDexFile, const DexMethod* pDexMethod, int i)
                     kAccessForMethod);
 
     if (gOptions.outputFormat == OUTPUT_PLAIN) {
-        printf("    #%d              : (in %s)\n", i, backDescriptor);
-        printf("      name          : '%s'\n", name);
-        printf("      type          : '%s'\n", typeDescriptor);
-        printf("      access        : 0x%04x (%s)\n",
+        outPrintf("    #%d              : (in %s)\n", i, backDescriptor);
+        outPrintf("      name          : '%s'\n", name);
+        outPrintf("      type          : '%s'\n", typeDescriptor);
+        outPrintf("      access        : 0x%04x (%s)\n",
             pDexMethod->accessFlags, accessStr);
 
         if (pDexMethod->codeOff == 0) {
-            printf("      code          : (none)\n");
+            outPrintf("      code          : (none)\n");
         } else {
-            printf("      code          -\n");
+            outPrintf("      code          -\n");
             dumpCode(pDexFile, pDexMethod);
         }
 
         if (gOptions.disassemble)
-            putchar('\n');
+            outPuts("\n");
     } else if (gOptions.outputFormat == OUTPUT_XML) {
         bool constructor = (name[0] == '<');
 
@@ -1190,14 +1404,14 @@ void dumpMethod(DexFile* pDexFile, const DexMethod* pDexMethod, int i)
             char* tmp;
 
             tmp = descriptorClassToDot(backDescriptor);
-            printf("<constructor name=\"%s\"\n", tmp);
+            outPrintf("<constructor name=\"%s\"\n", tmp);
             free(tmp);
 
             tmp = descriptorToDot(backDescriptor);
-            printf(" type=\"%s\"\n", tmp);
+            outPrintf(" type=\"%s\"\n", tmp);
             free(tmp);
         } else {
-            printf("<method name=\"%s\"\n", name);
+            outPrintf("<method name=\"%s\"\n", name);
 
             const char* returnType = strrchr(typeDescriptor, ')');
             if (returnType == NULL) {
@@ -1207,29 +1421,29 @@ void dumpMethod(DexFile* pDexFile, const DexMethod* pDexMethod, int i)
             }
 
             char* tmp = descriptorToDot(returnType+1);
-            printf(" return=\"%s\"\n", tmp);
+            outPrintf(" return=\"%s\"\n", tmp);
             free(tmp);
 
-            printf(" abstract=%s\n",
+            outPrintf(" abstract=%s\n",
                 quotedBool((pDexMethod->accessFlags & ACC_ABSTRACT) != 0));
-            printf(" native=%s\n",
+            outPrintf(" native=%s\n",
                 quotedBool((pDexMethod->accessFlags & ACC_NATIVE) != 0));
 
             bool isSync =
                 (pDexMethod->accessFlags & ACC_SYNCHRONIZED) != 0 ||
                 (pDexMethod->accessFlags & ACC_DECLARED_SYNCHRONIZED) != 0;
-            printf(" synchronized=%s\n", quotedBool(isSync));
+            outPrintf(" synchronized=%s\n", quotedBool(isSync));
         }
 
-        printf(" static=%s\n",
+        outPrintf(" static=%s\n",
             quotedBool((pDexMethod->accessFlags & ACC_STATIC) != 0));
-        printf(" final=%s\n",
+        outPrintf(" final=%s\n",
             quotedBool((pDexMethod->accessFlags & ACC_FINAL) != 0));
         // "deprecated=" not knowable w/o parsing annotations
-        printf(" visibility=%s\n",
+        outPrintf(" visibility=%s\n",
             quotedVisibility(pDexMethod->accessFlags));
 
-        printf(">\n");
+        outPrintf(">\n");
 
         /*
          * Parameters.
@@ -1268,15 +1482,15 @@ void dumpMethod(DexFile* pDexFile, const DexMethod* pDexMethod, int i)
             *cp++ = '\0';
 
             char* tmp = descriptorToDot(tmpBuf);
-            printf("<parameter name=\"arg%d\" type=\"%s\">\n</parameter>\n",
+            outPrintf("<parameter name=\"arg%d\" type=\"%s\">\n</parameter>\n",
                 argNum++, tmp);
             free(tmp);
         }
 
         if (constructor)
-            printf("</constructor>\n");
+            outPrintf("</constructor>\n");
         else
-            printf("</method>\n");
+            outPrintf("</method>\n");
     }
 
 bail:
@@ -1309,33 +1523,33 @@ void dumpSField(const DexFile* pDexFile, const DexField* pSField, int i)
     accessStr = createAccessFlagStr(pSField->accessFlags, kAccessForField);
 
     if (gOptions.outputFormat == OUTPUT_PLAIN) {
-        printf("    #%d              : (in %s)\n", i, backDescriptor);
-        printf("      name          : '%s'\n", name);
-        printf("      type          : '%s'\n", typeDescriptor);
-        printf("      access        : 0x%04x (%s)\n",
+        outPrintf("    #%d              : (in %s)\n", i, backDescriptor);
+        outPrintf("      name          : '%s'\n", name);
+        outPrintf("      type          : '%s'\n", typeDescriptor);
+        outPrintf("      access        : 0x%04x (%s)\n",
             pSField->accessFlags, accessStr);
     } else if (gOptions.outputFormat == OUTPUT_XML) {
         char* tmp;
 
-        printf("<field name=\"%s\"\n", name);
+        outPrintf("<field name=\"%s\"\n", name);
 
         tmp = descriptorToDot(typeDescriptor);
-        printf(" type=\"%s\"\n", tmp);
+        outPrintf(" type=\"%s\"\n", tmp);
         free(tmp);
 
-        printf(" transient=%s\n",
+        outPrintf(" transient=%s\n",
             quotedBool((pSField->accessFlags & ACC_TRANSIENT) != 0));
-        printf(" volatile=%s\n",
+        outPrintf(" volatile=%s\n",
             quotedBool((pSField->accessFlags & ACC_VOLATILE) != 0));
         // "value=" not knowable w/o parsing annotations
-        printf(" static=%s\n",
+        outPrintf(" static=%s\n",
             quotedBool((pSField->accessFlags & ACC_STATIC) != 0));
-        printf(" final=%s\n",
+        outPrintf(" final=%s\n",
             quotedBool((pSField->accessFlags & ACC_FINAL) != 0));
         // "deprecated=" not knowable w/o parsing annotations
-        printf(" visibility=%s\n",
+        outPrintf(" visibility=%s\n",
             quotedVisibility(pSField->accessFlags));
-        printf(">\n</field>\n");
+        outPrintf(">\n</field>\n");
     }
 
     free(accessStr);
@@ -1381,7 +1595,7 @@ void dumpClass(DexFile* pDexFile, int idx, char** pLastPackage)
     pClassData = dexReadAndVerifyClassData(&pEncodedData, NULL);
 
     if (pClassData == NULL) {
-        printf("Trouble reading class data (#%d)\n", idx);
+        outPrintf("Trouble reading class data (#%d)\n", idx);
         goto bail;
     }
 
@@ -1423,8 +1637,8 @@ void dumpClass(DexFile* pDexFile, int idx, char** pLastPackage)
         if (*pLastPackage == NULL || strcmp(mangle, *pLastPackage) != 0) {
             /* start of a new package */
             if (*pLastPackage != NULL)
-                printf("</package>\n");
-            printf("<package name=\"%s\"\n>\n", mangle);
+                outPrintf("</package>\n");
+            outPrintf("<package name=\"%s\"\n>\n", mangle);
             free(*pLastPackage);
             *pLastPackage = mangle;
         } else {
@@ -1442,37 +1656,37 @@ void dumpClass(DexFile* pDexFile, int idx, char** pLastPackage)
     }
 
     if (gOptions.outputFormat == OUTPUT_PLAIN) {
-        printf("Class #%d            -\n", idx);
-        printf("  Class descriptor  : '%s'\n", classDescriptor);
-        printf("  Access flags      : 0x%04x (%s)\n",
+        outPrintf("Class #%d            -\n", idx);
+        outPrintf("  Class descriptor  : '%s'\n", classDescriptor);
+        outPrintf("  Access flags      : 0x%04x (%s)\n",
             pClassDef->accessFlags, accessStr);
 
         if (superclassDescriptor != NULL)
-            printf("  Superclass        : '%s'\n", superclassDescriptor);
+            outPrintf("  Superclass        : '%s'\n", superclassDescriptor);
 
-        printf("  Interfaces        -\n");
+        outPrintf("  Interfaces        -\n");
     } else {
         char* tmp;
 
         tmp = descriptorClassToDot(classDescriptor);
-        printf("<class name=\"%s\"\n", tmp);
+        outPrintf("<class name=\"%s\"\n", tmp);
         free(tmp);
 
         if (superclassDescriptor != NULL) {
             tmp = descriptorToDot(superclassDescriptor);
-            printf(" extends=\"%s\"\n", tmp);
+            outPrintf(" extends=\"%s\"\n", tmp);
             free(tmp);
         }
-        printf(" abstract=%s\n",
+        outPrintf(" abstract=%s\n",
             quotedBool((pClassDef->accessFlags & ACC_ABSTRACT) != 0));
-        printf(" static=%s\n",
+        outPrintf(" static=%s\n",
             quotedBool((pClassDef->accessFlags & ACC_STATIC) != 0));
-        printf(" final=%s\n",
+        outPrintf(" final=%s\n",
             quotedBool((pClassDef->accessFlags & ACC_FINAL) != 0));
         // "deprecated=" not knowable w/o parsing annotations
-        printf(" visibility=%s\n",
+        outPrintf(" visibility=%s\n",
             quotedVisibility(pClassDef->accessFlags));
-        printf(">\n");
+        outPrintf(">\n");
     }
     pInterfaces = dexGetInterfacesList(pDexFile, pClassDef);
     if (pInterfaces != NULL) {
@@ -1481,25 +1695,25 @@ void dumpClass(DexFile* pDexFile, int idx, char** pLastPackage)
     }
 
     if (gOptions.outputFormat == OUTPUT_PLAIN)
-        printf("  Static fields     -\n");
+        outPrintf("  Static fields     -\n");
     for (i = 0; i < (int) pClassData->header.staticFieldsSize; i++) {
         dumpSField(pDexFile, &pClassData->staticFields[i], i);
     }
 
     if (gOptions.outputFormat == OUTPUT_PLAIN)
-        printf("  Instance fields   -\n");
+        outPrintf("  Instance fields   -\n");
     for (i = 0; i < (int) pClassData->header.instanceFieldsSize; i++) {
         dumpIField(pDexFile, &pClassData->instanceFields[i], i);
     }
 
     if (gOptions.outputFormat == OUTPUT_PLAIN)
-        printf("  Direct methods    -\n");
+        outPrintf("  Direct methods    -\n");
     for (i = 0; i < (int) pClassData->header.directMethodsSize; i++) {
         dumpMethod(pDexFile, &pClassData->directMethods[i], i);
     }
 
     if (gOptions.outputFormat == OUTPUT_PLAIN)
-        printf("  Virtual methods   -\n");
+        outPrintf("  Virtual methods   -\n");
     for (i = 0; i < (int) pClassData->header.virtualMethodsSize; i++) {
         dumpMethod(pDexFile, &pClassData->virtualMethods[i], i);
     }
@@ -1512,13 +1726,13 @@ void dumpClass(DexFile* pDexFile, int idx, char** pLastPackage)
         fileName = "unknown";
 
     if (gOptions.outputFormat == OUTPUT_PLAIN) {
-        printf("  source_file_idx   : %d (%s)\n",
+        outPrintf("  source_file_idx   : %d (%s)\n",
             pClassDef->sourceFileIdx, fileName);
-        printf("\n");
+        outPrintf("\n");
     }
 
     if (gOptions.outputFormat == OUTPUT_XML) {
-        printf("</class>\n");
+        outPrintf("</class>\n");
     }
 
 bail:
@@ -1564,7 +1778,7 @@ void dumpDifferentialCompressedMap(const u1** pData)
     int origLen = 4 + (addrWidth + regWidth) * numEntries;
     int compLen = (data - dataStart) + compressedLen;
 
-    printf("        (differential compression %d -> %d [%d -> %d])\n",
+    outPrintf("        (differential compression %d -> %d [%d -> %d])\n",
         origLen, compLen,
         (addrWidth + regWidth) * numEntries, compressedLen);
 
@@ -1590,7 +1804,7 @@ void dumpMethodMap(DexFile* pDexFile, const DexMethod* pDexMethod, int idx,
 
     pMethodId = dexGetMethodId(pDexFile, pDexMethod->methodIdx);
     name = dexStringById(pDexFile, pMethodId->nameIdx);
-    printf("      #%d: 0x%08x %s\n", idx, offset, name);
+    outPrintf("      #%d: 0x%08x %s\n", idx, offset, name);
 
     u1 format;
     int addrWidth;
@@ -1598,7 +1812,7 @@ void dumpMethodMap(DexFile* pDexFile, const DexMethod* pDexMethod, int idx,
     format = *data++;
     if (format == 1) {              /* kRegMapFormatNone */
         /* no map */
-        printf("        (no map)\n");
+        outPrintf("        (no map)\n");
         addrWidth = 0;
     } else if (format == 2) {       /* kRegMapFormatCompact8 */
         addrWidth = 1;
@@ -1608,7 +1822,7 @@ void dumpMethodMap(DexFile* pDexFile, const DexMethod* pDexMethod, int idx,
         dumpDifferentialCompressedMap(&data);
         goto bail;
     } else {
-        printf("        (unknown format %d!)\n", format);
+        outPrintf("        (unknown format %d!)\n", format);
         /* don't know how to skip data; failure will cascade to end of class */
         goto bail;
     }
@@ -1627,11 +1841,11 @@ void dumpMethodMap(DexFile* pDexFile, const DexMethod* pDexMethod, int idx,
             if (addrWidth > 1)
                 addr |= (*data++) << 8;
 
-            printf("        %4x:", addr);
+            outPrintf("        %4x:", addr);
             for (byte = 0; byte < regWidth; byte++) {
-                printf(" %02x", *data++);
+                outPrintf(" %02x", *data++);
             }
-            printf("\n");
+            outPrintf("\n");
         }
     }
 
@@ -1659,7 +1873,7 @@ void dumpRegisterMaps(DexFile* pDexFile)
     int idx;
 
     if (pClassPool == NULL) {
-        printf("No register maps found\n");
+        outPrintf("No register maps found\n");
         return;
     }
 
@@ -1668,8 +1882,8 @@ void dumpRegisterMaps(DexFile* pDexFile)
     ptr += sizeof(u4);
     classOffsets = (const u4*) ptr;
 
-    printf("RMAP begins at offset 0x%07x\n", baseFileOffset);
-    printf("Maps for %d classes\n", numClasses);
+    outPrintf("RMAP begins at offset 0x%07x\n", baseFileOffset);
+    outPrintf("Maps for %d classes\n", numClasses);
     for (idx = 0; idx < (int) numClasses; idx++) {
         const DexClassDef* pClassDef;
         const char* classDescriptor;
@@ -1677,7 +1891,7 @@ void dumpRegisterMaps(DexFile* pDexFile)
         pClassDef = dexGetClassDef(pDexFile, idx);
         classDescriptor = dexStringByTypeIdx(pDexFile, pClassDef->classIdx);
 
-        printf("%4d: +%d (0x%08x) %s\n", idx, classOffsets[idx],
+        outPrintf("%4d: +%d (0x%08x) %s\n", idx, classOffsets[idx],
             baseFileOffset + classOffsets[idx], classDescriptor);
 
         if (classOffsets[idx] == 0)
@@ -1706,19 +1920,19 @@ void dumpRegisterMaps(DexFile* pDexFile)
         if (methodCount != pClassData->header.directMethodsSize
                             + pClassData->header.virtualMethodsSize)
         {
-            printf("NOTE: method count discrepancy (%d != %d + %d)\n",
+            outPrintf("NOTE: method count discrepancy (%d != %d + %d)\n",
                 methodCount, pClassData->header.directMethodsSize,
                 pClassData->header.virtualMethodsSize);
             /* this is bad, but keep going anyway */
         }
 
-        printf("    direct methods: %d\n",
+        outPrintf("    direct methods: %d\n",
             pClassData->header.directMethodsSize);
         for (i = 0; i < (int) pClassData->header.directMethodsSize; i++) {
             dumpMethodMap(pDexFile, &pClassData->directMethods[i], i, &data);
         }
 
-        printf("    virtual methods: %d\n",
+        outPrintf("    virtual methods: %d\n",
             pClassData->header.virtualMethodsSize);
         for (i = 0; i < (int) pClassData->header.virtualMethodsSize; i++) {
             dumpMethodMap(pDexFile, &pClassData->virtualMethods[i], i, &data);
@@ -1728,6 +1942,171 @@ void dumpRegisterMaps(DexFile* pDexFile)
     }
 }
 
+#ifdef HAVE_PTHREADS
+/*
+ * How far ahead of the output the workers may get, in classes.  This
+ * bounds the amount of buffered text.
+ */
+static const int kParallelDumpWindow = 256;
+
+/*
+ * State shared by the threads in dumpClassesParallel().  Everything after
+ * "lock" is guarded by it.
+ */
+struct ParallelDumpState {
+    DexFile* pDexFile;
+    int count;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;        /* signaled when the output advances */
+    int nextIdx;                /* next class to hand out */
+    int nextFlush;              /* next class to write to stdout */
+    bool flushing;              /* somebody is writing to stdout */
+    OutputBuffer* results;      /* per-class output, valid when ready */
+    bool* ready;
+};
+
+/*
+ * Dump classes until there are none left.  Each class is rendered into
+ * this thread's buffer, which is then handed over to the shared table;
+ * whichever thread finishes the class at the head of the queue writes out
+ * everything that's ready, in class order.
+ */
+static void* parallelDumpWorker(void* arg)
+{
+    ParallelDumpState* pState = (ParallelDumpState*) arg;
+    OutputBuffer buf;
+
+    memset(&buf, 0, sizeof(buf));
+    pthread_setspecific(gOutputBufferKey, &buf);
+
+    pthread_mutex_lock(&pState->lock);
+    while (true) {
+        while (pState->nextIdx < pState->count &&
+               pState->nextIdx >= pState->nextFlush + kParallelDumpWindow)
+        {
+            pthread_cond_wait(&pState->cond, &pState->lock);
+        }
+        if (pState->nextIdx >= pState->count)
+            break;
+        int idx = pState->nextIdx++;
+        pthread_mutex_unlock(&pState->lock);
+
+        if (gOptions.showSectionHeaders)
+            dumpClassDef(pState->pDexFile, idx);
+        dumpClass(pState->pDexFile, idx, NULL);
+
+        pthread_mutex_lock(&pState->lock);
+        pState->results[idx] = buf;
+        pState->ready[idx] = true;
+        memset(&buf, 0, sizeof(buf));
+
+        if (!pState->flushing) {
+            pState->flushing = true;
+            while (pState->nextFlush < pState->count &&
+                   pState->ready[pState->nextFlush])
+            {
+                OutputBuffer out = pState->results[pState->nextFlush];
+
+                pthread_mutex_unlock(&pState->lock);
+                if (out.length > 0)
+                    fwrite(out.data, 1, out.length, stdout);
+                free(out.data);
+                pthread_mutex_lock(&pState->lock);
+
+                pState->nextFlush++;
+                pthread_cond_broadcast(&pState->cond);
+            }
+            pState->flushing = false;
+        }
+    }
+    pthread_mutex_unlock(&pState->lock);
+
+    pthread_setspecific(gOutputBufferKey, NULL);
+    return NULL;
+}
+
+/*
+ * Dump all classes using "numThreads" threads, including this one.  The
+ * output is identical to the serial loop in processDexFile().
+ */
+static void dumpClassesParallel(DexFile* pDexFile, int numThreads)
+{
+    ParallelDumpState state;
+    pthread_t* threads;
+    int started = 0;
+    int i;
+
+    if (!gOutputBufferKeyCreated) {
+        if (pthread_key_create(&gOutputBufferKey, NULL) != 0) {
+            fprintf(stderr, "ERROR: pthread_key_create failed\n");
+            exit(1);
+        }
+        gOutputBufferKeyCreated = true;
+    }
+
+    memset(&state, 0, sizeof(state));
+    state.pDexFile = pDexFile;
+    state.count = pDexFile->pHeader->classDefsSize;
+    state.results =
+        (OutputBuffer*) calloc(state.count, sizeof(OutputBuffer));
+    state.ready = (bool*) calloc(state.count, sizeof(bool));
+    threads = (pthread_t*) malloc((numThreads - 1) * sizeof(pthread_t));
+    if (state.results == NULL || state.ready == NULL || threads == NULL) {
+        fprintf(stderr, "ERROR: out of memory for parallel dump\n");
+        exit(1);
+    }
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_cond_init(&state.cond, NULL);
+
+    /* anything already printed must come out before the workers' output */
+    fflush(stdout);
+
+    for (i = 1; i < numThreads; i++) {
+        if (pthread_create(&threads[started], NULL, parallelDumpWorker,
+                &state) != 0)
+        {
+            fprintf(stderr, "WARNING: pthread_create failed\n");
+            break;
+        }
+        started++;
+    }
+    parallelDumpWorker(&state);
+    for (i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+
+    assert(state.nextFlush == state.count);
+
+    pthread_cond_destroy(&state.cond);
+    pthread_mutex_destroy(&state.lock);
+    free(threads);
+    free(state.ready);
+    free(state.results);
+}
+#endif
+
+/*
+ * Write the binary method index of the file to gOptions.indexFileName.
+ */
+void writeIndexFile(DexFile* pDexFile)
+{
+    int fd = open(gOptions.indexFileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: unable to create '%s': %s\n",
+            gOptions.indexFileName, strerror(errno));
+        return;
+    }
+
+    bool ok = dexIndexWriteBinary(pDexFile, fd);
+    if (close(fd) != 0)
+        ok = false;
+    if (!ok) {
+        fprintf(stderr, "ERROR: failed writing '%s'\n",
+            gOptions.indexFileName);
+        unlink(gOptions.indexFileName);
+    }
+}
+
 /*
  * Dump the requested sections of the file.
  */
@@ -1737,7 +2116,7 @@ void processDexFile(const char* fileName, DexFile* pDexFile)
     int i;
 
     if (gOptions.verbose) {
-        printf("Opened '%s', DEX version '%.3s'\n", fileName,
+        outPrintf("Opened '%s', DEX version '%.3s'\n", fileName,
             pDexFile->pHeader->magic +4);
     }
 
@@ -1746,29 +2125,57 @@ void processDexFile(const char* fileName, DexFile* pDexFile)
         return;
     }
 
+    if (gOptions.indexFileName != NULL) {
+        writeIndexFile(pDexFile);
+        return;
+    }
+
+    if (gOptions.outputFormat == OUTPUT_JSON) {
+        if (!dexIndexWriteJson(pDexFile, stdout))
+            fprintf(stderr, "ERROR: failed writing method index\n");
+        return;
+    }
+
     if (gOptions.showFileHeaders) {
         dumpFileHeader(pDexFile);
         dumpOptDirectory(pDexFile);
     }
 
     if (gOptions.outputFormat == OUTPUT_XML)
-        printf("<api>\n");
+        outPrintf("<api>\n");
 
-    for (i = 0; i < (int) pDexFile->pHeader->classDefsSize; i++) {
-        if (gOptions.showSectionHeaders)
-            dumpClassDef(pDexFile, i);
+    createNameCache(pDexFile);
+
+#ifdef HAVE_PTHREADS
+    /*
+     * The XML layout carries the current package from one class to the
+     * next, so only the plain layout can be split up.
+     */
+    if (gOptions.numThreads > 1 && gOptions.outputFormat == OUTPUT_PLAIN &&
+        pDexFile->pHeader->classDefsSize > 1)
+    {
+        dumpClassesParallel(pDexFile, gOptions.numThreads);
+    } else
+#endif
+    {
+        for (i = 0; i < (int) pDexFile->pHeader->classDefsSize; i++) {
+            if (gOptions.showSectionHeaders)
+                dumpClassDef(pDexFile, i);
 
-        dumpClass(pDexFile, i, &package);
+            dumpClass(pDexFile, i, &package);
+        }
     }
 
+    freeNameCache();
+
     /* free the last one allocated */
     if (package != NULL) {
-        printf("</package>\n");
+        outPrintf("</package>\n");
         free(package);
     }
 
     if (gOptions.outputFormat == OUTPUT_XML)
-        printf("</api>\n");
+        outPrintf("</api>\n");
 }
 
 
@@ -1783,7 +2190,7 @@ int process(const char* fileName)
     int result = -1;
 
     if (gOptions.verbose)
-        printf("Processing '%s'...\n", fileName);
+        outPrintf("Processing '%s'...\n", fileName);
 
     if (dexOpenAndMap(fileName, gOptions.tempFileName, &map, false) != 0) {
         return result;
@@ -1801,7 +2208,7 @@ int process(const char* fileName)
     }
 
     if (gOptions.checksumOnly) {
-        printf("Checksum verified\n");
+        outPrintf("Checksum verified\n");
     } else {
         processDexFile(fileName, pDexFile);
     }
@@ -1824,7 +2231,8 @@ void usage(void)
 {
     fprintf(stderr, "Copyright (C) 2007 The Android Open Source Project\n\n");
     fprintf(stderr,
-        "%s: [-c] [-d] [-f] [-h] [-i] [-l layout] [-m] [-t tempfile] dexfile...\n",
+        "%s: [-c] [-d] [-f] [-h] [-i] [-j threads] [-l layout] [-m] "
+        "[-t tempfile] [-x indexfile] dexfile...\n",
         gProgName);
     fprintf(stderr, "\n");
     fprintf(stderr, " -c : verify checksum and exit\n");
@@ -1832,9 +2240,14 @@ void usage(void)
     fprintf(stderr, " -f : display summary information from file header\n");
     fprintf(stderr, " -h : display file header details\n");
     fprintf(stderr, " -i : ignore checksum failures\n");
-    fprintf(stderr, " -l : output layout, either 'plain' or 'xml'\n");
+    fprintf(stderr, " -j : dump classes using this many threads "
+        "(plain layout only)\n");
+    fprintf(stderr, " -l : output layout, either 'plain', 'xml', or 'json' "
+        "(method index)\n");
     fprintf(stderr, " -m : dump register maps (and nothing else)\n");
     fprintf(stderr, " -t : temp file name (defaults to /sdcard/dex-temp-*)\n");
+    fprintf(stderr, " -x : write binary method index to file "
+        "(and nothing else)\n");
 }
 
 /*
@@ -1851,7 +2264,7 @@ int main(int argc, char* const argv[])
     gOptions.verbose = true;
 
     while (1) {
-        ic = getopt(argc, argv, "cdfhil:mt:");
+        ic = getopt(argc, argv, "cdfhij:l:mt:x:");
         if (ic < 0)
             break;
 
@@ -1871,6 +2284,11 @@ int main(int argc, char* const argv[])
         case 'i':       // continue even if checksum is bad
             gOptions.ignoreBadChecksum = true;
             break;
+        case 'j':       // worker thread count
+            gOptions.numThreads = atoi(optarg);
+            if (gOptions.numThreads < 1)
+                wantUsage = true;
+            break;
         case 'l':       // layout
             if (strcmp(optarg, "plain") == 0) {
                 gOptions.outputFormat = OUTPUT_PLAIN;
@@ -1878,6 +2296,9 @@ int main(int argc, char* const argv[])
                 gOptions.outputFormat = OUTPUT_XML;
                 gOptions.verbose = false;
                 gOptions.exportsOnly = true;
+            } else if (strcmp(optarg, "json") == 0) {
+                gOptions.outputFormat = OUTPUT_JSON;
+                gOptions.verbose = false;
             } else {
                 wantUsage = true;
             }
@@ -1888,6 +2309,10 @@ int main(int argc, char* const argv[])
         case 't':       // temp file, used when opening compressed Jar
             gOptions.tempFileName = optarg;
             break;
+        case 'x':       // binary method index file
+            gOptions.indexFileName = optarg;
+            gOptions.verbose = false;
+            break;
         default:
             wantUsage = true;
             break;
@@ -1899,6 +2324,11 @@ int main(int argc, char* const argv[])
         wantUsage = true;
     }
 
+    if (gOptions.indexFileName != NULL && argc - optind > 1) {
+        fprintf(stderr, "Can't write an index for more than one file\n");
+        wantUsage = true;
+    }
+
     if (gOptions.checksumOnly && gOptions.ignoreBadChecksum) {
         fprintf(stderr, "Can't specify both -c and -i\n");
         wantUsage = true;
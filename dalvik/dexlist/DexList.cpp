@@ -23,6 +23,7 @@
 #include "libdex/CmdUtils.h"
 #include "libdex/DexClass.h"
 #include "libdex/DexDebugInfo.h"
+#include "libdex/DexIndex.h"
 #include "libdex/DexProto.h"
 #include "libdex/SysUtil.h"
 
@@ -43,6 +44,8 @@ static struct {
     char*       argCopy;
     const char* classToFind;
     const char* methodToFind;
+    bool        json;
+    const char* indexFileName;
 } gParms;
 
 
@@ -192,6 +195,31 @@ void dumpClass(DexFile* pDexFile, int idx)
     free(pClassData);
 }
 
+/*
+ * Write the binary method index to gParms.indexFileName.
+ *
+ * Returns 0 on success.
+ */
+int writeIndexFile(DexFile* pDexFile)
+{
+    int fd = open(gParms.indexFileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Unable to create '%s': %s\n",
+            gParms.indexFileName, strerror(errno));
+        return -1;
+    }
+
+    bool ok = dexIndexWriteBinary(pDexFile, fd);
+    if (close(fd) != 0)
+        ok = false;
+    if (!ok) {
+        fprintf(stderr, "Failed writing '%s'\n", gParms.indexFileName);
+        unlink(gParms.indexFileName);
+        return -1;
+    }
+    return 0;
+}
+
 /*
  * Process a file.
  *
@@ -223,6 +251,21 @@ int process(const char* fileName)
         goto bail;
     }
 
+    if (gParms.indexFileName != NULL) {
+        result = writeIndexFile(pDexFile);
+        goto bail;
+    }
+
+    if (gParms.json) {
+        if (!dexIndexWriteJson(pDexFile, stdout)) {
+            fprintf(stderr, "Failed writing method index for '%s'\n",
+                fileName);
+            goto bail;
+        }
+        result = 0;
+        goto bail;
+    }
+
     printf("#%s\n", fileName);
 
     int i;
@@ -248,7 +291,14 @@ void usage(void)
 {
     fprintf(stderr, "Copyright (C) 2007 The Android Open Source Project\n\n");
     fprintf(stderr, "%s: dexfile [dexfile2 ...]\n", gProgName);
+    fprintf(stderr, "%s: --method package.Class.method dexfile ...\n",
+        gProgName);
+    fprintf(stderr, "%s: --json dexfile [dexfile2 ...]\n", gProgName);
+    fprintf(stderr, "%s: --index indexfile dexfile\n", gProgName);
     fprintf(stderr, "\n");
+    fprintf(stderr, " --json  : list every method as a JSON object, "
+        "one per line\n");
+    fprintf(stderr, " --index : write a binary method index to indexfile\n");
 }
 
 /*
@@ -278,6 +328,26 @@ int main(int argc, char* const argv[])
         argc -= 2;
     }
 
+    /*
+     * Emit the machine-readable method index instead of the usual
+     * listing.
+     */
+    if (argc > 1 && strcmp(argv[1], "--json") == 0) {
+        gParms.json = true;
+        argv++;
+        argc--;
+    } else if (argc > 2 && strcmp(argv[1], "--index") == 0) {
+        gParms.indexFileName = argv[2];
+        argv += 2;
+        argc -= 2;
+        if (argc > 2) {
+            fprintf(stderr, "%s: --index takes a single dexfile\n",
+                gProgName);
+            usage();
+            return 2;
+        }
+    }
+
     if (argc < 2) {
         fprintf(stderr, "%s: no file specified\n", gProgName);
         usage();
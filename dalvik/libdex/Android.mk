@@ -21,6 +21,7 @@ dex_src_files := \
 	DexDataMap.cpp \
 	DexDebugInfo.cpp \
 	DexFile.cpp \
+	DexIndex.cpp \
 	DexInlines.cpp \
 	DexOptData.cpp \
 	DexOpcodes.cpp \
@@ -21,24 +21,77 @@
 #include "DexDataMap.h"
 #include <safe_iop.h>
 #include <stdlib.h>
+#include <string.h>
+
+/* marks an unused slot in the hash table; never a valid file offset */
+#define kNoOffset 0xffffffff
+
+/*
+ * Map item types are either 0x000n (id sections) or 0x100n / 0x200n (data
+ * sections) with n < 16, so they pack into a nonzero byte for the dense
+ * index, leaving 0 to mean "no entry".
+ */
+static inline u1 typeToCode(u2 type) {
+    return (u1) ((((type >> 12) << 4) | (type & 0x0f)) + 1);
+}
+
+static inline u2 codeToType(u1 code) {
+    code--;
+    return (u2) (((code >> 4) << 12) | (code & 0x0f));
+}
+
+/*
+ * Spread offsets (which are densely clustered) across the hash table;
+ * this is the murmur3 32-bit finalizer.
+ */
+static inline u4 hashOffset(u4 offset) {
+    u4 h = offset;
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
 
 /*
  * Allocate and initialize a DexDataMap. Returns NULL on failure.
  */
-DexDataMap* dexDataMapAlloc(u4 maxCount) {
+DexDataMap* dexDataMapAlloc(u4 maxCount, u4 fileLen) {
     /*
      * Allocate a single chunk for the DexDataMap per se as well as the
-     * two arrays.
+     * index it uses.
      */
     size_t size = 0;
     DexDataMap* map = NULL;
+    bool dense = (fileLen <= kDexDataMapDenseMaxFileSize);
+    u4 slots = 0;
 
-    /*
-     * Avoiding pulling in safe_iop for safe_iopf.
-     */
-    if (!safe_mul(&size, maxCount, sizeof(u4) + sizeof(u2)) ||
-        !safe_add(&size, size, sizeof(DexDataMap))) {
-      return NULL;
+    if (dense) {
+        size = fileLen;
+    } else {
+        /*
+         * Keep the load factor at or below one half so probe sequences
+         * stay short.
+         */
+        slots = 16;
+        while ((u8) slots < (u8) maxCount * 2) {
+            if (slots >= 0x40000000) {
+                return NULL;
+            }
+            slots <<= 1;
+        }
+
+        /*
+         * Avoiding pulling in safe_iop for safe_iopf.
+         */
+        if (!safe_mul(&size, slots, sizeof(u4) + sizeof(u2))) {
+            return NULL;
+        }
+    }
+
+    if (!safe_add(&size, size, sizeof(DexDataMap))) {
+        return NULL;
     }
 
     map = (DexDataMap*) malloc(size);
@@ -49,8 +102,24 @@ DexDataMap* dexDataMapAlloc(u4 maxCount) {
 
     map->count = 0;
     map->max = maxCount;
-    map->offsets = (u4*) (map + 1);
-    map->types = (u2*) (map->offsets + maxCount);
+    map->lastOffset = 0;
+    map->fileLen = fileLen;
+
+    if (dense) {
+        map->denseCodes = (u1*) (map + 1);
+        map->denseSize = fileLen;
+        map->hashMask = 0;
+        map->hashOffsets = NULL;
+        map->hashTypes = NULL;
+        memset(map->denseCodes, 0, fileLen);
+    } else {
+        map->denseCodes = NULL;
+        map->denseSize = 0;
+        map->hashMask = slots - 1;
+        map->hashOffsets = (u4*) (map + 1);
+        map->hashTypes = (u2*) (map->hashOffsets + slots);
+        memset(map->hashOffsets, 0xff, slots * sizeof(u4));
+    }
 
     return map;
 }
@@ -69,22 +138,47 @@ void dexDataMapFree(DexDataMap* map) {
 
 /*
  * Add a new element to the map. The offset must be greater than the
- * all previously added offsets.
+ * all previously added offsets and lie within the file.
  */
-void dexDataMapAdd(DexDataMap* map, u4 offset, u2 type) {
+bool dexDataMapAdd(DexDataMap* map, u4 offset, u2 type) {
     assert(map != NULL);
     assert(map->count < map->max);
+    assert(codeToType(typeToCode(type)) == type);
 
-    if ((map->count != 0) &&
-            (map->offsets[map->count - 1] >= offset)) {
+    if ((map->count != 0) && (map->lastOffset >= offset)) {
         ALOGE("Out-of-order data map offset: %#x then %#x",
-                map->offsets[map->count - 1], offset);
-        return;
+                map->lastOffset, offset);
+        return false;
     }
 
-    map->offsets[map->count] = offset;
-    map->types[map->count] = type;
+    if (offset >= map->fileLen) {
+        /*
+         * Items are bounds-checked against the file before they are
+         * added, so this can only happen if the caller lied about the
+         * file length. Dropping the entry would make later
+         * cross-references to it fail with a misleading error, so refuse
+         * outright.
+         */
+        ALOGE("Data map offset out of range: %#x (length %#x)",
+                offset, map->fileLen);
+        return false;
+    }
+
+    if (map->denseCodes != NULL) {
+        map->denseCodes[offset] = typeToCode(type);
+    } else {
+        /* offsets are unique (strictly increasing), so no update case */
+        u4 idx = hashOffset(offset) & map->hashMask;
+        while (map->hashOffsets[idx] != kNoOffset) {
+            idx = (idx + 1) & map->hashMask;
+        }
+        map->hashOffsets[idx] = offset;
+        map->hashTypes[idx] = type;
+    }
+
+    map->lastOffset = offset;
     map->count++;
+    return true;
 }
 
 /*
@@ -94,27 +188,33 @@ void dexDataMapAdd(DexDataMap* map, u4 offset, u2 type) {
 int dexDataMapGet(DexDataMap* map, u4 offset) {
     assert(map != NULL);
 
-    // Note: Signed type is important for max and min.
-    int min = 0;
-    int max = map->count - 1;
-    u4* offsets = map->offsets;
+    if (map->denseCodes != NULL) {
+        if (offset >= map->denseSize) {
+            return -1;
+        }
+
+        u1 code = map->denseCodes[offset];
+        return (code == 0) ? -1 : codeToType(code);
+    }
+
+    if (offset == kNoOffset) {
+        return -1;
+    }
 
-    while (max >= min) {
-        int guessIdx = (min + max) >> 1;
-        u4 guess = offsets[guessIdx];
+    u4 idx = hashOffset(offset) & map->hashMask;
+    for (;;) {
+        u4 probe = map->hashOffsets[idx];
 
-        if (offset < guess) {
-            max = guessIdx - 1;
-        } else if (offset > guess) {
-            min = guessIdx + 1;
-        } else {
+        if (probe == offset) {
             // We have a winner!
-            return map->types[guessIdx];
+            return map->hashTypes[idx];
+        } else if (probe == kNoOffset) {
+            // No match.
+            return -1;
         }
-    }
 
-    // No match.
-    return -1;
+        idx = (idx + 1) & map->hashMask;
+    }
 }
 
 /*
@@ -23,17 +23,36 @@
 
 #include "DexFile.h"
 
+/*
+ * Files no larger than this many bytes get a dense index: one byte per
+ * file offset holding a compact type code, so a lookup is a single load.
+ * Larger files use an open-addressing hash of offsets instead, whose size
+ * depends only on the number of data items.
+ */
+#define kDexDataMapDenseMaxFileSize (4 * 1024 * 1024)
+
 struct DexDataMap {
-    u4 count;    /* number of items currently in the map */
-    u4 max;      /* maximum number of items that may be held */
-    u4* offsets; /* array of item offsets */
-    u2* types;   /* corresponding array of item types */
+    u4 count;       /* number of items currently in the map */
+    u4 max;         /* maximum number of items that may be held */
+    u4 lastOffset;  /* most recently added offset, for ordering checks */
+    u4 fileLen;     /* all offsets must be below this */
+
+    /* dense mode: non-NULL, indexed by offset, 0 == no entry */
+    u1* denseCodes;
+    u4 denseSize;   /* number of entries in denseCodes */
+
+    /* hash mode: power-of-two tables, 0xffffffff marks an empty slot */
+    u4 hashMask;
+    u4* hashOffsets;
+    u2* hashTypes;
 };
 
 /*
- * Allocate and initialize a DexDataMap. Returns NULL on failure.
+ * Allocate and initialize a DexDataMap able to hold "maxCount" items,
+ * all of which lie at offsets below "fileLen", the length of the mapped
+ * file (which may exceed the header's file_size). Returns NULL on failure.
  */
-DexDataMap* dexDataMapAlloc(u4 maxCount);
+DexDataMap* dexDataMapAlloc(u4 maxCount, u4 fileLen);
 
 /*
  * Free a DexDataMap.
@@ -42,9 +61,10 @@ void dexDataMapFree(DexDataMap* map);
 
 /*
  * Add a new element to the map. The offset must be greater than the
- * all previously added offsets.
+ * all previously added offsets and less than the file length the map was
+ * allocated with. Returns false (after logging) if either is not the case.
  */
-void dexDataMapAdd(DexDataMap* map, u4 offset, u2 type);
+bool dexDataMapAdd(DexDataMap* map, u4 offset, u2 type);
 
 /*
  * Get the type associated with the given offset. This returns -1 if
@@ -0,0 +1,429 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Machine-readable method index of a .dex file.
+ */
+
+#include "DexIndex.h"
+
+#include "DexClass.h"
+#include "DexDebugInfo.h"
+#include "DexProto.h"
+#include "DexUtf.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Everything the index records about one method, as handed to the
+ * per-method callback of walkMethods().
+ */
+struct IndexEntry {
+    const DexMethodId* pMethodId;
+    const char* classDescriptor;
+    const char* methodName;
+    const char* protoDescriptor;
+    u4 accessFlags;
+    u4 codeOff;
+    u4 insnsSize;
+    u4 firstLine;
+    u4 lastLine;
+};
+
+/* per-method callback; returning false stops the walk */
+typedef bool (*IndexEntryCb)(void* cnxt, const IndexEntry* pEntry);
+
+/*
+ * Debug info position callback; widens the [firstLine, lastLine] range
+ * in the IndexEntry to cover "lineNum".
+ */
+static int positionsCallback(void* cnxt, u4 address, u4 lineNum)
+{
+    IndexEntry* pEntry = (IndexEntry*) cnxt;
+
+    if (pEntry->firstLine == DEX_INDEX_NO_LINE || lineNum < pEntry->firstLine)
+        pEntry->firstLine = lineNum;
+    if (pEntry->lastLine == DEX_INDEX_NO_LINE || lineNum > pEntry->lastLine)
+        pEntry->lastLine = lineNum;
+    return 0;
+}
+
+/*
+ * Fill out an IndexEntry for one method. "protoDescriptors" caches the
+ * method descriptor of each proto_id, since most files have far fewer
+ * protos than methods.
+ */
+static bool fillEntry(const DexFile* pDexFile, const DexMethod* pDexMethod,
+    char** protoDescriptors, IndexEntry* pEntry)
+{
+    const DexMethodId* pMethodId =
+        dexGetMethodId(pDexFile, pDexMethod->methodIdx);
+
+    if (protoDescriptors[pMethodId->protoIdx] == NULL) {
+        protoDescriptors[pMethodId->protoIdx] =
+            dexCopyDescriptorFromMethodId(pDexFile, pMethodId);
+        if (protoDescriptors[pMethodId->protoIdx] == NULL)
+            return false;
+    }
+
+    pEntry->pMethodId = pMethodId;
+    pEntry->classDescriptor =
+        dexStringByTypeIdx(pDexFile, pMethodId->classIdx);
+    pEntry->methodName = dexStringById(pDexFile, pMethodId->nameIdx);
+    pEntry->protoDescriptor = protoDescriptors[pMethodId->protoIdx];
+    pEntry->accessFlags = pDexMethod->accessFlags;
+    pEntry->codeOff = pDexMethod->codeOff;
+    pEntry->insnsSize = 0;
+    pEntry->firstLine = DEX_INDEX_NO_LINE;
+    pEntry->lastLine = DEX_INDEX_NO_LINE;
+
+    const DexCode* pCode = dexGetCode(pDexFile, pDexMethod);
+    if (pCode != NULL) {
+        pEntry->insnsSize = pCode->insnsSize;
+        dexDecodeDebugInfo(pDexFile, pCode, pEntry->classDescriptor,
+            pMethodId->protoIdx, pDexMethod->accessFlags,
+            positionsCallback, NULL, pEntry);
+    }
+    return true;
+}
+
+/*
+ * Call "cb" for every method defined in the file, in class_def order,
+ * direct methods first. Returns false if the walk was cut short.
+ */
+static bool walkMethods(const DexFile* pDexFile, IndexEntryCb cb, void* cnxt)
+{
+    char** protoDescriptors = (char**) calloc(
+        pDexFile->pHeader->protoIdsSize + 1, sizeof(char*));
+    bool result = false;
+    u4 i, j;
+
+    if (protoDescriptors == NULL)
+        return false;
+
+    for (i = 0; i < pDexFile->pHeader->classDefsSize; i++) {
+        const DexClassDef* pClassDef = dexGetClassDef(pDexFile, i);
+        const u1* pEncodedData = dexGetClassData(pDexFile, pClassDef);
+        DexClassData* pClassData;
+        IndexEntry entry;
+
+        if (pEncodedData == NULL)
+            continue;
+
+        pClassData = dexReadAndVerifyClassData(&pEncodedData, NULL);
+        if (pClassData == NULL) {
+            ALOGE("Trouble reading class data (#%d)", i);
+            goto bail;
+        }
+
+        for (j = 0; j < pClassData->header.directMethodsSize; j++) {
+            if (!fillEntry(pDexFile, &pClassData->directMethods[j],
+                    protoDescriptors, &entry) ||
+                !cb(cnxt, &entry))
+            {
+                free(pClassData);
+                goto bail;
+            }
+        }
+        for (j = 0; j < pClassData->header.virtualMethodsSize; j++) {
+            if (!fillEntry(pDexFile, &pClassData->virtualMethods[j],
+                    protoDescriptors, &entry) ||
+                !cb(cnxt, &entry))
+            {
+                free(pClassData);
+                goto bail;
+            }
+        }
+
+        free(pClassData);
+    }
+
+    result = true;
+
+bail:
+    for (i = 0; i < pDexFile->pHeader->protoIdsSize; i++)
+        free(protoDescriptors[i]);
+    free(protoDescriptors);
+    return result;
+}
+
+/*
+ * ===========================================================================
+ *      JSON lines
+ * ===========================================================================
+ */
+
+/*
+ * Write a MUTF-8 string as a quoted JSON string. Everything outside
+ * printable ASCII is written as \u escapes, which keeps the output
+ * valid even for strings that aren't valid standard UTF-8 (embedded
+ * NULs, unpaired surrogates).
+ */
+static void writeJsonString(FILE* fp, const char* str)
+{
+    putc('"', fp);
+    while (*str != '\0') {
+        unsigned char ch = *str;
+
+        if (ch >= 0x20 && ch < 0x7f) {
+            if (ch == '"' || ch == '\\')
+                putc('\\', fp);
+            putc(ch, fp);
+            str++;
+        } else {
+            fprintf(fp, "\\u%04x", dexGetUtf16FromUtf8(&str));
+        }
+    }
+    putc('"', fp);
+}
+
+/*
+ * Per-method callback for dexIndexWriteJson(); "cnxt" is the FILE*.
+ */
+static bool writeJsonEntry(void* cnxt, const IndexEntry* pEntry)
+{
+    FILE* fp = (FILE*) cnxt;
+
+    fputs("{\"class\":", fp);
+    writeJsonString(fp, pEntry->classDescriptor);
+    fputs(",\"method\":", fp);
+    writeJsonString(fp, pEntry->methodName);
+    fputs(",\"proto\":", fp);
+    writeJsonString(fp, pEntry->protoDescriptor);
+    fprintf(fp, ",\"access\":%u,\"code_off\":%u,\"insns_size\":%u,"
+                "\"line_start\":%d,\"line_end\":%d}\n",
+        pEntry->accessFlags, pEntry->codeOff, pEntry->insnsSize,
+        (int) pEntry->firstLine, (int) pEntry->lastLine);
+
+    return !ferror(fp);
+}
+
+/* (documented in header file) */
+bool dexIndexWriteJson(const DexFile* pDexFile, FILE* fp)
+{
+    return walkMethods(pDexFile, writeJsonEntry, fp) && fflush(fp) == 0;
+}
+
+/*
+ * ===========================================================================
+ *      Binary index
+ * ===========================================================================
+ */
+
+/*
+ * State for building a binary index in memory. Strings are interned by
+ * their dex index, so each one is stored once no matter how many
+ * records refer to it.
+ */
+struct IndexBuilder {
+    const DexFile* pDexFile;
+
+    DexIndexMethod* methods;
+    u4 methodCount;
+    u4 methodAlloc;
+
+    char* strings;
+    u4 stringsSize;
+    u4 stringsAlloc;
+
+    u4* stringOffsets;      /* pool offset for each string_id, or kDexNoIndex */
+    u4* protoOffsets;       /* pool offset for each proto_id, or kDexNoIndex */
+};
+
+/*
+ * Append a string to the pool, returning its offset, or kDexNoIndex if
+ * we ran out of memory.
+ */
+static u4 addString(IndexBuilder* pBuilder, const char* str)
+{
+    size_t len = strlen(str) + 1;
+
+    if (pBuilder->stringsSize + len > pBuilder->stringsAlloc) {
+        u4 newAlloc = pBuilder->stringsAlloc * 2;
+        if (newAlloc < pBuilder->stringsSize + len)
+            newAlloc = pBuilder->stringsSize + len;
+        char* newStrings = (char*) realloc(pBuilder->strings, newAlloc);
+        if (newStrings == NULL)
+            return kDexNoIndex;
+        pBuilder->strings = newStrings;
+        pBuilder->stringsAlloc = newAlloc;
+    }
+
+    u4 off = pBuilder->stringsSize;
+    memcpy(pBuilder->strings + off, str, len);
+    pBuilder->stringsSize += len;
+    return off;
+}
+
+/*
+ * Get the pool offset of the string with the given string_id, adding it
+ * if this is the first reference.
+ */
+static u4 internStringId(IndexBuilder* pBuilder, u4 stringIdx)
+{
+    if (pBuilder->stringOffsets[stringIdx] == kDexNoIndex) {
+        pBuilder->stringOffsets[stringIdx] = addString(pBuilder,
+            dexStringById(pBuilder->pDexFile, stringIdx));
+    }
+    return pBuilder->stringOffsets[stringIdx];
+}
+
+/*
+ * Per-method callback for dexIndexWriteBinary(); "cnxt" is the
+ * IndexBuilder.
+ */
+static bool addBinaryEntry(void* cnxt, const IndexEntry* pEntry)
+{
+    IndexBuilder* pBuilder = (IndexBuilder*) cnxt;
+    const DexMethodId* pMethodId = pEntry->pMethodId;
+
+    if (pBuilder->methodCount == pBuilder->methodAlloc) {
+        u4 newAlloc = pBuilder->methodAlloc * 2;
+        if (newAlloc == 0)
+            newAlloc = 256;
+        DexIndexMethod* newMethods = (DexIndexMethod*)
+            realloc(pBuilder->methods, newAlloc * sizeof(DexIndexMethod));
+        if (newMethods == NULL)
+            return false;
+        pBuilder->methods = newMethods;
+        pBuilder->methodAlloc = newAlloc;
+    }
+
+    if (pBuilder->protoOffsets[pMethodId->protoIdx] == kDexNoIndex) {
+        pBuilder->protoOffsets[pMethodId->protoIdx] =
+            addString(pBuilder, pEntry->protoDescriptor);
+    }
+
+    DexIndexMethod* pMethod = &pBuilder->methods[pBuilder->methodCount++];
+    pMethod->classOff = internStringId(pBuilder,
+        dexGetTypeId(pBuilder->pDexFile, pMethodId->classIdx)->descriptorIdx);
+    pMethod->nameOff = internStringId(pBuilder, pMethodId->nameIdx);
+    pMethod->protoOff = pBuilder->protoOffsets[pMethodId->protoIdx];
+    pMethod->accessFlags = pEntry->accessFlags;
+    pMethod->codeOff = pEntry->codeOff;
+    pMethod->insnsSize = pEntry->insnsSize;
+    pMethod->firstLine = pEntry->firstLine;
+    pMethod->lastLine = pEntry->lastLine;
+
+    return pMethod->classOff != kDexNoIndex &&
+        pMethod->nameOff != kDexNoIndex &&
+        pMethod->protoOff != kDexNoIndex;
+}
+
+/* (documented in header file) */
+bool dexIndexWriteBinary(const DexFile* pDexFile, int fd)
+{
+    const DexHeader* pDexHeader = pDexFile->pHeader;
+    IndexBuilder builder;
+    DexIndexHeader header;
+    bool result = false;
+
+    memset(&builder, 0, sizeof(builder));
+    builder.pDexFile = pDexFile;
+    builder.stringOffsets =
+        (u4*) malloc((pDexHeader->stringIdsSize + 1) * sizeof(u4));
+    builder.protoOffsets =
+        (u4*) malloc((pDexHeader->protoIdsSize + 1) * sizeof(u4));
+    if (builder.stringOffsets == NULL || builder.protoOffsets == NULL)
+        goto bail;
+    memset(builder.stringOffsets, 0xff,
+        pDexHeader->stringIdsSize * sizeof(u4));
+    memset(builder.protoOffsets, 0xff,
+        pDexHeader->protoIdsSize * sizeof(u4));
+
+    if (!walkMethods(pDexFile, addBinaryEntry, &builder))
+        goto bail;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DEX_INDEX_MAGIC, 4);
+    memcpy(header.magic + 4, DEX_INDEX_MAGIC_VERS, 4);
+    header.checksum = pDexHeader->checksum;
+    memcpy(header.signature, pDexHeader->signature, kSHA1DigestLen);
+    header.methodCount = builder.methodCount;
+    header.methodsOff = sizeof(header);
+    header.stringsSize = builder.stringsSize;
+    header.stringsOff =
+        header.methodsOff + builder.methodCount * sizeof(DexIndexMethod);
+
+    if (sysWriteFully(fd, &header, sizeof(header), "DexIndex header") != 0 ||
+        sysWriteFully(fd, builder.methods,
+            builder.methodCount * sizeof(DexIndexMethod),
+            "DexIndex methods") != 0 ||
+        sysWriteFully(fd, builder.strings, builder.stringsSize,
+            "DexIndex strings") != 0)
+    {
+        goto bail;
+    }
+
+    result = true;
+
+bail:
+    free(builder.methods);
+    free(builder.strings);
+    free(builder.stringOffsets);
+    free(builder.protoOffsets);
+    return result;
+}
+
+/* (documented in header file) */
+const DexIndexHeader* dexIndexParse(const u1* data, size_t length)
+{
+    const DexIndexHeader* pHeader = (const DexIndexHeader*) data;
+
+    if (length < sizeof(DexIndexHeader) || ((uintptr_t) data & 3) != 0) {
+        ALOGE("Bad index: too short or misaligned");
+        return NULL;
+    }
+    if (memcmp(pHeader->magic, DEX_INDEX_MAGIC, 4) != 0 ||
+        memcmp(pHeader->magic + 4, DEX_INDEX_MAGIC_VERS, 4) != 0)
+    {
+        ALOGE("Bad index: unrecognized magic");
+        return NULL;
+    }
+
+    u8 methodsEnd = (u8) pHeader->methodsOff +
+        (u8) pHeader->methodCount * sizeof(DexIndexMethod);
+    u8 stringsEnd = (u8) pHeader->stringsOff + pHeader->stringsSize;
+    if (pHeader->methodsOff < sizeof(DexIndexHeader) ||
+        (pHeader->methodsOff & 3) != 0 ||
+        methodsEnd > length || stringsEnd > length)
+    {
+        ALOGE("Bad index: section out of range");
+        return NULL;
+    }
+
+    /* every string has to be terminated inside the pool */
+    if (pHeader->stringsSize != 0 &&
+        data[pHeader->stringsOff + pHeader->stringsSize - 1] != '\0')
+    {
+        ALOGE("Bad index: unterminated string pool");
+        return NULL;
+    }
+
+    for (u4 i = 0; i < pHeader->methodCount; i++) {
+        const DexIndexMethod* pMethod = dexIndexGetMethod(pHeader, i);
+        if (pMethod->classOff >= pHeader->stringsSize ||
+            pMethod->nameOff >= pHeader->stringsSize ||
+            pMethod->protoOff >= pHeader->stringsSize)
+        {
+            ALOGE("Bad index: record %u has bad string offset", i);
+            return NULL;
+        }
+    }
+
+    return pHeader;
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Machine-readable method index of a .dex file.
+ *
+ * The index has one entry per method defined in the file (concrete,
+ * abstract, and native alike), in class_def order with the direct
+ * methods of each class ahead of its virtual methods. It can be written
+ * either as JSON lines, one object per method, or as a compact binary
+ * file made of a header, a table of fixed-size records, and a pool of
+ * NUL-terminated MUTF-8 strings. The binary form is meant to be mapped
+ * and queried in place.
+ */
+
+#ifndef LIBDEX_DEXINDEX_H_
+#define LIBDEX_DEXINDEX_H_
+
+#include "libdex/DexFile.h"
+
+#include <stdio.h>
+
+/* binary index magic, followed by the format version */
+#define DEX_INDEX_MAGIC "dxi\n"
+#define DEX_INDEX_MAGIC_VERS "001\0"
+
+/* "firstLine"/"lastLine" value for methods without position info */
+#define DEX_INDEX_NO_LINE 0xffffffff
+
+/*
+ * Binary index file header. All values are little-endian.
+ *
+ * The checksum and signature are copied from the header of the dex file
+ * the index was generated from, so a consumer can tell whether an index
+ * is stale.
+ */
+struct DexIndexHeader {
+    u1  magic[8];           /* DEX_INDEX_MAGIC + DEX_INDEX_MAGIC_VERS */
+    u4  checksum;           /* dex file adler32 checksum */
+    u1  signature[kSHA1DigestLen]; /* dex file SHA-1 hash */
+    u4  methodCount;        /* number of DexIndexMethod records */
+    u4  methodsOff;         /* file offset of the first record */
+    u4  stringsSize;        /* size of the string pool, in bytes */
+    u4  stringsOff;         /* file offset of the string pool */
+};
+
+/*
+ * One binary index record. String fields are byte offsets into the
+ * string pool.
+ */
+struct DexIndexMethod {
+    u4  classOff;           /* class descriptor, e.g. "Ljava/lang/Object;" */
+    u4  nameOff;            /* method name */
+    u4  protoOff;           /* method descriptor, e.g. "(I)V" */
+    u4  accessFlags;
+    u4  codeOff;            /* file offset to DexCode, or 0 if none */
+    u4  insnsSize;          /* size of the insns array, in u2 units */
+    u4  firstLine;          /* lowest source line, or DEX_INDEX_NO_LINE */
+    u4  lastLine;           /* highest source line, or DEX_INDEX_NO_LINE */
+};
+
+/*
+ * Write the index of the given dex file as JSON lines, e.g.:
+ *
+ *   {"class":"LFoo;","method":"bar","proto":"(I)V","access":1,
+ *    "code_off":4660,"insns_size":12,"line_start":10,"line_end":14}
+ *
+ * (all on one line). Methods without position info report -1 for both
+ * line fields. Returns false on allocation or write failure.
+ */
+bool dexIndexWriteJson(const DexFile* pDexFile, FILE* fp);
+
+/*
+ * Write the binary index of the given dex file to "fd". Returns false
+ * on allocation or write failure.
+ */
+bool dexIndexWriteBinary(const DexFile* pDexFile, int fd);
+
+/*
+ * Check that "data" holds a well-formed binary index of "length" bytes,
+ * returning its header on success or NULL on failure. The data must be
+ * at least 4-byte aligned, which is always true of a mapped file.
+ */
+const DexIndexHeader* dexIndexParse(const u1* data, size_t length);
+
+/*
+ * Get the record with the given index from a parsed binary index.
+ */
+DEX_INLINE const DexIndexMethod* dexIndexGetMethod(
+    const DexIndexHeader* pHeader, u4 idx)
+{
+    assert(idx < pHeader->methodCount);
+    return (const DexIndexMethod*)
+        ((const u1*) pHeader + pHeader->methodsOff) + idx;
+}
+
+/*
+ * Get a string from a parsed binary index, given its pool offset.
+ */
+DEX_INLINE const char* dexIndexGetString(const DexIndexHeader* pHeader,
+    u4 off)
+{
+    assert(off < pHeader->stringsSize);
+    return (const char*) pHeader + pHeader->stringsOff + off;
+}
+
+#endif  // LIBDEX_DEXINDEX_H_
@@ -513,7 +513,12 @@ static bool swapMap(CheckState* state, DexMapList* pMap)
         return false;
     }
 
-    state->pDataMap = dexDataMapAlloc(dataItemCount);
+    /*
+     * Size the map by the mapped length rather than the header's
+     * file_size: an "odd length" file is accepted, and its items are
+     * bounds-checked against fileEnd, not file_size.
+     */
+    state->pDataMap = dexDataMapAlloc(dataItemCount, state->fileLen);
     if (state->pDataMap == NULL) {
         ALOGE("Unable to allocate data map (size %#x)", dataItemCount);
         return false;
@@ -2436,8 +2441,9 @@ static bool iterateSectionWithOptionalUpdate(CheckState* state,
             return false;
         }
 
-        if (mapType >= 0) {
-            dexDataMapAdd(state->pDataMap, offset, mapType);
+        if ((mapType >= 0)
+                && !dexDataMapAdd(state->pDataMap, offset, mapType)) {
+            return false;
         }
 
         state->previousItem = ptr;
@@ -20,13 +20,66 @@
 
 #include "DexUtf.h"
 
+#include <string.h>
+
+#define WORD_ONES      ((uintptr_t) 0x0101010101010101ULL)
+#define WORD_HIGH_BITS ((uintptr_t) 0x8080808080808080ULL)
+
+/* Return whether a word-sized load at the given address stays within
+ * its page (and so can't fault even if it runs past the string). */
+static inline bool canLoadWord(const char* p) {
+    return ((uintptr_t) p & (SYSTEM_PAGE_SIZE - 1))
+            <= SYSTEM_PAGE_SIZE - sizeof(uintptr_t);
+}
+
+static inline uintptr_t loadWord(const char* p) {
+    uintptr_t word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+/* Return whether any byte of the given word is '\0' or has its high
+ * bit set, that is, whether it is not a run of one-byte characters. */
+static inline bool hasZeroOrNonAsciiByte(uintptr_t word) {
+    return (((word - WORD_ONES) | word) & WORD_HIGH_BITS) != 0;
+}
+
 /* Compare two '\0'-terminated modified UTF-8 strings, using Unicode
  * code point values for comparison. This treats different encodings
  * for the same code point as equivalent, except that only a real '\0'
  * byte is considered the string terminator. The return value is as
  * for strcmp(). */
 int dexUtf8Cmp(const char* s1, const char* s2) {
+    /*
+     * Skip the common all-ASCII prefix a word at a time. Whatever
+     * follows it starts a character in both strings, so the result of
+     * comparing the rest is the result for the whole strings.
+     */
+    while (canLoadWord(s1) && canLoadWord(s2)) {
+        uintptr_t word = loadWord(s1);
+        if (word != loadWord(s2) || hasZeroOrNonAsciiByte(word)) {
+            break;
+        }
+        s1 += sizeof(uintptr_t);
+        s2 += sizeof(uintptr_t);
+    }
+
     for (;;) {
+        u1 c1 = (u1) *s1;
+        u1 c2 = (u1) *s2;
+
+        if ((c1 | c2) < 0x80) {
+            /* Both one-byte characters (or '\0'), so no decoding. */
+            if (c1 != c2) {
+                return c1 - c2;
+            } else if (c1 == '\0') {
+                return 0;
+            }
+            s1++;
+            s2++;
+            continue;
+        }
+
         if (*s1 == '\0') {
             if (*s2 == '\0') {
                 return 0;
@@ -54,6 +107,18 @@ u4 DEX_MEMBER_VALID_LOW_ASCII[4] = {
     0x07fffffe  // 60..7f lowercase etc.; valid: 'a'..'z'
 };
 
+/* Advance past the longest run of low-ascii characters that are valid as
+ * part of a member name. Names are nearly always entirely ascii, so this
+ * handles the bulk of the string with one table test per byte. */
+static inline const char* skipValidMemberNameAscii(const char* s) {
+    u1 c;
+    while ((c = (u1) *s) <= 0x7f
+            && (DEX_MEMBER_VALID_LOW_ASCII[c >> 5] & (1 << (c & 0x1f))) != 0) {
+        s++;
+    }
+    return s;
+}
+
 /* Helper for dexIsValidMemberNameUtf8(); do not call directly. */
 bool dexIsValidMemberNameUtf8_0(const char** pUtf8Ptr) {
     /*
@@ -132,6 +197,7 @@ bool dexIsValidMemberName(const char* s) {
     }
 
     for (;;) {
+        s = skipValidMemberNameAscii(s);
         switch (*s) {
             case '\0': {
                 return !angleName;
@@ -213,6 +279,11 @@ static bool isValidTypeDescriptorOrClassName(const char* s, bool isClassName,
 
     bool sepOrFirst = true; // first character or just encountered a separator.
     for (;;) {
+        const char* runEnd = skipValidMemberNameAscii(s);
+        if (runEnd != s) {
+            sepOrFirst = false;
+            s = runEnd;
+        }
         u1 c = (u1) *s;
         switch (c) {
             case '\0': {
@@ -129,6 +129,26 @@ static void addToHash(ZipArchive* pArchive, const char* str, int strLen,
     pArchive->mHashTable[ent].nameLen = strLen;
 }
 
+/*
+ * Read exactly "count" bytes at "offset" without moving the file offset,
+ * so that several threads can extract from one archive at once.
+ *
+ * Returns 0 on success.
+ */
+static int preadFully(int fd, void* buf, size_t count, off_t offset)
+{
+    unsigned char* dst = (unsigned char*) buf;
+    while (count != 0) {
+        ssize_t actual = TEMP_FAILURE_RETRY(pread(fd, dst, count, offset));
+        if (actual <= 0)
+            return -1;
+        dst += actual;
+        offset += actual;
+        count -= actual;
+    }
+    return 0;
+}
+
 /*
  * Get 2 little-endian bytes.
  */
@@ -611,13 +631,9 @@ int dexZipGetEntryInfo(const ZipArchive* pArchive, ZipEntry entry,
         }
 
         u1 lfhBuf[kLFHLen];
-        if (lseek(pArchive->mFd, localHdrOffset, SEEK_SET) != localHdrOffset) {
-            ALOGW("Zip: failed seeking to lfh at offset %ld", localHdrOffset);
-            return -1;
-        }
-        ssize_t actual =
-            TEMP_FAILURE_RETRY(read(pArchive->mFd, lfhBuf, sizeof(lfhBuf)));
-        if (actual != sizeof(lfhBuf)) {
+        if (preadFully(pArchive->mFd, lfhBuf, sizeof(lfhBuf),
+                localHdrOffset) != 0)
+        {
             ALOGW("Zip: failed reading lfh from offset %ld", localHdrOffset);
             return -1;
         }
@@ -661,20 +677,66 @@ int dexZipGetEntryInfo(const ZipArchive* pArchive, ZipEntry entry,
     return 0;
 }
 
+/*
+ * Copy "count" bytes of stored data to an open file descriptor, folding
+ * each piece into "*pCrc" as it goes by.  The data comes from "mapped" if
+ * the caller could map it, otherwise from "inFd" at "inOffset".
+ */
+static int copyToFile(int outFd, int inFd, off_t inOffset,
+    const unsigned char* mapped, size_t count, u4* pCrc)
+{
+    const size_t kBufSize = 32768;
+    unsigned char buf[kBufSize];
+
+    while (count != 0) {
+        size_t getSize = (count > kBufSize) ? kBufSize : count;
+        const unsigned char* src;
+
+        if (mapped != NULL) {
+            src = mapped;
+            mapped += getSize;
+        } else {
+            if (preadFully(inFd, buf, getSize, inOffset) != 0) {
+                ALOGW("Zip: copy read of %zd at %ld failed", getSize,
+                    (long) inOffset);
+                return -1;
+            }
+            src = buf;
+        }
+        *pCrc = dexComputeCrc32(*pCrc, src, getSize);
+        if (sysWriteFully(outFd, src, getSize, "Zip copy") != 0)
+            return -1;
+
+        inOffset += getSize;
+        count -= getSize;
+    }
+
+    return 0;
+}
+
 /*
  * Uncompress "deflate" data from the archive's file to an open file
- * descriptor.
+ * descriptor.  If the caller mapped the compressed data, "mapped" points
+ * at it and zlib gets it in one piece; otherwise it is read from "inFd"
+ * at "inOffset" a buffer at a time.  Each buffer of output is folded into
+ * "*pCrc" before it is written.
  */
-static int inflateToFile(int outFd, int inFd, size_t uncompLen, size_t compLen)
+static int inflateToFile(int outFd, int inFd, off_t inOffset,
+    const unsigned char* mapped, size_t uncompLen, size_t compLen, u4* pCrc)
 {
     int result = -1;
     const size_t kBufSize = 32768;
-    unsigned char* readBuf = (unsigned char*) malloc(kBufSize);
+    unsigned char* readBuf = NULL;
     unsigned char* writeBuf = (unsigned char*) malloc(kBufSize);
     z_stream zstream;
     int zerr;
 
-    if (readBuf == NULL || writeBuf == NULL)
+    if (mapped == NULL) {
+        readBuf = (unsigned char*) malloc(kBufSize);
+        if (readBuf == NULL)
+            goto bail;
+    }
+    if (writeBuf == NULL)
         goto bail;
 
     /*
@@ -705,22 +767,28 @@ static int inflateToFile(int outFd, int inFd, size_t uncompLen, size_t compLen)
         goto bail;
     }
 
+    if (mapped != NULL) {
+        zstream.next_in = (Bytef*) mapped;
+        zstream.avail_in = compLen;
+        compLen = 0;
+    }
+
     /*
      * Loop while we have more to do.
      */
     do {
         /* read as much as we can */
-        if (zstream.avail_in == 0) {
+        if (zstream.avail_in == 0 && readBuf != NULL) {
             size_t getSize = (compLen > kBufSize) ? kBufSize : compLen;
 
-            ssize_t actual = TEMP_FAILURE_RETRY(read(inFd, readBuf, getSize));
-            if (actual != (ssize_t) getSize) {
-                ALOGW("Zip: inflate read failed (%d vs %zd)",
-                    (int)actual, getSize);
+            if (preadFully(inFd, readBuf, getSize, inOffset) != 0) {
+                ALOGW("Zip: inflate read of %zd at %ld failed", getSize,
+                    (long) inOffset);
                 goto z_bail;
             }
 
             compLen -= getSize;
+            inOffset += getSize;
 
             zstream.next_in = readBuf;
             zstream.avail_in = getSize;
@@ -740,6 +808,7 @@ static int inflateToFile(int outFd, int inFd, size_t uncompLen, size_t compLen)
             (zerr == Z_STREAM_END && zstream.avail_out != kBufSize))
         {
             size_t writeSize = zstream.next_out - writeBuf;
+            *pCrc = dexComputeCrc32(*pCrc, writeBuf, writeSize);
             if (sysWriteFully(outFd, writeBuf, writeSize, "Zip inflate") != 0)
                 goto z_bail;
 
@@ -771,8 +840,13 @@ bail:
 /*
  * Uncompress an entry, in its entirety, to an open file descriptor.
  *
- * TODO: this doesn't verify the data's CRC, but probably should (especially
- * for uncompressed data).
+ * The entry's data is read through a mapping of just that entry, falling
+ * back to positional reads if it can't be mapped.  The archive's file
+ * offset is never used, so different threads may extract entries from the
+ * same archive concurrently.
+ *
+ * The data's CRC is computed while it is copied or inflated and checked
+ * against the central directory.
  */
 int dexZipExtractEntryToFile(const ZipArchive* pArchive,
     const ZipEntry entry, int fd)
@@ -781,33 +855,59 @@ int dexZipExtractEntryToFile(const ZipArchive* pArchive,
     int ent = entryToIndex(pArchive, entry);
     if (ent < 0) {
         ALOGW("Zip: extract can't find entry %p", entry);
-        goto bail;
+        return -1;
     }
 
     int method;
     size_t uncompLen, compLen;
     off_t dataOffset;
+    long expectedCrc;
 
     if (dexZipGetEntryInfo(pArchive, entry, &method, &uncompLen, &compLen,
-            &dataOffset, NULL, NULL) != 0)
+            &dataOffset, NULL, &expectedCrc) != 0)
     {
-        goto bail;
+        return -1;
     }
-    if (lseek(pArchive->mFd, dataOffset, SEEK_SET) != dataOffset) {
-        ALOGW("Zip: lseek to data at %ld failed", (long) dataOffset);
-        goto bail;
+
+    size_t dataLen = (method == kCompressStored) ? uncompLen : compLen;
+    MemMapping map;
+    const unsigned char* mapped = NULL;
+    memset(&map, 0, sizeof(map));
+    if (dataLen != 0 &&
+        sysMapFileSegmentInShmem(pArchive->mFd, dataOffset, dataLen, &map) == 0)
+    {
+        mapped = (const unsigned char*) map.addr;
     }
 
+    u4 crc = dexInitCrc32();
     if (method == kCompressStored) {
-        if (sysCopyFileToFile(fd, pArchive->mFd, uncompLen) != 0)
-            goto bail;
+        result = copyToFile(fd, pArchive->mFd, dataOffset, mapped, uncompLen,
+            &crc);
     } else {
-        if (inflateToFile(fd, pArchive->mFd, uncompLen, compLen) != 0)
-            goto bail;
+        result = inflateToFile(fd, pArchive->mFd, dataOffset, mapped,
+            uncompLen, compLen, &crc);
+    }
+    if (result == 0 && crc != (u4) expectedCrc) {
+        ALOGW("Zip: CRC mismatch on extracted entry (expected %08x, got %08x)",
+            (u4) expectedCrc, crc);
+        result = -1;
     }
 
-    result = 0;
-
-bail:
+    if (mapped != NULL)
+        sysReleaseShmem(&map);
     return result;
 }
+
+/*
+ * These are thin wrappers around zlib's crc32(), which is already linked
+ * for inflate.
+ */
+u4 dexInitCrc32()
+{
+    return crc32(0L, Z_NULL, 0);
+}
+
+u4 dexComputeCrc32(u4 crc, const void* buf, size_t len)
+{
+    return crc32(crc, (const Bytef*) buf, len);
+}
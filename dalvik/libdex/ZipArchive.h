@@ -172,7 +172,9 @@ int dexZipExtractEntryToFile(const ZipArchive* pArchive,
     const ZipEntry entry, int fd);
 
 /*
- * Utility function to compute a CRC-32.
+ * Utility function to compute a CRC-32.  Same polynomial and conventions
+ * as zlib's crc32(): start from dexInitCrc32() and feed the data in as
+ * many pieces as convenient.
  */
 u4 dexInitCrc32(void);
 u4 dexComputeCrc32(u4 crc, const void* buf, size_t len);
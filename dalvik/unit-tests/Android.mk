@@ -20,6 +20,7 @@ test_module = dalvik-vm-unit-tests
 test_tags = eng tests
 
 test_src_files = \
+    DexDataMap_test.cpp \
     dvmHumanReadableDescriptor_test.cpp \
     
 test_c_includes = \
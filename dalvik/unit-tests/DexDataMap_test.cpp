@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include "libdex/DexDataMap.h"
+
+static void checkMap(u4 fileSize) {
+  const u4 count = 1000;
+  DexDataMap* map = dexDataMapAlloc(count, fileSize);
+  ASSERT_TRUE(map != NULL);
+
+  // Mix aligned and unaligned offsets, as string data items are.
+  for (u4 i = 0; i < count; i++) {
+    ASSERT_TRUE(dexDataMapAdd(map, 0x70 + i * 3,
+        (i & 1) ? kDexTypeCodeItem : kDexTypeStringDataItem));
+  }
+  EXPECT_EQ(count, map->count);
+
+  for (u4 i = 0; i < count; i++) {
+    EXPECT_EQ((i & 1) ? kDexTypeCodeItem : kDexTypeStringDataItem,
+        dexDataMapGet(map, 0x70 + i * 3));
+    EXPECT_EQ(-1, dexDataMapGet(map, 0x70 + i * 3 + 1));
+  }
+  EXPECT_EQ(-1, dexDataMapGet(map, 0));
+  EXPECT_EQ(-1, dexDataMapGet(map, fileSize - 1));
+  EXPECT_EQ(-1, dexDataMapGet(map, 0xffffffff));
+
+  EXPECT_TRUE(dexDataMapVerify(map, 0x70, kDexTypeStringDataItem));
+  EXPECT_FALSE(dexDataMapVerify(map, 0x70, kDexTypeCodeItem));
+  EXPECT_TRUE(dexDataMapVerify0Ok(map, 0, kDexTypeCodeItem));
+
+  dexDataMapFree(map);
+}
+
+TEST(DexDataMap, Dense) {
+  checkMap(0x10000);
+}
+
+TEST(DexDataMap, Hashed) {
+  checkMap(kDexDataMapDenseMaxFileSize + 1);
+}
+
+TEST(DexDataMap, AllTypesRoundTrip) {
+  static const u2 kTypes[] = {
+    kDexTypeMapList, kDexTypeTypeList, kDexTypeAnnotationSetRefList,
+    kDexTypeAnnotationSetItem, kDexTypeClassDataItem, kDexTypeCodeItem,
+    kDexTypeStringDataItem, kDexTypeDebugInfoItem, kDexTypeAnnotationItem,
+    kDexTypeEncodedArrayItem, kDexTypeAnnotationsDirectoryItem,
+  };
+  const u4 count = sizeof(kTypes) / sizeof(kTypes[0]);
+  DexDataMap* map = dexDataMapAlloc(count, 0x1000);
+  ASSERT_TRUE(map != NULL);
+  for (u4 i = 0; i < count; i++) {
+    ASSERT_TRUE(dexDataMapAdd(map, 4 + i * 4, kTypes[i]));
+  }
+  for (u4 i = 0; i < count; i++) {
+    EXPECT_EQ(kTypes[i], dexDataMapGet(map, 4 + i * 4));
+  }
+  dexDataMapFree(map);
+}
+
+TEST(DexDataMap, RejectsBadOffsets) {
+  DexDataMap* map = dexDataMapAlloc(4, 0x100);
+  ASSERT_TRUE(map != NULL);
+  EXPECT_TRUE(dexDataMapAdd(map, 0x80, kDexTypeCodeItem));
+  // Out of order.
+  EXPECT_FALSE(dexDataMapAdd(map, 0x40, kDexTypeCodeItem));
+  // Past the end of the file.
+  EXPECT_FALSE(dexDataMapAdd(map, 0x100, kDexTypeCodeItem));
+  EXPECT_EQ(1U, map->count);
+  EXPECT_EQ(-1, dexDataMapGet(map, 0x100));
+  dexDataMapFree(map);
+
+  // The hashed index is bounded by the file length too.
+  const u4 fileLen = kDexDataMapDenseMaxFileSize + 0x100;
+  map = dexDataMapAlloc(4, fileLen);
+  ASSERT_TRUE(map != NULL);
+  ASSERT_TRUE(map->denseCodes == NULL);
+  EXPECT_TRUE(dexDataMapAdd(map, fileLen - 4, kDexTypeCodeItem));
+  EXPECT_FALSE(dexDataMapAdd(map, fileLen, kDexTypeCodeItem));
+  EXPECT_EQ(1U, map->count);
+  dexDataMapFree(map);
+}
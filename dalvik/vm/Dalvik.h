@@ -43,6 +43,7 @@
 #include "Profile.h"
 #include "UtfString.h"
 #include "Intern.h"
+#include "LineNumberCache.h"
 #include "ReferenceTable.h"
 #include "IndirectRefTable.h"
 #include "AtomicCache.h"
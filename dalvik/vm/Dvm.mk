@@ -101,6 +101,7 @@ LOCAL_SRC_FILES := \
 	InlineNative.cpp.arm \
 	Inlines.cpp \
 	Intern.cpp \
+	LineNumberCache.cpp \
 	Jni.cpp \
 	JarFile.cpp \
 	LinearAlloc.cpp \
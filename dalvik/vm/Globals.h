@@ -39,6 +39,7 @@
 struct GcHeap;
 struct BreakpointSet;
 struct InlineSub;
+struct LineNumberCache;
 
 /*
  * One of these for each -ea/-da/-esa/-dsa on the command line.
@@ -217,6 +218,12 @@ struct DvmGlobals {
     /* Hash table of strings interned by the class loader. */
     HashTable*  literalStrings;
 
+    /*
+     * Decoded pc-to-line tables, for stack traces.
+     */
+    pthread_mutex_t lineNumberCacheLock;
+    LineNumberCache* lineNumberCache;
+
     /*
      * Classes constructed directly by the vm.
      */
@@ -1473,6 +1473,9 @@ std::string dvmStartup(int argc, const char* const argv[],
     if (!dvmStringInternStartup()) {
         return "dvmStringInternStartup failed";
     }
+    if (!dvmLineNumberCacheStartup()) {
+        return "dvmLineNumberCacheStartup failed";
+    }
     if (!dvmNativeStartup()) {
         return "dvmNativeStartup failed";
     }
@@ -2013,6 +2016,7 @@ void dvmShutdown()
     dvmDebuggerShutdown();
     dvmProfilingShutdown();
     dvmJniShutdown();
+    dvmLineNumberCacheShutdown();
     dvmStringInternShutdown();
     dvmThreadShutdown();
     dvmClassShutdown();
@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Bounded LRU cache of decoded pc-to-line-number tables.
+ */
+#include "Dalvik.h"
+
+#include <stdlib.h>
+
+/*
+ * Growable (address, line) array filled in by the debug info decoder.
+ */
+struct LinePositions {
+    u4* positions;
+    u4  count;
+    u4  alloc;
+    bool failed;
+};
+
+/*
+ * Create the cache.
+ */
+bool dvmLineNumberCacheStartup()
+{
+    LineNumberCache* pCache =
+        (LineNumberCache*) calloc(1, sizeof(LineNumberCache));
+    if (pCache == NULL)
+        return false;
+
+    u4 numBuckets = kLineNumberCacheCapacity * 2;
+    assert((numBuckets & (numBuckets - 1)) == 0);
+    pCache->buckets = (int*) malloc(numBuckets * sizeof(int));
+    pCache->entries = (LineNumberCacheEntry*)
+        calloc(kLineNumberCacheCapacity, sizeof(LineNumberCacheEntry));
+    if (pCache->buckets == NULL || pCache->entries == NULL) {
+        free(pCache->buckets);
+        free(pCache->entries);
+        free(pCache);
+        return false;
+    }
+    memset(pCache->buckets, 0xff, numBuckets * sizeof(int));
+    pCache->bucketMask = numBuckets - 1;
+    pCache->capacity = kLineNumberCacheCapacity;
+    pCache->lruHead = pCache->lruTail = -1;
+
+    dvmInitMutex(&gDvm.lineNumberCacheLock);
+    gDvm.lineNumberCache = pCache;
+    return true;
+}
+
+/*
+ * Free the cache and everything in it.
+ */
+void dvmLineNumberCacheShutdown()
+{
+    LineNumberCache* pCache = gDvm.lineNumberCache;
+    if (pCache == NULL)
+        return;
+
+    for (u4 i = 0; i < pCache->used; i++)
+        free(pCache->entries[i].positions);
+    free(pCache->entries);
+    free(pCache->buckets);
+    free(pCache);
+    gDvm.lineNumberCache = NULL;
+    dvmDestroyMutex(&gDvm.lineNumberCacheLock);
+}
+
+static inline u4 hashMethod(const LineNumberCache* pCache,
+    const Method* method)
+{
+    /* Method structs are word aligned; drop the low bits */
+    u4 hash = (u4) ((uintptr_t) method >> 2);
+    hash ^= hash >> 16;
+    return hash & pCache->bucketMask;
+}
+
+/*
+ * Debug info "positions" callback.  Appends every position; we want the
+ * whole table, not just the line for one pc.
+ */
+static int appendPositionCb(void* cnxt, u4 address, u4 lineNum)
+{
+    LinePositions* pPositions = (LinePositions*) cnxt;
+
+    if (pPositions->count == pPositions->alloc) {
+        u4 newAlloc = (pPositions->alloc == 0) ? 16 : pPositions->alloc * 2;
+        u4* newPositions = (u4*) realloc(pPositions->positions,
+            newAlloc * 2 * sizeof(u4));
+        if (newPositions == NULL) {
+            pPositions->failed = true;
+            return 1;
+        }
+        pPositions->positions = newPositions;
+        pPositions->alloc = newAlloc;
+    }
+    pPositions->positions[pPositions->count * 2] = address;
+    pPositions->positions[pPositions->count * 2 + 1] = lineNum;
+    pPositions->count++;
+    return 0;
+}
+
+/*
+ * Find the line for "relPc" in a position table.  This matches what the
+ * decoder-driven lookup in dvmLineNumFromPC used to report: the line of
+ * the first position at exactly "relPc", else the line of the last
+ * position before it, else -1.
+ */
+static int lookUpLine(const u4* positions, u4 count, u4 relPc)
+{
+    /* find the first position whose address is >= relPc */
+    u4 lo = 0;
+    u4 hi = count;
+    while (lo < hi) {
+        u4 mid = lo + (hi - lo) / 2;
+        if (positions[mid * 2] < relPc)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo < count && positions[lo * 2] == relPc)
+        return positions[lo * 2 + 1];
+    if (lo == 0)
+        return -1;
+    return positions[(lo - 1) * 2 + 1];
+}
+
+/*
+ * Find the entry for "method".  Returns -1 if it isn't cached.
+ */
+static int findEntry(const LineNumberCache* pCache, const Method* method)
+{
+    int idx = pCache->buckets[hashMethod(pCache, method)];
+    while (idx >= 0 && pCache->entries[idx].method != method)
+        idx = pCache->entries[idx].hashNext;
+    return idx;
+}
+
+static void lruUnlink(LineNumberCache* pCache, int idx)
+{
+    LineNumberCacheEntry* pEntry = &pCache->entries[idx];
+    if (pEntry->lruPrev >= 0)
+        pCache->entries[pEntry->lruPrev].lruNext = pEntry->lruNext;
+    else
+        pCache->lruHead = pEntry->lruNext;
+    if (pEntry->lruNext >= 0)
+        pCache->entries[pEntry->lruNext].lruPrev = pEntry->lruPrev;
+    else
+        pCache->lruTail = pEntry->lruPrev;
+}
+
+static void lruPushFront(LineNumberCache* pCache, int idx)
+{
+    LineNumberCacheEntry* pEntry = &pCache->entries[idx];
+    pEntry->lruPrev = -1;
+    pEntry->lruNext = pCache->lruHead;
+    if (pCache->lruHead >= 0)
+        pCache->entries[pCache->lruHead].lruPrev = idx;
+    else
+        pCache->lruTail = idx;
+    pCache->lruHead = idx;
+}
+
+static void hashUnlink(LineNumberCache* pCache, int idx)
+{
+    int* pLink = &pCache->buckets[hashMethod(pCache,
+        pCache->entries[idx].method)];
+    while (*pLink != idx) {
+        assert(*pLink >= 0);
+        pLink = &pCache->entries[*pLink].hashNext;
+    }
+    *pLink = pCache->entries[idx].hashNext;
+}
+
+/*
+ * Add a freshly decoded table, evicting the least recently used method if
+ * the cache is full.  Takes ownership of "positions".
+ */
+static void insertEntry(LineNumberCache* pCache, const Method* method,
+    u4* positions, u4 count)
+{
+    int idx;
+    if (pCache->used < pCache->capacity) {
+        idx = pCache->used++;
+    } else {
+        idx = pCache->lruTail;
+        lruUnlink(pCache, idx);
+        hashUnlink(pCache, idx);
+        free(pCache->entries[idx].positions);
+    }
+
+    LineNumberCacheEntry* pEntry = &pCache->entries[idx];
+    pEntry->method = method;
+    pEntry->positions = positions;
+    pEntry->count = count;
+
+    u4 bucket = hashMethod(pCache, method);
+    pEntry->hashNext = pCache->buckets[bucket];
+    pCache->buckets[bucket] = idx;
+    lruPushFront(pCache, idx);
+}
+
+bool dvmLineNumberCacheLookup(const Method* method, const DexCode* pDexCode,
+    u4 relPc, int* pLineNum)
+{
+    LineNumberCache* pCache = gDvm.lineNumberCache;
+    if (pCache == NULL)
+        return false;
+
+    dvmLockMutex(&gDvm.lineNumberCacheLock);
+    int idx = findEntry(pCache, method);
+    if (idx >= 0) {
+        pCache->hits++;
+        if (idx != pCache->lruHead) {
+            lruUnlink(pCache, idx);
+            lruPushFront(pCache, idx);
+        }
+        LineNumberCacheEntry* pEntry = &pCache->entries[idx];
+        *pLineNum = lookUpLine(pEntry->positions, pEntry->count, relPc);
+        dvmUnlockMutex(&gDvm.lineNumberCacheLock);
+        return true;
+    }
+    pCache->misses++;
+    dvmUnlockMutex(&gDvm.lineNumberCacheLock);
+
+    /*
+     * Decode without holding the lock.  If another thread races us to the
+     * same method the tables are identical, and we keep the first one.
+     */
+    LinePositions positions;
+    memset(&positions, 0, sizeof(positions));
+    dexDecodeDebugInfo(method->clazz->pDvmDex->pDexFile, pDexCode,
+            method->clazz->descriptor,
+            method->prototype.protoIdx,
+            method->accessFlags,
+            appendPositionCb, NULL, &positions);
+    if (positions.failed) {
+        free(positions.positions);
+        return false;
+    }
+    *pLineNum = lookUpLine(positions.positions, positions.count, relPc);
+
+    dvmLockMutex(&gDvm.lineNumberCacheLock);
+    if (findEntry(pCache, method) < 0) {
+        insertEntry(pCache, method, positions.positions, positions.count);
+        positions.positions = NULL;
+    }
+    dvmUnlockMutex(&gDvm.lineNumberCacheLock);
+    free(positions.positions);
+
+    return true;
+}
+
+void dvmDumpLineNumberCacheStats(const DebugOutputTarget* target)
+{
+    LineNumberCache* pCache = gDvm.lineNumberCache;
+    if (pCache == NULL)
+        return;
+
+    dvmLockMutex(&gDvm.lineNumberCacheLock);
+    dvmPrintDebugMessage(target,
+        "Line number cache: %u/%u methods; %llu hits; %llu misses\n\n",
+        pCache->used, pCache->capacity, pCache->hits, pCache->misses);
+    dvmUnlockMutex(&gDvm.lineNumberCacheLock);
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Bounded LRU cache of decoded pc-to-line-number tables.
+ *
+ * Exception stack traces, lock contention logging and SIGQUIT dumps ask
+ * for the line numbers of the same handful of methods over and over.
+ * Without the cache each request walks the method's debug_info state
+ * machine from the start.
+ */
+#ifndef DALVIK_LINENUMBERCACHE_H_
+#define DALVIK_LINENUMBERCACHE_H_
+
+/* max #of methods whose line tables are kept */
+#define kLineNumberCacheCapacity    1024
+
+/*
+ * One cached method.  "positions" holds "count" (address, line) pairs in
+ * ascending address order, exactly as the debug info emits them.  Entries
+ * are chained through "hashNext" and kept in LRU order through "lruPrev"
+ * and "lruNext"; all three are indices into LineNumberCache.entries, or
+ * -1 for none.
+ */
+struct LineNumberCacheEntry {
+    const Method*   method;
+    u4*             positions;
+    u4              count;
+    int             hashNext;
+    int             lruPrev;
+    int             lruNext;
+};
+
+struct LineNumberCache {
+    /* all fields are guarded by gDvm.lineNumberCacheLock */
+    int*                    buckets;        /* heads of the hash chains */
+    u4                      bucketMask;     /* #of buckets minus one */
+    LineNumberCacheEntry*   entries;
+    u4                      capacity;
+    u4                      used;
+    int                     lruHead;        /* most recently used */
+    int                     lruTail;        /* least recently used */
+
+    u8                      hits;
+    u8                      misses;
+};
+
+/*
+ * Create and destroy the VM-wide cache in gDvm.
+ */
+bool dvmLineNumberCacheStartup(void);
+void dvmLineNumberCacheShutdown(void);
+
+/*
+ * Look up the line number for "relPc" (in 16-bit code units) in "method",
+ * which must have a DexCode.  On a miss the method's line table is decoded
+ * and cached.  "*pLineNum" is set to -1 if there is no line number
+ * information for the pc.
+ *
+ * Returns false if the cache isn't available or the table couldn't be
+ * allocated; the caller should decode the debug info itself.
+ */
+bool dvmLineNumberCacheLookup(const Method* method, const DexCode* pDexCode,
+    u4 relPc, int* pLineNum);
+
+/*
+ * Print the cache's size and hit/miss counters.
+ */
+void dvmDumpLineNumberCacheStats(const DebugOutputTarget* target);
+
+#endif  // DALVIK_LINENUMBERCACHE_H_
@@ -121,6 +121,7 @@ static void logThreadStacks(FILE* fp)
     printProcessName(&target);
     dvmPrintDebugMessage(&target, "\n");
     dvmDumpJniStats(&target);
+    dvmDumpLineNumberCacheStats(&target);
     dvmDumpAllThreadsEx(&target, true);
     fprintf(fp, "----- end %d -----\n", pid);
 }
@@ -153,6 +154,7 @@ static void handleSigQuit()
         DebugOutputTarget target;
         dvmCreateLogOutputTarget(&target, ANDROID_LOG_INFO, LOG_TAG);
         dvmDumpJniStats(&target);
+        dvmDumpLineNumberCacheStats(&target);
         dvmDumpAllThreadsEx(&target, true);
     } else {
         /* write to memory buffer */
@@ -611,9 +611,10 @@ bool dvmContinueOptimization(int fd, off_t dexOffset, long dexLength,
                 success = false;
             } else {
                 /*
-                 * If configured to do so, generate register map output
+                 * If configured to do so, lay out register map output
                  * for all verified classes.  The register maps were
-                 * generated during verification, and will now be serialized.
+                 * generated during verification, and are serialized
+                 * straight into the file by writeOptData().
                  */
                 if (gDvm.generateRegisterMaps) {
                     pRegMapBuilder = dvmGenerateRegisterMaps(pDvmDex);
@@ -1427,12 +1428,11 @@ static int writeDependencies(int fd, u4 modWhen, u4 crc)
 
 
 /*
- * Write a block of data in "chunk" format.
+ * Write the header for a block of data in "chunk" format.
  *
- * The chunk header fields are always in "native" byte order.  If "size"
- * is not a multiple of 8 bytes, the data area is padded out.
+ * The chunk header fields are always in "native" byte order.
  */
-static bool writeChunk(int fd, u4 type, const void* data, size_t size)
+static bool writeChunkHeader(int fd, u4 type, size_t size)
 {
     union {             /* save a syscall by grouping these together */
         char raw[8];
@@ -1448,17 +1448,16 @@ static bool writeChunk(int fd, u4 type, const void* data, size_t size)
 
     header.ts.type = type;
     header.ts.size = (u4) size;
-    if (sysWriteFully(fd, &header, sizeof(header),
-            "DexOpt opt chunk header write") != 0)
-    {
-        return false;
-    }
-
-    if (size > 0) {
-        if (sysWriteFully(fd, data, size, "DexOpt opt chunk write") != 0)
-            return false;
-    }
+    return sysWriteFully(fd, &header, sizeof(header),
+            "DexOpt opt chunk header write") == 0;
+}
 
+/*
+ * Finish a chunk whose "size" bytes of data have just been written.  If
+ * "size" is not a multiple of 8 bytes, the data area is padded out.
+ */
+static void padChunk(int fd, size_t size)
+{
     /* if necessary, pad to 64-bit alignment */
     if ((size & 7) != 0) {
         int padSize = 8 - (size & 7);
@@ -1467,7 +1466,22 @@ static bool writeChunk(int fd, u4 type, const void* data, size_t size)
     }
 
     assert( ((int)lseek(fd, 0, SEEK_CUR) & 7) == 0);
+}
+
+/*
+ * Write a block of data in "chunk" format.
+ */
+static bool writeChunk(int fd, u4 type, const void* data, size_t size)
+{
+    if (!writeChunkHeader(fd, type, size))
+        return false;
+
+    if (size > 0) {
+        if (sysWriteFully(fd, data, size, "DexOpt opt chunk write") != 0)
+            return false;
+    }
 
+    padChunk(fd, size);
     return true;
 }
 
@@ -1489,13 +1503,15 @@ static bool writeOptData(int fd, const DexClassLookup* pClassLookup,
         return false;
     }
 
-    /* register maps (optional) */
+    /* register maps (optional), streamed straight from the Method structs */
     if (pRegMapBuilder != NULL) {
-        if (!writeChunk(fd, (u4) kDexChunkRegisterMaps,
-                pRegMapBuilder->data, pRegMapBuilder->size))
+        if (!writeChunkHeader(fd, (u4) kDexChunkRegisterMaps,
+                pRegMapBuilder->size) ||
+            !dvmWriteRegisterMaps(pRegMapBuilder, fd))
         {
             return false;
         }
+        padChunk(fd, pRegMapBuilder->size);
     }
 
     /* write the end marker */
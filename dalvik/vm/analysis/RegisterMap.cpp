@@ -559,11 +559,11 @@ static bool verifyMap(VerifierData* vdata, const RegisterMap* pMap)
  */
 
 /*
- * Advance "ptr" to ensure 32-bit alignment.
+ * Round "size" up to the next multiple of 4.
  */
-static inline u1* align32(u1* ptr)
+static inline size_t align32(size_t size)
 {
-    return (u1*) (((int) ptr + 3) & ~0x03);
+    return (size + 3) & ~0x03;
 }
 
 /*
@@ -607,16 +607,11 @@ static size_t computeRegisterMapSize(const RegisterMap* pMap)
  * This strips the "allocated on heap" flag from the format byte, so that
  * direct-mapped maps are correctly identified as such.
  */
-static bool writeMapForMethod(const Method* meth, u1** pPtr)
+static void writeMapForMethod(const Method* meth, u1** pPtr)
 {
     if (meth->registerMap == NULL) {
-        if (!dvmIsAbstractMethod(meth) && !dvmIsNativeMethod(meth)) {
-            ALOGW("Warning: no map available for %s.%s",
-                meth->clazz->descriptor, meth->name);
-            /* weird, but keep going */
-        }
         *(*pPtr)++ = kRegMapFormatNone;
-        return true;
+        return;
     }
 
     /* serialize map into the buffer */
@@ -628,21 +623,50 @@ static bool writeMapForMethod(const Method* meth, u1** pPtr)
     **pPtr &= ~(kRegMapFormatOnHeap);
 
     *pPtr += mapSize;
+}
 
-    return true;
+/*
+ * Compute the number of bytes writeMapsAllMethods() will output for
+ * "clazz", not including the alignment padding that follows it.
+ *
+ * Only looks at the Method structs and the maps themselves, so this (and
+ * the write) can be done after the DEX file has been unmapped.
+ */
+static size_t computeMethodPoolSize(const ClassObject* clazz)
+{
+    size_t size = offsetof(RegisterMapMethodPool, methodData);
+    int i;
+
+    for (i = 0; i < clazz->directMethodCount; i++) {
+        const Method* meth = &clazz->directMethods[i];
+        if (dvmIsMirandaMethod(meth))
+            continue;
+        if (meth->registerMap == NULL)
+            size++;
+        else
+            size += computeRegisterMapSize(meth->registerMap);
+    }
+    for (i = 0; i < clazz->virtualMethodCount; i++) {
+        const Method* meth = &clazz->virtualMethods[i];
+        if (dvmIsMirandaMethod(meth))
+            continue;
+        if (meth->registerMap == NULL)
+            size++;
+        else
+            size += computeRegisterMapSize(meth->registerMap);
+    }
+
+    return size;
 }
 
 /*
- * Write maps for all methods in the specified class to the buffer, which
- * can hold at most "length" bytes.  "*pPtr" will be advanced past the end
- * of the data we write.
+ * Sanity-check the maps for "clazz" before we commit to writing them.
+ *
+ * Returns "false" if the class can't be represented.
  */
-static bool writeMapsAllMethods(DvmDex* pDvmDex, const ClassObject* clazz,
-    u1** pPtr, size_t length)
+static bool checkMapsAllMethods(const ClassObject* clazz)
 {
-    RegisterMapMethodPool* pMethodPool;
-    u1* ptr = *pPtr;
-    int i, methodCount;
+    int i;
 
     /* artificial limit */
     if (clazz->virtualMethodCount + clazz->directMethodCount >= 65536) {
@@ -650,6 +674,36 @@ static bool writeMapsAllMethods(DvmDex* pDvmDex, const ClassObject* clazz,
         return false;
     }
 
+    for (i = 0; i < clazz->directMethodCount + clazz->virtualMethodCount;
+        i++)
+    {
+        const Method* meth = (i < clazz->directMethodCount) ?
+            &clazz->directMethods[i] :
+            &clazz->virtualMethods[i - clazz->directMethodCount];
+
+        if (meth->registerMap == NULL && !dvmIsMirandaMethod(meth) &&
+            !dvmIsAbstractMethod(meth) && !dvmIsNativeMethod(meth))
+        {
+            ALOGW("Warning: no map available for %s.%s",
+                meth->clazz->descriptor, meth->name);
+            /* weird, but keep going */
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Write maps for all methods in the specified class to the buffer.
+ * "*pPtr" will be advanced past the end of the data we write, which will
+ * be exactly computeMethodPoolSize(clazz) bytes.
+ */
+static void writeMapsAllMethods(const ClassObject* clazz, u1** pPtr)
+{
+    RegisterMapMethodPool* pMethodPool;
+    u1* ptr = *pPtr;
+    int i, methodCount;
+
     pMethodPool = (RegisterMapMethodPool*) ptr;
     ptr += offsetof(RegisterMapMethodPool, methodData);
     methodCount = 0;
@@ -671,53 +725,57 @@ static bool writeMapsAllMethods(DvmDex* pDvmDex, const ClassObject* clazz,
         const Method* meth = &clazz->directMethods[i];
         if (dvmIsMirandaMethod(meth))
             continue;
-        if (!writeMapForMethod(&clazz->directMethods[i], &ptr)) {
-            return false;
-        }
+        writeMapForMethod(meth, &ptr);
         methodCount++;
-        //ptr = align32(ptr);
     }
 
     for (i = 0; i < clazz->virtualMethodCount; i++) {
         const Method* meth = &clazz->virtualMethods[i];
         if (dvmIsMirandaMethod(meth))
             continue;
-        if (!writeMapForMethod(&clazz->virtualMethods[i], &ptr)) {
-            return false;
-        }
+        writeMapForMethod(meth, &ptr);
         methodCount++;
-        //ptr = align32(ptr);
     }
 
     pMethodPool->methodCount = methodCount;
 
     *pPtr = ptr;
-    return true;
 }
 
 /*
- * Write maps for all classes to the specified buffer, which can hold at
- * most "length" bytes.
+ * Gather the register map layout for all verified classes in "pDvmDex".
  *
- * Returns the actual length used, or 0 on failure.
+ * The maps themselves were generated during verification and hang off the
+ * Method structs.  Here we just decide which classes get an entry and
+ * where each one lands, so that dvmWriteRegisterMaps() can stream the
+ * result straight to the output file.
  */
-static size_t writeMapsAllClasses(DvmDex* pDvmDex, u1* basePtr, size_t length)
+RegisterMapBuilder* dvmGenerateRegisterMaps(DvmDex* pDvmDex)
 {
     DexFile* pDexFile = pDvmDex->pDexFile;
     u4 count = pDexFile->pHeader->classDefsSize;
-    RegisterMapClassPool* pClassPool;
-    u4* offsetTable;
-    u1* ptr = basePtr;
+    RegisterMapBuilder* pBuilder;
+    size_t size;
     u4 idx;
 
     assert(gDvm.optimizing);
 
-    pClassPool = (RegisterMapClassPool*) ptr;
-    ptr += offsetof(RegisterMapClassPool, classDataOffset);
-    offsetTable = (u4*) ptr;
-    ptr += count * sizeof(u4);
+    pBuilder = (RegisterMapBuilder*) calloc(1, sizeof(RegisterMapBuilder));
+    if (pBuilder == NULL)
+        return NULL;
+    pBuilder->numClasses = count;
+    pBuilder->classes =
+        (const ClassObject**) calloc(count, sizeof(ClassObject*));
+    pBuilder->classOffsets = (u4*) calloc(count, sizeof(u4));
+    if (count > 0 &&
+        (pBuilder->classes == NULL || pBuilder->classOffsets == NULL))
+    {
+        dvmFreeRegisterMapBuilder(pBuilder);
+        return NULL;
+    }
 
-    pClassPool->numClasses = count;
+    size = offsetof(RegisterMapClassPool, classDataOffset) +
+        count * sizeof(u4);
 
     /*
      * We want an entry for every class, loaded or not.
@@ -744,82 +802,112 @@ static size_t writeMapsAllClasses(DvmDex* pDvmDex, u1* basePtr, size_t length)
             clazz = dvmLookupClass(classDescriptor, NULL, false);
 
         if (clazz != NULL) {
-            offsetTable[idx] = ptr - basePtr;
-            LOGVV("%d -> offset %d (%p-%p)",
-                idx, offsetTable[idx], ptr, basePtr);
-
-            if (!writeMapsAllMethods(pDvmDex, clazz, &ptr,
-                    length - (ptr - basePtr)))
-            {
-                return 0;
+            if (!checkMapsAllMethods(clazz)) {
+                dvmFreeRegisterMapBuilder(pBuilder);
+                return NULL;
             }
 
-            ptr = align32(ptr);
-            LOGVV("Size %s (%d+%d methods): %d", clazz->descriptor,
-                clazz->directMethodCount, clazz->virtualMethodCount,
-                (ptr - basePtr) - offsetTable[idx]);
+            pBuilder->classes[idx] = clazz;
+            pBuilder->classOffsets[idx] = size;
+            size = align32(size + computeMethodPoolSize(clazz));
+            LOGVV("%d -> offset %d, %s (%d+%d methods)",
+                idx, pBuilder->classOffsets[idx], clazz->descriptor,
+                clazz->directMethodCount, clazz->virtualMethodCount);
         } else {
             ALOGV("%4d NOT mapadding '%s'", idx, classDescriptor);
-            assert(offsetTable[idx] == 0);
         }
     }
 
-    if (ptr - basePtr >= (int)length) {
-        /* a bit late */
-        ALOGE("Buffer overrun");
-        dvmAbort();
-    }
+    ALOGV("TOTAL size of register maps: %zu", size);
 
-    return ptr - basePtr;
+    pBuilder->size = size;
+    return pBuilder;
 }
 
 /*
- * Generate a register map set for all verified classes in "pDvmDex".
+ * Write the register map pool described by "pBuilder" to "fd" at the
+ * current file offset.  Exactly pBuilder->size bytes are written.
+ *
+ * The per-class data is staged through a small buffer, so we never hold a
+ * second copy of all the maps.
+ *
+ * Returns "true" on success.
  */
-RegisterMapBuilder* dvmGenerateRegisterMaps(DvmDex* pDvmDex)
+bool dvmWriteRegisterMaps(const RegisterMapBuilder* pBuilder, int fd)
 {
-    RegisterMapBuilder* pBuilder;
+    static const size_t kStageSize = 64 * 1024;
+    RegisterMapClassPool header;
+    size_t bufSize = kStageSize;
+    size_t used = 0;
+    size_t written;
+    bool result = false;
+    u1* buf;
+    u4 idx;
 
-    pBuilder = (RegisterMapBuilder*) calloc(1, sizeof(RegisterMapBuilder));
-    if (pBuilder == NULL)
-        return NULL;
+    header.numClasses = pBuilder->numClasses;
+    if (sysWriteFully(fd, &header,
+            offsetof(RegisterMapClassPool, classDataOffset),
+            "DexOpt register map header") != 0 ||
+        sysWriteFully(fd, pBuilder->classOffsets,
+            pBuilder->numClasses * sizeof(u4),
+            "DexOpt register map offsets") != 0)
+    {
+        return false;
+    }
+    written = offsetof(RegisterMapClassPool, classDataOffset) +
+        pBuilder->numClasses * sizeof(u4);
 
-    /*
-     * We have a couple of options here:
-     *  (1) Compute the size of the output, and malloc a buffer.
-     *  (2) Create a "large-enough" anonymous mmap region.
-     *
-     * The nice thing about option #2 is that we don't have to traverse
-     * all of the classes and methods twice.  The risk is that we might
-     * not make the region large enough.  Since the pages aren't mapped
-     * until used we can allocate a semi-absurd amount of memory without
-     * worrying about the effect on the rest of the system.
-     *
-     * The basic encoding on the largest jar file requires about 1MB of
-     * storage.  We map out 4MB here.  (TODO: guarantee that the last
-     * page of the mapping is marked invalid, so we reliably fail if
-     * we overrun.)
-     */
-    if (sysCreatePrivateMap(4 * 1024 * 1024, &pBuilder->memMap) != 0) {
-        free(pBuilder);
-        return NULL;
+    buf = (u1*) malloc(bufSize);
+    if (buf == NULL)
+        return false;
+
+    for (idx = 0; idx < pBuilder->numClasses; idx++) {
+        const ClassObject* clazz = pBuilder->classes[idx];
+        if (clazz == NULL)
+            continue;
+
+        assert(pBuilder->classOffsets[idx] == written + used);
+        size_t poolSize = computeMethodPoolSize(clazz);
+        size_t paddedSize = align32(poolSize);
+
+        if (used + paddedSize > bufSize) {
+            if (sysWriteFully(fd, buf, used, "DexOpt register maps") != 0)
+                goto bail;
+            written += used;
+            used = 0;
+        }
+        if (paddedSize > bufSize) {
+            u1* newBuf = (u1*) realloc(buf, paddedSize);
+            if (newBuf == NULL)
+                goto bail;
+            buf = newBuf;
+            bufSize = paddedSize;
+        }
+
+        /* zero first, so the pool header's pad bytes and the tail are clean */
+        u1* ptr = buf + used;
+        memset(ptr, 0, paddedSize);
+        writeMapsAllMethods(clazz, &ptr);
+        assert(ptr == buf + used + poolSize);
+        used += paddedSize;
     }
 
-    /*
-     * Create the maps.
-     */
-    size_t actual = writeMapsAllClasses(pDvmDex, (u1*)pBuilder->memMap.addr,
-                                        pBuilder->memMap.length);
-    if (actual == 0) {
-        dvmFreeRegisterMapBuilder(pBuilder);
-        return NULL;
+    if (used > 0) {
+        if (sysWriteFully(fd, buf, used, "DexOpt register maps") != 0)
+            goto bail;
+        written += used;
     }
 
-    ALOGV("TOTAL size of register maps: %d", actual);
+    if (written != pBuilder->size) {
+        ALOGE("Register map size mismatch (%zu vs %zu)",
+            written, pBuilder->size);
+        goto bail;
+    }
+    result = true;
 
-    pBuilder->data = pBuilder->memMap.addr;
-    pBuilder->size = actual;
-    return pBuilder;
+bail:
+    free(buf);
+    return result;
 }
 
 /*
@@ -830,7 +918,8 @@ void dvmFreeRegisterMapBuilder(RegisterMapBuilder* pBuilder)
     if (pBuilder == NULL)
         return;
 
-    sysReleaseShmem(&pBuilder->memMap);
+    free(pBuilder->classes);
+    free(pBuilder->classOffsets);
     free(pBuilder);
 }
 
@@ -1371,7 +1460,9 @@ static void computeMapStats(RegisterMap* pMap, const Method* method)
  * Compute the difference between two bit vectors.
  *
  * If "lebOutBuf" is non-NULL, we output the bit indices in ULEB128 format
- * as we go.  Otherwise, we just generate the various counts.
+ * as we go.  Otherwise, we just generate the various counts, and stop
+ * counting once "kMaxChangedBits" bits have changed -- past that point the
+ * encoder stores the full vector, so the exact numbers don't matter.
  *
  * The bit vectors are compared byte-by-byte, so any unused bits at the
  * end must be zero.
@@ -1382,6 +1473,8 @@ static void computeMapStats(RegisterMap* pMap, const Method* method)
  * receive the index of the first changed bit and the number of changed
  * bits, respectively.
  */
+static const int kMaxChangedBits = 15;
+
 static int computeBitDiff(const u1* bits1, const u1* bits2, int byteWidth,
     int* pFirstBitChanged, int* pNumBitsChanged, u1* lebOutBuf)
 {
@@ -1391,37 +1484,33 @@ static int computeBitDiff(const u1* bits1, const u1* bits2, int byteWidth,
     int byteNum;
 
     /*
-     * Run through the vectors, first comparing them at the byte level.  This
-     * will yield a fairly quick result if nothing has changed between them.
+     * Run through the vectors, comparing them at the byte level, then
+     * peel off the changed bits in each differing byte lowest first.
      */
     for (byteNum = 0; byteNum < byteWidth; byteNum++) {
-        u1 byte1 = *bits1++;
-        u1 byte2 = *bits2++;
-        if (byte1 != byte2) {
-            /*
-             * Walk through the byte, identifying the changed bits.
-             */
-            int bitNum;
-            for (bitNum = 0; bitNum < 8; bitNum++) {
-                if (((byte1 >> bitNum) & 0x01) != ((byte2 >> bitNum) & 0x01)) {
-                    int bitOffset = (byteNum << 3) + bitNum;
-
-                    if (firstBitChanged < 0)
-                        firstBitChanged = bitOffset;
-                    numBitsChanged++;
-
-                    if (lebOutBuf == NULL) {
-                        lebSize += unsignedLeb128Size(bitOffset);
-                    } else {
-                        u1* curBuf = lebOutBuf;
-                        lebOutBuf = writeUnsignedLeb128(lebOutBuf, bitOffset);
-                        lebSize += lebOutBuf - curBuf;
-                    }
-                }
+        unsigned int diff = bits1[byteNum] ^ bits2[byteNum];
+
+        while (diff != 0) {
+            int bitOffset = (byteNum << 3) + __builtin_ctz(diff);
+            diff &= diff - 1;
+
+            if (firstBitChanged < 0)
+                firstBitChanged = bitOffset;
+            numBitsChanged++;
+
+            if (lebOutBuf == NULL) {
+                lebSize += unsignedLeb128Size(bitOffset);
+                if (numBitsChanged >= kMaxChangedBits)
+                    goto done;
+            } else {
+                u1* curBuf = lebOutBuf;
+                lebOutBuf = writeUnsignedLeb128(lebOutBuf, bitOffset);
+                lebSize += lebOutBuf - curBuf;
             }
         }
     }
 
+done:
     if (numBitsChanged > 0)
         assert(firstBitChanged >= 0);
 
@@ -1569,8 +1658,14 @@ static RegisterMap* compressMapDifferential(const RegisterMap* pMap,
 
         int numBitsChanged, firstBitChanged, lebSize;
 
-        lebSize = computeBitDiff(prevBits, mapData, regWidth,
-            &firstBitChanged, &numBitsChanged, NULL);
+        /* most GC points leave the vector unchanged, so check that first */
+        if (memcmp(prevBits, mapData, regWidth) == 0) {
+            numBitsChanged = lebSize = 0;
+            firstBitChanged = -1;
+        } else {
+            lebSize = computeBitDiff(prevBits, mapData, regWidth,
+                &firstBitChanged, &numBitsChanged, NULL);
+        }
 
         if (debug) {
             ALOGI(" : diff fbc=%d nbc=%d ls=%d (rw=%d)",
@@ -1585,7 +1680,7 @@ static RegisterMap* compressMapDifferential(const RegisterMap* pMap,
             /* set B to 0 and CCCC to the index of the changed bit */
             key |= firstBitChanged << 4;
             if (debug) ALOGI(" : 1 low bit changed");
-        } else if (numBitsChanged < 15 && lebSize < regWidth) {
+        } else if (numBitsChanged < kMaxChangedBits && lebSize < regWidth) {
             /* set B to 1 and CCCC to the number of bits */
             key |= 0x08 | (numBitsChanged << 4);
             if (debug) ALOGI(" : some bits changed");
@@ -206,23 +206,31 @@ const RegisterMap* dvmRegisterMapGetNext(const void** pPtr);
  * This holds some meta-data while we construct the set of register maps
  * for a DEX file.
  *
- * In particular, it keeps track of our temporary mmap region so we can
- * free it later.
+ * In particular, it records which classes get maps and where each one
+ * lands in the output, so the maps can be written out after the DEX
+ * file itself has been unmapped.
  */
 struct RegisterMapBuilder {
     /* public */
-    void*       data;
-    size_t      size;
+    size_t      size;               /* total size of the serialized maps */
 
     /* private */
-    MemMapping  memMap;
+    u4          numClasses;
+    const ClassObject** classes;    /* per class def; NULL if no maps */
+    u4*         classOffsets;       /* per class def; 0 if no maps */
 };
 
 /*
- * Generate a register map set for all verified classes in "pDvmDex".
+ * Gather the register map set for all verified classes in "pDvmDex".
  */
 RegisterMapBuilder* dvmGenerateRegisterMaps(DvmDex* pDvmDex);
 
+/*
+ * Write the register map set to "fd" at the current offset.  Writes
+ * exactly pBuilder->size bytes.
+ */
+bool dvmWriteRegisterMaps(const RegisterMapBuilder* pBuilder, int fd);
+
 /*
  * Free the builder.
  */
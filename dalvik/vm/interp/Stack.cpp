@@ -817,6 +817,10 @@ int dvmLineNumFromPC(const Method* method, u4 relPc)
         return -1;      /* can happen for abstract method stub */
     }
 
+    int lineNum;
+    if (dvmLineNumberCacheLookup(method, pDexCode, relPc, &lineNum))
+        return lineNum;
+
     LineNumFromPcContext context;
     memset(&context, 0, sizeof(context));
     context.address = relPc;
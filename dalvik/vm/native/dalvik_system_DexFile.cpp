@@ -664,6 +664,13 @@ void* DumpClass(void *parament)
   uint32_t start = pDexFile->pHeader->classDefsOff+sizeof(DexClassDef)*num_class_defs;
   uint32_t end = (uint32_t)((const u1*)mem->addr+mem->length-pDexFile->baseAddr);
 
+  /*
+   * Classes are defined and initialized one at a time, in class_def
+   * order, on this thread. Running dvmInitClass() on several threads could
+   * deadlock two <clinit>s that touch each other's classes, which the
+   * serial order never does, and the classdef/extra output is laid out in
+   * this same order.
+   */
   for (size_t i=0;i<num_class_defs;i++) 
   {
       bool need_extra=false;